@@ -16,6 +16,9 @@ layout(set = 0, binding = 0) uniform UniformBufferObject
 layout(location = 0) in vec3 inPosition;
 layout(location = 1) in vec3 inColor;
 layout(location = 2) in vec2 inTexCoord;
+// and per instance, from the second binding. a mat4 takes up
+// locations 3 to 6, a column each
+layout(location = 3) in mat4 inInstanceModel;
 
 layout(location = 0) out vec3 fragColor;
 layout(location = 1) out vec2 fragTexCoord;
@@ -27,7 +30,9 @@ out gl_PerVertex
 
 void main()
 {
-	gl_Position = ubo.proj * ubo.view * ubo.model * vec4(inPosition, 1.0);
+	// ubo.model spins every copy in place, the instance's matrix
+	// puts it where it goes in the scene
+	gl_Position = ubo.proj * ubo.view * inInstanceModel * ubo.model * vec4(inPosition, 1.0);
 	fragColor = inColor;
 	fragTexCoord = inTexCoord;
 }
\ No newline at end of file
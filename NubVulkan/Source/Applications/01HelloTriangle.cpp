@@ -8,6 +8,13 @@
 #define TINYOBJLOADER_IMPLEMENTATION
 #include <tiny_obj_loader.h>
 
+#include <Util/MeshIngest.h>
+#include <Util/MeshOptimizer.h>
+#include <Util/VertexPacking.h>
+
+#include <cmath>
+#include <thread>
+
 void HelloTriangleApp::run()
 {
 	this->initWindow();
@@ -15,8 +22,91 @@ void HelloTriangleApp::run()
 	this->loop();
 }
 
+void HelloTriangleApp::runHeadless(uint32_t frameCount, const std::string &dumpPath)
+{
+	// no initWindow(), there's no display to put one on
+	this->headless = true;
+	this->initVulkan();
+	this->loopHeadless(frameCount, dumpPath);
+}
+
+void HelloTriangleApp::benchmarkRecording(size_t drawCount)
+{
+	this->initWindow();
+	this->initVulkan();
+
+	VkPhysicalDeviceProperties properties;
+	vkGetPhysicalDeviceProperties(this->physicalDevice, &properties);
+
+	// the model chopped up into drawCount draws, as if the
+	// scene were that many objects. same triangles (and
+	// instances) either way
+	DrawCommand whole = this->drawList[0];
+	size_t triangles = this->mesh.indexCount / 3;
+	drawCount = std::max<size_t>(1, std::min(drawCount, triangles));
+	this->drawList.clear();
+	for (size_t draw = 0; draw < drawCount; draw++)
+	{
+		size_t first = triangles * draw / drawCount * 3;
+		size_t end = triangles * (draw + 1) / drawCount * 3;
+		this->drawList.push_back({ (uint32_t)(end - first), (uint32_t)first, 0, whole.instanceCount, whole.firstInstance });
+	}
+
+	std::cout << "recording " << drawCount << " draws on " << properties.deviceName << "\n";
+
+	VkCommandBufferInheritanceInfo inheritance = {};
+	inheritance.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+	inheritance.renderPass = this->renderPass;
+	inheritance.subpass = 0;
+	inheritance.framebuffer = this->swapChainFramebuffers[0];
+
+	auto recordSlice = [this](VkCommandBuffer secondary, size_t firstDraw, size_t endDraw)
+	{
+		this->recordDraws(secondary, 0, firstDraw, endDraw);
+	};
+
+	const int repeats = 20;
+	double serialMs = 0.0;
+	uint32_t graphicsFamily = (uint32_t)this->findQueueFamilies(this->physicalDevice).graphicsFamily;
+	unsigned maxThreads = std::max(1u, std::thread::hardware_concurrency());
+	for (unsigned threads = 1; ; threads = std::min(threads * 2, maxThreads))
+	{
+		ParallelRecorder recorder(this->device);
+		recorder.init(graphicsFamily, threads);
+
+		// once to warm up, so the pools already have their
+		// memory when the timing starts
+		recorder.free(recorder.record(inheritance, this->drawList.size(), recordSlice));
+
+		auto start = std::chrono::high_resolution_clock::now();
+		for (int repeat = 0; repeat < repeats; repeat++)
+		{
+			recorder.free(recorder.record(inheritance, this->drawList.size(), recordSlice));
+		}
+		auto end = std::chrono::high_resolution_clock::now();
+		double ms = std::chrono::duration<double, std::milli>(end - start).count() / repeats;
+
+		if (threads == 1)
+		{
+			serialMs = ms;
+		}
+		std::cout << "\t" << threads << " threads: " << ms << " ms, " << serialMs / ms << "x\n";
+
+		if (threads == maxThreads)
+		{
+			break;
+		}
+	}
+
+	vkDeviceWaitIdle(this->device);
+	this->submitCounters.queueWaitIdles++;
+	this->destroyRetiredSwapChains(true);
+}
+
 void HelloTriangleApp::initWindow()
 {
+	NUB_PROFILE_FUNCTION();
+
 	glfwInit();
 
 	// Since glfw was built for OGL (kinda in the name)
@@ -33,19 +123,38 @@ void HelloTriangleApp::initWindow()
 	// to our static member func
 
 	glfwSetWindowSizeCallback(this->window, HelloTriangleApp::onWindowResized);
+	glfwSetKeyCallback(this->window, HelloTriangleApp::onKey);
 }
 
 void HelloTriangleApp::initVulkan()
 {
+	CpuProfiler::setThreadName("main");
+	NUB_PROFILE_FUNCTION();
+
+
+	// Hey! here from the future! the jpg decode (and its mips)
+	// goes off to the worker threads first thing, and only
+	// gets waited on in createTextureImage(). everything in
+	// between, the model especially, overlaps with it
+	// what overlapped with what is all in the cpu trace,
+	// see writeCpuTrace()
+	this->textureDecode = this->textureDecoder.decode(TEXTURE_PATH, STREAM_TEXTURE_MIPS ? UINT32_MAX : 1);
+
 	this->createInstance();
 	this->setupDebugCallback();
 	this->createSurface();
 	this->pickPhysicalDevice();
 	this->createLogicalDevice();
+	this->createAllocator();
+	this->createPipelineCache();
 	this->createSwapChain();
 	this->createImageViews();
 	this->createRenderPass();
 	this->createDescriptorSetLayout();
+	// the model's loaded before the pipeline now, since
+	// which vertex layout the pipeline takes depends on it
+	this->loadModel();
+	this->chooseMeshFormats();
 	this->createGraphicsPipeline();
 	this->createCommandPool();
 	this->createDepthResources();
@@ -53,18 +162,28 @@ void HelloTriangleApp::initVulkan()
 	this->createTextureImage();
 	this->createTextureImageView();
 	this->createTextureSampler();
-	this->loadModel();
 	this->createVertexBuffer();
 	this->createIndexBuffer();
+	this->buildScene();
+	// everything above only recorded its copies & transitions,
+	// send them all off in one go. no waiting, the draws later
+	// on the same queue are ordered after them anyway
+	this->submitUploads();
 	this->createUniformBuffer();
 	this->createDescriptorPool();
 	this->createDescriptorSet();
 	this->createCommandBuffers();
-	this->createSemaphores();
+	this->createSyncObjects();
+
+	MemoryAllocatorStats memStats = this->allocator.getStats();
+	std::cout << "device memory: " << memStats.allocationCount << " allocations in " << memStats.blockCount << " blocks (" << memStats.dedicatedBlockCount << " dedicated), "
+		<< memStats.usedBytes / 1024 << " kb used, " << memStats.wastedBytes / 1024 << " kb lost to alignment, " << memStats.freeBytes / 1024 << " kb free\n";
 }
 
 void HelloTriangleApp::setupDebugCallback()
 {
+	NUB_PROFILE_FUNCTION();
+
 	if (!enableValidationLayers)
 	{
 		return;
@@ -83,6 +202,8 @@ void HelloTriangleApp::setupDebugCallback()
 
 void HelloTriangleApp::pickPhysicalDevice()
 {
+	NUB_PROFILE_FUNCTION();
+
 	uint32_t deviceCount = 0;
 	vkEnumeratePhysicalDevices(instance, &deviceCount, nullptr);
 
@@ -114,6 +235,13 @@ bool HelloTriangleApp::isDeviceSuitable(VkPhysicalDevice device)
 {
 	QueueFamilyIndices indices = this->findQueueFamilies(device);
 
+	// headless just needs something that can draw, no
+	// swapchain extension or surface to check against
+	if (this->headless)
+	{
+		return indices.isComplete();
+	}
+
 	bool extensionsSupported = this->checkDeviceExtensionSupport(device);
 
 	bool swapChainAdequate = false;
@@ -144,8 +272,17 @@ QueueFamilyIndices HelloTriangleApp::findQueueFamilies(VkPhysicalDevice device)
 			indices.graphicsFamily = i;
 		}
 
+		// nothing gets presented headless, so the graphics
+		// family will do for "present" as well
 		VkBool32 presentSupport = false;
-		vkGetPhysicalDeviceSurfaceSupportKHR(device, i, this->surface, &presentSupport);
+		if (this->headless)
+		{
+			indices.presentFamily = indices.graphicsFamily;
+		}
+		else
+		{
+			vkGetPhysicalDeviceSurfaceSupportKHR(device, i, this->surface, &presentSupport);
+		}
 		if (queueFamily.queueCount > 0 && presentSupport)
 		{
 			indices.presentFamily = i;
@@ -158,6 +295,32 @@ QueueFamilyIndices HelloTriangleApp::findQueueFamilies(VkPhysicalDevice device)
 		i++;
 	}
 
+	// Uploads would love a queue of their own, so copies
+	// don't queue up behind (or in front of) our draws. a
+	// transfer-only family is usually the gpu's dma engine
+	// so that's the best, otherwise take an async compute
+	// family (compute queues can always do transfers too)
+	// no luck? transferFamily stays -1 and uploads just go
+	// through the graphics queue like before
+	i = 0;
+	for (const auto &queueFamily : queueFamilies)
+	{
+		bool graphics = (queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT) != 0;
+		bool compute = (queueFamily.queueFlags & VK_QUEUE_COMPUTE_BIT) != 0;
+		bool transfer = (queueFamily.queueFlags & VK_QUEUE_TRANSFER_BIT) != 0;
+
+		if (queueFamily.queueCount > 0 && !graphics && transfer && !compute)
+		{
+			indices.transferFamily = i;
+			break;
+		}
+		if (queueFamily.queueCount > 0 && !graphics && compute && indices.transferFamily < 0)
+		{
+			indices.transferFamily = i;
+		}
+		i++;
+	}
+
 	return indices;
 }
 
@@ -196,27 +359,52 @@ VkPresentModeKHR HelloTriangleApp::chooseSwapPresentMode(const std::vector<VkPre
 
 void HelloTriangleApp::createLogicalDevice()
 {
+	NUB_PROFILE_FUNCTION();
+
 	QueueFamilyIndices indices = this->findQueueFamilies(this->physicalDevice);
 	std::vector<VkDeviceQueueCreateInfo> queueCreateInfos;
 	std::set<int> uniqueQueueFamilies = { indices.graphicsFamily, indices.presentFamily };
+	if (indices.transferFamily >= 0)
+	{
+		uniqueQueueFamilies.insert(indices.transferFamily);
+	}
+
+	// VK lets you bribe the command buffer to how you
+	// want your object prioritized, 0.0f to 1.0f
+	// (out here, cause the create infos keep a pointer to
+	// it till vkCreateDevice)
+	float queuePriority = 1.0f;
 
 	for (int queueFamily : uniqueQueueFamilies)
 	{
 		VkDeviceQueueCreateInfo queueCreateInfo = {};
 		queueCreateInfo.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
-		queueCreateInfo.queueFamilyIndex = indices.graphicsFamily;
+		queueCreateInfo.queueFamilyIndex = queueFamily;
 		queueCreateInfo.queueCount = 1;
 		// Most drivers only let you make a few/couple queues,
 		// And handling more than 1 would just be cumbersome
 
-		// VK lets you bribe the command buffer to how you
-		// want your object prioritized, 0.0f to 1.0f
-		float queuePriority = 1.0f;
 		queueCreateInfo.pQueuePriorities = &queuePriority;
 		queueCreateInfos.push_back(queueCreateInfo);
 	}
 
+	// Hey! here from the future! block compressed textures
+	// are an optional feature, so they have to be asked for
+	// (only if the gpu has them, or vkCreateDevice fails)
+	VkPhysicalDeviceFeatures supportedFeatures;
+	vkGetPhysicalDeviceFeatures(this->physicalDevice, &supportedFeatures);
+	this->bcTexturesSupported = supportedFeatures.textureCompressionBC == VK_TRUE;
+	// same for the profiler's pipeline statistics. the
+	// draws are in secondaries, so those have to be able
+	// to inherit the query too
+	this->pipelineStatisticsSupported = GPU_PIPELINE_STATISTICS &&
+		supportedFeatures.pipelineStatisticsQuery == VK_TRUE &&
+		supportedFeatures.inheritedQueries == VK_TRUE;
+
 	VkPhysicalDeviceFeatures deviceFeatures = {};
+	deviceFeatures.textureCompressionBC = supportedFeatures.textureCompressionBC;
+	deviceFeatures.pipelineStatisticsQuery = this->pipelineStatisticsSupported ? VK_TRUE : VK_FALSE;
+	deviceFeatures.inheritedQueries = this->pipelineStatisticsSupported ? VK_TRUE : VK_FALSE;
 	VkDeviceCreateInfo createInfo = {};
 	createInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
 
@@ -229,7 +417,9 @@ void HelloTriangleApp::createLogicalDevice()
 	// device extension for swapchain wasn't loaded!
 	// it was set to 0 for the first part and i never
 	// changed it
-	createInfo.enabledExtensionCount = deviceExtensions.size();
+	// (headless doesn't want any, software drivers like
+	// lavapipe might not even have the swapchain one)
+	createInfo.enabledExtensionCount = this->headless ? 0 : deviceExtensions.size();
 	createInfo.ppEnabledExtensionNames = deviceExtensions.data();
 
 	if (enableValidationLayers)
@@ -249,6 +439,17 @@ void HelloTriangleApp::createLogicalDevice()
 
 	vkGetDeviceQueue(this->device, indices.graphicsFamily, 0, &this->graphicsQueue);
 	vkGetDeviceQueue(this->device, indices.presentFamily, 0, &this->presentQueue);
+
+	if (indices.transferFamily >= 0)
+	{
+		vkGetDeviceQueue(this->device, indices.transferFamily, 0, &this->transferQueue);
+		std::cout << "uploads: dedicated transfer queue family " << indices.transferFamily << "\n";
+	}
+	else
+	{
+		this->transferQueue = this->graphicsQueue;
+		std::cout << "uploads: no separate transfer family, sharing the graphics queue\n";
+	}
 }
 
 bool HelloTriangleApp::checkValidationLayerSupport()
@@ -283,9 +484,14 @@ std::vector<const char *> HelloTriangleApp::getRequiredExtensions()
 {
 	std::vector<const char *> exts;
 
+	// headless never even glfwInit()s, and has no surface
+	// extensions to ask for anyway
 	unsigned int glfwExtCount = 0;
-	const char **glfwExts;
-	glfwExts = glfwGetRequiredInstanceExtensions(&glfwExtCount);
+	const char **glfwExts = nullptr;
+	if (!this->headless)
+	{
+		glfwExts = glfwGetRequiredInstanceExtensions(&glfwExtCount);
+	}
 
 	for (unsigned int i = 0; i < glfwExtCount; i++)
 	{
@@ -447,10 +653,26 @@ void HelloTriangleApp::onWindowResized(GLFWwindow * window, int width, int heigh
 	// so _that's_ how you reinterpret_cast... cool beans
 	// man, that gave me a false sense of intelligence
 
-	app->recreateSwapChain();
+	// Hey! here from the future! this used to recreate the
+	// swapchain right here, which a window drag can fire
+	// dozens of times a frame. now it just leaves a note
+	// for drawFrame() to pick up once per frame
+	app->framebufferResized = true;
+}
+
+void HelloTriangleApp::onKey(GLFWwindow * window, int key, int scancode, int action, int mods)
+{
+	// F2 writes the frame stats out mid run, so a stutter
+	// can be grabbed right after it happens. same deal as
+	// resizing, the loop does the actual work
+	if (key == GLFW_KEY_F2 && action == GLFW_PRESS)
+	{
+		HelloTriangleApp *app = reinterpret_cast<HelloTriangleApp *>(glfwGetWindowUserPointer(window));
+		app->frameStatsRequested = true;
+	}
 }
 
-void HelloTriangleApp::createShaderModule(const std::vector<char>& code, VDeleter<VkShaderModule>& shaderModule)
+void HelloTriangleApp::createShaderModule(const std::vector<char>& code, VShaderModule& shaderModule)
 {
 	// Making a shader module is "easy", just give it the
 	// address of your code data buffer & its size
@@ -465,8 +687,16 @@ void HelloTriangleApp::createShaderModule(const std::vector<char>& code, VDelete
 	}
 }
 
-void HelloTriangleApp::createSwapChain()
+void HelloTriangleApp::createSwapChain(VkSwapchainKHR oldSwapChain)
 {
+	NUB_PROFILE_FUNCTION();
+
+	if (this->headless)
+	{
+		this->createOffscreenTargets();
+		return;
+	}
+
 	// Tying it all together
 
 	SwapChainSupportDetails swapChainSupport = this->querySwapChainSupport(this->physicalDevice);
@@ -535,21 +765,17 @@ void HelloTriangleApp::createSwapChain()
 	// Hello higher order beings of the past! I have come
 	// from the recreateSwapChain() function to bring you
 	// new additions!
-	VkSwapchainKHR oldSwapChain = this->swapChain;
+	// (future future me: the old one's handed in by
+	// recreateSwapChain() now, which keeps it alive till
+	// the frames using it are done, instead of us
+	// destroying it the moment the new one's made)
 	createInfo.oldSwapchain = oldSwapChain;
 
-	VkSwapchainKHR newSwapChain;
-	// This should have the newSwapChain as the last param
-	if (vkCreateSwapchainKHR(this->device, &createInfo, nullptr, &newSwapChain) != VK_SUCCESS)
+	if (vkCreateSwapchainKHR(this->device, &createInfo, nullptr, this->swapChain.replace()) != VK_SUCCESS)
 	{
 		throw std::runtime_error("Couldn't create a swap chain!");
 	}
 
-	// Here too! this is new too
-	this->swapChain = newSwapChain;
-	// This will destroy the old swapchain and replace the
-	// handle with the handle of the new one!
-
 	vkGetSwapchainImagesKHR(this->device, this->swapChain, &imageCount, nullptr);
 	swapChainImages.resize(imageCount);
 	vkGetSwapchainImagesKHR(this->device, this->swapChain, &imageCount, swapChainImages.data());
@@ -558,8 +784,147 @@ void HelloTriangleApp::createSwapChain()
 	this->swapChainExtent = extent;
 }
 
+void HelloTriangleApp::createOffscreenTargets()
+{
+	// The headless stand-in for a swapchain. plain images
+	// we render into and can copy out of, one per frame in
+	// flight so no two frames ever share one. everything
+	// after this (image views, framebuffers, command
+	// buffers) just sees swapChainImages and doesn't care
+	this->swapChainImageFormat = VK_FORMAT_R8G8B8A8_UNORM;
+	this->swapChainExtent = { (uint32_t)WIDTH, (uint32_t)HEIGHT };
+
+	this->offscreenImages.clear();
+	this->offscreenImageMemory.clear();
+	resizeHandles(this->offscreenImages, MAX_FRAMES_IN_FLIGHT, this->device);
+	this->swapChainImages.clear();
+	for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
+	{
+		this->offscreenImageMemory.emplace_back(this->allocator);
+		this->createImage(
+			this->swapChainExtent.width,
+			this->swapChainExtent.height,
+			1,
+			this->swapChainImageFormat,
+			VK_IMAGE_TILING_OPTIMAL,
+			VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT,
+			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+			this->offscreenImages[i],
+			this->offscreenImageMemory[i]);
+		this->swapChainImages.push_back(this->offscreenImages[i]);
+	}
+}
+
+void HelloTriangleApp::dumpFrame(uint32_t imageIndex, const std::string &path)
+{
+	NUB_PROFILE_FUNCTION();
+
+	// Copies an offscreen image back to the cpu and writes
+	// it out as a binary ppm, which anything can open and
+	// needs no library to write. only once at the very
+	// end, so a blocking submit & wait is fine
+	uint32_t width = this->swapChainExtent.width;
+	uint32_t height = this->swapChainExtent.height;
+	VkDeviceSize size = (VkDeviceSize)width * height * 4;
+
+	VBuffer readbackBuffer{ this->device };
+	VAllocation readbackMemory{ this->allocator };
+	this->createBuffer(size, VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, readbackBuffer, readbackMemory);
+
+	VkCommandBufferAllocateInfo allocInfo = {};
+	allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+	allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+	allocInfo.commandPool = this->commandPool;
+	allocInfo.commandBufferCount = 1;
+
+	VkCommandBuffer cmdBuff;
+	if (vkAllocateCommandBuffers(this->device, &allocInfo, &cmdBuff) != VK_SUCCESS)
+	{
+		throw std::runtime_error("Couldn't allocate a readback command buffer!");
+	}
+
+	VkCommandBufferBeginInfo beginInfo = {};
+	beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+	beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+	vkBeginCommandBuffer(cmdBuff, &beginInfo);
+
+	// the render pass already left it in transfer src,
+	// but its colour writes still have to be made visible
+	// to the copy
+	VkImageMemoryBarrier barrier = {};
+	barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+	barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+	barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+	barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.image = this->swapChainImages[imageIndex];
+	barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+	barrier.subresourceRange.baseMipLevel = 0;
+	barrier.subresourceRange.levelCount = 1;
+	barrier.subresourceRange.baseArrayLayer = 0;
+	barrier.subresourceRange.layerCount = 1;
+	barrier.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+	barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+	vkCmdPipelineBarrier(cmdBuff, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+	VkBufferImageCopy region = {};
+	region.bufferOffset = 0;
+	region.bufferRowLength = 0;
+	region.bufferImageHeight = 0;
+	region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+	region.imageSubresource.mipLevel = 0;
+	region.imageSubresource.baseArrayLayer = 0;
+	region.imageSubresource.layerCount = 1;
+	region.imageOffset = { 0, 0, 0 };
+	region.imageExtent = { width, height, 1 };
+	vkCmdCopyImageToBuffer(cmdBuff, this->swapChainImages[imageIndex], VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, readbackBuffer, 1, &region);
+
+	vkEndCommandBuffer(cmdBuff);
+
+	VkSubmitInfo submitInfo = {};
+	submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+	submitInfo.commandBufferCount = 1;
+	submitInfo.pCommandBuffers = &cmdBuff;
+	vkQueueSubmit(this->graphicsQueue, 1, &submitInfo, VK_NULL_HANDLE);
+	vkQueueWaitIdle(this->graphicsQueue);
+	this->submitCounters.submits++;
+	this->submitCounters.queueWaitIdles++;
+	vkFreeCommandBuffers(this->device, this->commandPool, 1, &cmdBuff);
+
+	const uint8_t *pixels = static_cast<const uint8_t *>(readbackMemory.map());
+
+	std::ofstream file(path, std::ios::binary | std::ios::trunc);
+	if (!file.is_open())
+	{
+		throw std::runtime_error("Couldn't open " + path + " to dump the frame into!");
+	}
+	file << "P6\n" << width << " " << height << "\n255\n";
+
+	// ppm's just rgb, the alpha gets dropped
+	std::vector<uint8_t> row((size_t)width * 3);
+	for (uint32_t y = 0; y < height; y++)
+	{
+		const uint8_t *src = pixels + (size_t)y * width * 4;
+		for (uint32_t x = 0; x < width; x++)
+		{
+			row[x * 3 + 0] = src[x * 4 + 0];
+			row[x * 3 + 1] = src[x * 4 + 1];
+			row[x * 3 + 2] = src[x * 4 + 2];
+		}
+		file.write(reinterpret_cast<const char *>(row.data()), row.size());
+	}
+
+	if (!file)
+	{
+		throw std::runtime_error("Couldn't write the frame to " + path + "!");
+	}
+	std::cout << "dumped the last frame to " << path << "\n";
+}
+
 void HelloTriangleApp::createInstance()
 {
+	NUB_PROFILE_FUNCTION();
+
 	if (enableValidationLayers && !this->checkValidationLayerSupport()) 
 	{
 		throw std::runtime_error("validation layers requested, but not available!");
@@ -599,6 +964,13 @@ void HelloTriangleApp::createInstance()
 
 void HelloTriangleApp::createSurface()
 {
+	NUB_PROFILE_FUNCTION();
+
+	if (this->headless)
+	{
+		return;
+	}
+
 	if (glfwCreateWindowSurface(this->instance, window, nullptr, surface.replace()) != VK_SUCCESS)
 	{
 		throw std::runtime_error("Couldn't create window surface!");
@@ -607,20 +979,24 @@ void HelloTriangleApp::createSurface()
 
 void HelloTriangleApp::createImageViews()
 {
+	NUB_PROFILE_FUNCTION();
+
 	// Since we've got an array of these, gotta construct
 	// them manually
-	this->swapChainImageViews.resize(this->swapChainImages.size(), VDeleter<VkImageView>{this->device, vkDestroyImageView});
+	resizeHandles(this->swapChainImageViews, this->swapChainImages.size(), this->device);
 
 	for (uint32_t i = 0; i < this->swapChainImages.size(); i++)
 	{
 		// I'm here from the future! the fifth of november
 		// to be exact. just removing redundancy. 
-		this->createImageView(this->swapChainImages[i], this->swapChainImageFormat, VK_IMAGE_ASPECT_COLOR_BIT, this->swapChainImageViews[i]);
+		this->createImageView(this->swapChainImages[i], this->swapChainImageFormat, VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, this->swapChainImageViews[i]);
 	}
 }
 
 void HelloTriangleApp::createRenderPass()
 {
+	NUB_PROFILE_FUNCTION();
+
 	// Hold up! before we can finish up that pipeline,
 	// We gotta set this up! We need to tell vulkan about
 	// the framebuffer attachments we'll be using for
@@ -651,6 +1027,12 @@ void HelloTriangleApp::createRenderPass()
 
 	colAtt.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
 	colAtt.finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+	// (headless there's nothing to present to, so it's
+	// left ready to be copied out instead, see dumpFrame)
+	if (this->headless)
+	{
+		colAtt.finalLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+	}
 	// textures and framebuffers in vk are represented by
 	// the VkImage object, with certain pixel formats etc
 	// specified. however, the layout of pixels can change
@@ -726,22 +1108,27 @@ void HelloTriangleApp::createRenderPass()
 	// dst must always be higher than src to prevent
 	// cycles in the dependency graph
 
-	dep.srcStageMask = VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT;
-	dep.srcAccessMask = 0;
+	dep.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+	dep.srcAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
 	// these params specify the ops to wait on and the
 	// stages in which these ops occur. we need to wait
 	// for the swap chain to finish reading from the image
-	// before we can access it, duh. this read happens in
-	// the last pipeline stage
-
-	dep.dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-	dep.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_READ_BIT |VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+	// before we can access it, duh. that's the image
+	// available semaphore, which drawFrame() waits on in
+	// the color output stage, so that stage goes here.
+	// Hey! from the future! there's one depth image shared
+	// by every frame in flight, so the previous frame's
+	// depth tests have to be done writing it before this
+	// one clears it. hence the test stages & depth write
+
+	dep.dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+	dep.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
 	// or'd. the operations that should wait on this are
 	// in the color attachment stage and involve the read
-	// and write of the color attachment. these settings
-	// will prevent the transition from happening until it
-	// is necessary & allowed; when we want to start
-	// writing colours to it
+	// and write of the color attachment (and the depth
+	// clear & writes). these settings will prevent the
+	// transition from happening until it is necessary &
+	// allowed; when we want to start writing colours to it
 
 	std::array<VkAttachmentDescription, 2> atts = { colAtt, depthAtt };
 	VkRenderPassCreateInfo rendPassInfo = {};
@@ -763,13 +1150,18 @@ void HelloTriangleApp::createRenderPass()
 
 void HelloTriangleApp::createDescriptorSetLayout()
 {
+	NUB_PROFILE_FUNCTION();
+
 	// This is just the _set_ of descriptors!
 	VkDescriptorSetLayoutBinding uboLayoutBinding = {};
 	uboLayoutBinding.binding = 0;
-	uboLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+	uboLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
 	uboLayoutBinding.descriptorCount = 1;
 	// first 2 params specify the binding used in shader
 	// just a single struct object, so 1
+	// _dynamic means the offset into the buffer is handed
+	// over when the set gets bound, so one set can point
+	// at any frame's slot of our uniform ring
 
 	uboLayoutBinding.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
 	// we need to specify whcich shader stages the desc.
@@ -815,14 +1207,16 @@ void HelloTriangleApp::createDescriptorSetLayout()
 
 void HelloTriangleApp::createGraphicsPipeline()
 {
+	NUB_PROFILE_FUNCTION();
+
 	// For now, we've just got these 2 cute lil shaders
 	auto vertShaderCode = readFile("Shaders/shader.vert.spv");
 	auto fragShaderCode = readFile("Shaders/shader.frag.spv");
 
 	// Just like in opengl, we can discard the shaders
 	// once we've got our program compiled and linked
-	VDeleter<VkShaderModule> vertShaderModule{ this->device, vkDestroyShaderModule };
-	VDeleter<VkShaderModule> fragShaderModule{ this->device, vkDestroyShaderModule };
+	VShaderModule vertShaderModule{ this->device };
+	VShaderModule fragShaderModule{ this->device };
 	this->createShaderModule(vertShaderCode, vertShaderModule);
 	this->createShaderModule(fragShaderCode, fragShaderModule);
 
@@ -852,12 +1246,21 @@ void HelloTriangleApp::createGraphicsPipeline()
 	VkPipelineVertexInputStateCreateInfo vertInputInfo = {};
 	vertInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
 
-	auto bindDesc = Vertex::getBindingDescription();
-	auto attribDesc = Vertex::getAttributeDescriptions();
+	// two bindings now, the vertices and (stepping once
+	// per instance instead) each instance's transform
+	VkVertexInputBindingDescription bindDescs[] = {
+		Vertex::getBindingDescription(this->vertexFormat),
+		InstanceData::getBindingDescription()
+	};
+
+	auto vertAttribDescs = Vertex::getAttributeDescriptions(this->vertexFormat);
+	auto instAttribDescs = InstanceData::getAttributeDescriptions();
+	std::vector<VkVertexInputAttributeDescription> attribDesc(vertAttribDescs.begin(), vertAttribDescs.end());
+	attribDesc.insert(attribDesc.end(), instAttribDescs.begin(), instAttribDescs.end());
 
-	vertInputInfo.vertexBindingDescriptionCount = 1;
-	vertInputInfo.pVertexBindingDescriptions = &bindDesc;
-	vertInputInfo.vertexAttributeDescriptionCount = attribDesc.size();
+	vertInputInfo.vertexBindingDescriptionCount = 2;
+	vertInputInfo.pVertexBindingDescriptions = bindDescs;
+	vertInputInfo.vertexAttributeDescriptionCount = (uint32_t)attribDesc.size();
 	vertInputInfo.pVertexAttributeDescriptions = attribDesc.data();
 
 	// Input assembly, what kind of geometry is this?
@@ -874,29 +1277,18 @@ void HelloTriangleApp::createGraphicsPipeline()
 
 	// Viewports and scissors
 
-	VkViewport viewport = {};
-	viewport.x = 0.0f;
-	viewport.y = 0.0f;
-	viewport.width = (float)this->swapChainExtent.width;
-	viewport.height = (float)this->swapChainExtent.height;
-	viewport.minDepth = 0.0f;
-	viewport.maxDepth = 1.0f;
-	// haha oh my god, depth buffering didnt work because
-	// these two little shits were switched around
-	// Depth range for the framebuffer, 0 to 1.0 is normal
-
-	// What region of pixels will be stored
-	VkRect2D scissor = {};
-	scissor.offset = { 0,0 }; // hoo, hoo, I'm an owl
-	scissor.extent = this->swapChainExtent;
-
-	// combine the viewport and scissor info
+	// Hey! here from the future! these used to be baked in
+	// with swapChainExtent, so every resize meant a whole
+	// new pipeline. now they're dynamic state (see down
+	// there) and set per command buffer in
+	// createCommandBuffers(), the pipeline just needs to
+	// know how many there are
 	VkPipelineViewportStateCreateInfo viewportState = {};
 	viewportState.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
 	viewportState.viewportCount = 1;
-	viewportState.pViewports = &viewport;
+	viewportState.pViewports = nullptr;
 	viewportState.scissorCount = 1;
-	viewportState.pScissors = &scissor;
+	viewportState.pScissors = nullptr;
 
 	// Rasterizer
 	// Takes our stupid geometry, and fragments them
@@ -1010,10 +1402,11 @@ void HelloTriangleApp::createGraphicsPipeline()
 	// entire pipeline if we just want to modify certain
 	// parts, with the blend ops being one!
 
-	// Here's some
+	// Here's some (line width's gone, we only draw
+	// triangles, the scissor's come in its place)
 	VkDynamicState dyanamicStates[] = {
 		VK_DYNAMIC_STATE_VIEWPORT,
-		VK_DYNAMIC_STATE_LINE_WIDTH
+		VK_DYNAMIC_STATE_SCISSOR
 	};
 	
 	VkPipelineDynamicStateCreateInfo dynamicState = {};
@@ -1063,7 +1456,7 @@ void HelloTriangleApp::createGraphicsPipeline()
 	pipelineInfo.pMultisampleState = &multiSample;
 	pipelineInfo.pDepthStencilState = &depthStencil;
 	pipelineInfo.pColorBlendState = &colBlend;
-	pipelineInfo.pDynamicState = nullptr; // optional
+	pipelineInfo.pDynamicState = &dynamicState;
 
 	// let's now ref all the structs describing the fixed
 	// func stage
@@ -1080,15 +1473,79 @@ void HelloTriangleApp::createGraphicsPipeline()
 	// for now we have nothing to switch back to, so leave
 	// it as null
 
-	if (vkCreateGraphicsPipelines(this->device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, this->graphicsPipeline.replace()) != VK_SUCCESS)
+	// Hey! here from the future! the cache means a pipeline
+	// the driver's compiled before (this run, or a previous
+	// one thanks to savePipelineCache()) comes back almost
+	// for free
+	auto start = std::chrono::high_resolution_clock::now();
+	if (vkCreateGraphicsPipelines(this->device, this->pipelineCache, 1, &pipelineInfo, nullptr, this->graphicsPipeline.replace()) != VK_SUCCESS)
 	{
 		throw std::runtime_error("Couldn't create graphics pipeline!");
 	}
+	auto end = std::chrono::high_resolution_clock::now();
+
+	std::cout << "pipeline: created in " << std::chrono::duration<double, std::milli>(end - start).count() << " ms ("
+		<< (this->pipelineCacheLoadedBytes > 0 ? std::to_string(this->pipelineCacheLoadedBytes) + " byte cache from disk" : std::string("nothing from disk")) << ")\n";
+}
+
+void HelloTriangleApp::createPipelineCache()
+{
+	NUB_PROFILE_FUNCTION();
+
+	VkPhysicalDeviceProperties properties;
+	vkGetPhysicalDeviceProperties(this->physicalDevice, &properties);
+
+	// an empty cache if there's no file, or it's from a
+	// different gpu or driver, the driver fills it in as
+	// pipelines get made
+	std::vector<char> data;
+	loadPipelineCacheData(PIPELINE_CACHE_PATH, properties, data);
+
+	VkPipelineCacheCreateInfo cacheInfo = {};
+	cacheInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+	cacheInfo.initialDataSize = data.size();
+	cacheInfo.pInitialData = data.empty() ? nullptr : data.data();
+
+	if (vkCreatePipelineCache(this->device, &cacheInfo, nullptr, this->pipelineCache.replace()) != VK_SUCCESS)
+	{
+		throw std::runtime_error("Couldn't create pipeline cache!");
+	}
+	this->pipelineCacheLoadedBytes = data.size();
+}
+
+void HelloTriangleApp::savePipelineCache()
+{
+	NUB_PROFILE_FUNCTION();
+
+	size_t dataSize = 0;
+	if (vkGetPipelineCacheData(this->device, this->pipelineCache, &dataSize, nullptr) != VK_SUCCESS || dataSize == 0)
+	{
+		return;
+	}
+
+	std::vector<char> data(dataSize);
+	if (vkGetPipelineCacheData(this->device, this->pipelineCache, &dataSize, data.data()) != VK_SUCCESS)
+	{
+		return;
+	}
+	data.resize(dataSize);
+
+	VkPhysicalDeviceProperties properties;
+	vkGetPhysicalDeviceProperties(this->physicalDevice, &properties);
+
+	// not being able to write it is no big deal, next start
+	// is just a cold one
+	if (!savePipelineCacheData(PIPELINE_CACHE_PATH, properties, data))
+	{
+		std::cerr << "Couldn't save pipeline cache to " << PIPELINE_CACHE_PATH << "\n";
+	}
 }
 
 void HelloTriangleApp::createFrameBuffers()
 {
-	this->swapChainFramebuffers.resize(this->swapChainImageViews.size(), VDeleter<VkFramebuffer>{this->device, vkDestroyFramebuffer});
+	NUB_PROFILE_FUNCTION();
+
+	resizeHandles(this->swapChainFramebuffers, this->swapChainImageViews.size(), this->device);
 
 	for (size_t i = 0; i < this->swapChainImageViews.size(); i++)
 	{
@@ -1116,6 +1573,8 @@ void HelloTriangleApp::createFrameBuffers()
 
 void HelloTriangleApp::createCommandPool()
 {
+	NUB_PROFILE_FUNCTION();
+
 	QueueFamilyIndices queueFamilyIndices = this->findQueueFamilies(this->physicalDevice);
 
 	VkCommandPoolCreateInfo poolInfo = {};
@@ -1130,50 +1589,97 @@ void HelloTriangleApp::createCommandPool()
 	{
 		throw std::runtime_error("Couldn't create command pool!");
 	}
-}
-
-VkCommandBuffer HelloTriangleApp::beginSingleTimeCommands()
-{
-	VkCommandBufferAllocateInfo allocInfo = {};
-	allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
-	allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-	allocInfo.commandPool = this->commandPool;
-	allocInfo.commandBufferCount = 1;
 
-	VkCommandBuffer cmdBuff;
-	vkAllocateCommandBuffers(this->device, &allocInfo, &cmdBuff);
+	// Hey! here from the future! uploads used to go
+	// through begin/endSingleTimeCommands, which submitted
+	// a lone command buffer and vkQueueWaitIdle'd for
+	// every single copy & transition. now they all get
+	// recorded into the upload context's current batch
+	// and go off together with submitUploads(). copies
+	// run on the transfer queue (if we got one) and get
+	// handed over to the graphics queue at the end
+	int transferFamily = queueFamilyIndices.transferFamily >= 0 ? queueFamilyIndices.transferFamily : queueFamilyIndices.graphicsFamily;
+	this->uploads.init(this->transferQueue, transferFamily, this->graphicsQueue, queueFamilyIndices.graphicsFamily);
+
+	// gpu timings. each profiler only works if its queue
+	// family has timestamps (a transfer-only one can't
+	// reset queries either), so say which ones we got
+	this->uploadProfiler.init(this->physicalDevice, transferFamily, 1, false);
+	this->uploads.setProfiler(&this->uploadProfiler);
+	this->frameProfiler.init(this->physicalDevice, queueFamilyIndices.graphicsFamily, 4, this->pipelineStatisticsSupported);
+	std::cout << "gpu profiler: render pass timestamps " << (this->frameProfiler.hasTimestamps() ? "on" : "off")
+		<< ", pipeline statistics " << (this->frameProfiler.hasPipelineStatistics() ? "on" : "off")
+		<< ", upload timestamps " << (this->uploadProfiler.hasTimestamps() ? "on" : "off") << "\n";
+
+	// and a pool per recording thread, see createCommandBuffers()
+	// (a set of them per frame in flight if we're recording
+	// every frame, so one slot's can be reset on its own)
+	if (!RECORD_EVERY_FRAME)
+	{
+		this->recorder.init(queueFamilyIndices.graphicsFamily, RECORDING_THREADS);
+		return;
+	}
 
-	VkCommandBufferBeginInfo beginInfo = {};
-	beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
-	beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+	this->recorder.init(queueFamilyIndices.graphicsFamily, RECORDING_THREADS, MAX_FRAMES_IN_FLIGHT, VK_COMMAND_POOL_CREATE_TRANSIENT_BIT);
 
-	vkBeginCommandBuffer(cmdBuff, &beginInfo);
+	// _transient_ tells the driver these buffers are short
+	// lived (recorded, run once, reset), which it can
+	// allocate for differently
+	VkCommandPoolCreateInfo framePoolInfo = {};
+	framePoolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+	framePoolInfo.queueFamilyIndex = queueFamilyIndices.graphicsFamily;
+	framePoolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
 
-	return cmdBuff;
+	resizeHandles(this->frameCommandPools, MAX_FRAMES_IN_FLIGHT, this->device);
+	this->frameCommandBuffers.assign(MAX_FRAMES_IN_FLIGHT, VK_NULL_HANDLE);
+	this->frameSecondaryCommandBuffers.assign(MAX_FRAMES_IN_FLIGHT, std::vector<VkCommandBuffer>());
+	for (auto &pool : this->frameCommandPools)
+	{
+		if (vkCreateCommandPool(this->device, &framePoolInfo, nullptr, pool.replace()) != VK_SUCCESS)
+		{
+			throw std::runtime_error("Couldn't create a frame command pool!");
+		}
+	}
 }
 
-void HelloTriangleApp::endSingleTimeCommands(VkCommandBuffer cmdBuff)
+UploadTicket HelloTriangleApp::submitUploads()
 {
-	vkEndCommandBuffer(cmdBuff);
-
-	VkSubmitInfo submitInfo = {};
-	submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-	submitInfo.commandBufferCount = 1;
-	submitInfo.pCommandBuffers = &cmdBuff;
+	NUB_PROFILE_FUNCTION();
+
+	// one submit, or two with a separate transfer queue
+	uint64_t submitsBefore = this->uploads.getSubmitCount();
+	UploadTicket ticket = this->uploads.submit();
+	this->submitCounters.submits += this->uploads.getSubmitCount() - submitsBefore;
+	// you can hang onto the ticket and ask
+	// this->uploads.isComplete(ticket) or wait(ticket) if
+	// you need to know when it's landed
+	return ticket;
+}
 
-	vkQueueSubmit(this->graphicsQueue, 1, &submitInfo, VK_NULL_HANDLE);
-	vkQueueWaitIdle(this->graphicsQueue);
+void HelloTriangleApp::createAllocator()
+{
+	NUB_PROFILE_FUNCTION();
+
+	// Hey! here from the future! every buffer and image
+	// used to get its own vkAllocateMemory, which is a
+	// no-no once there's a few hundred meshes & textures
+	// (maxMemoryAllocationCount can be as low as 4096)
+	// so now they all get carved out of big blocks, see
+	// Util/MemoryAllocator.h
+	VkPhysicalDeviceMemoryProperties memProperties;
+	vkGetPhysicalDeviceMemoryProperties(this->physicalDevice, &memProperties);
 
-	vkFreeCommandBuffers(this->device, this->commandPool, 1, &cmdBuff);
+	this->allocator.init(std::unique_ptr<MemoryBackend>(new VulkanMemoryBackend(this->device)), memProperties);
 }
 
-void HelloTriangleApp::createBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, VDeleter<VkBuffer>& buff, VDeleter<VkDeviceMemory>& buffMemory)
+void HelloTriangleApp::createBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, VBuffer& buff, VAllocation& buffMemory)
 {
 	// Ey! abstracting buffer creation! Optimally though,
 	// you shouldn't be malloc'ing gpu memory in little
 	// chunks, instead allocate a buttload first, and use
 	// those handy buffer offsets to put your little buffs
 	// inside! search up on vk memory management
+	// (future me: that's what this->allocator does now!)
 	
 	VkBufferCreateInfo buffInfo = {};
 	buffInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
@@ -1218,26 +1724,17 @@ void HelloTriangleApp::createBuffer(VkDeviceSize size, VkBufferUsageFlags usage,
 	// as well as performance stats. let's get that info!
 	// head over to this->findMemoryType();
 
-	// physical memory allocation for our buffer
+	// physical memory allocation for our buffer, well,
+	// a slice of some bigger block. buffers are linear
 
-	VkMemoryAllocateInfo allocInfo = {};
-	allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-	allocInfo.allocationSize = memReqs.size;
-	allocInfo.memoryTypeIndex = this->findMemoryType(memReqs.memoryTypeBits, properties);
-
-	if (vkAllocateMemory(this->device, &allocInfo, nullptr, buffMemory.replace()) != VK_SUCCESS)
-	{
-		throw std::runtime_error("Couldn't create buffer memory!");
-	}
+	buffMemory.reset(this->allocator.allocate(memReqs, this->findMemoryType(memReqs.memoryTypeBits, properties), true));
 
 	// cool! now we can associate this alloc'd memory with
 	// the buffer
-	vkBindBufferMemory(this->device, buff, buffMemory, 0);
+	vkBindBufferMemory(this->device, buff, buffMemory.memory(), buffMemory.offset());
 	// ps: that last param is the offset within the region
-	// of memory. since the mem is alloc'd specifically
-	// for this vert buffer, we're havin it be 0, hurr...
-	// but if you want it offsetted, it needs to be in
-	// multiples of memReqs.alignment
+	// of memory. it needs to be in multiples of
+	// memReqs.alignment, which the allocator sorts out
 
 	// filling the vertex buffer
 	// time to copy that vert data over to the freshly
@@ -1252,7 +1749,8 @@ void HelloTriangleApp::copyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDevi
 {
 	/* we've abstracted this to 
 	this->begin/endSingleTimeCommands, so this is just
-	for comment reference!
+	for comment reference! (and those are gone too now,
+	see this->uploads)
 
 	// remember - mem transfer ops are exec. in command
 	// buffers! just like drawing cmds. therefore we gotta
@@ -1317,25 +1815,37 @@ void HelloTriangleApp::copyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDevi
 	*/
 
 	// the magic of abstraction: stuffing junk away
+	// just recorded into the current upload batch, it runs
+	// whenever this->submitUploads() sends it off
 
-	auto cmdBuff = this->beginSingleTimeCommands();
+	auto cmdBuff = this->uploads.getCommandBuffer();
 
 	VkBufferCopy copyRegion = {};
 	copyRegion.size = size;
 
 	vkCmdCopyBuffer(cmdBuff, srcBuffer, dstBuffer, 1, &copyRegion);
-
-	this->endSingleTimeCommands(cmdBuff);
 }
 
-void HelloTriangleApp::transitionImageLayout(VkImage image, VkFormat format, VkImageLayout oldLayout, VkImageLayout newLayout)
+void HelloTriangleApp::transitionImageLayout(VkImage image, VkFormat format, VkImageLayout oldLayout, VkImageLayout newLayout, uint32_t mipLevels)
 {
 	// This guy handles layout transitions! in order to
 	// finish the job of making the images the correct
 	// format from our inferior input one. to a totally
 	// different one for gpu speeeeeeeeeeeeeeeeeeeeeeeeed
 
-	auto cmdBuff = this->beginSingleTimeCommands();
+	if (oldLayout == VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL && newLayout == VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL)
+	{
+		// the last step of an upload. the image might've been
+		// copied into on the transfer queue, so this is where
+		// it gets handed over to graphics (or just a plain
+		// barrier if they're the same queue)
+		this->uploads.releaseImage(image, VK_IMAGE_ASPECT_COLOR_BIT, oldLayout, newLayout, VK_ACCESS_SHADER_READ_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, mipLevels);
+		return;
+	}
+
+	// depth attachments are graphics queue only, the rest
+	// are the copy prep that can go on the transfer queue
+	auto cmdBuff = newLayout == VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL ? this->uploads.getGraphicsCommandBuffer() : this->uploads.getCommandBuffer();
 
 	// a common way to perform a layout transition is to
 	// use an Image Memory Barrier. pipeline barriers like
@@ -1375,31 +1885,35 @@ void HelloTriangleApp::transitionImageLayout(VkImage image, VkFormat format, VkI
 	}
 
 	barrier.subresourceRange.baseMipLevel = 0;
-	barrier.subresourceRange.levelCount = 1;
+	barrier.subresourceRange.levelCount = mipLevels;
 	barrier.subresourceRange.baseArrayLayer = 0;
 	barrier.subresourceRange.layerCount = 1;
 	// so that sub struct specifies the details of the img
 	// that's attached. nothing special, just magic nums
+	// (well, apart from the mip count now)
 
-	if (oldLayout == VK_IMAGE_LAYOUT_PREINITIALIZED && newLayout == VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL) 
-	{
-		barrier.srcAccessMask = VK_ACCESS_HOST_WRITE_BIT;
-		barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
-	}
-	else if (oldLayout == VK_IMAGE_LAYOUT_PREINITIALIZED && newLayout == VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL) 
+	// these used to be top of pipe -> top of pipe, which
+	// only got away with it cause every transition was
+	// followed by a vkQueueWaitIdle. now that a whole
+	// batch of copies shares one command buffer, the
+	// stages have to actually line up with who writes and
+	// who reads
+	VkPipelineStageFlags srcStage;
+	VkPipelineStageFlags dstStage;
+
+	if (oldLayout == VK_IMAGE_LAYOUT_UNDEFINED && newLayout == VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL) 
 	{
-		barrier.srcAccessMask = VK_ACCESS_HOST_WRITE_BIT;
+		barrier.srcAccessMask = 0;
 		barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-	}
-	else if (oldLayout == VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL && newLayout == VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL) 
-	{
-		barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-		barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+		srcStage = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
+		dstStage = VK_PIPELINE_STAGE_TRANSFER_BIT;
 	}
 	else if (oldLayout == VK_IMAGE_LAYOUT_UNDEFINED && newLayout == VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL) 
 	{
 		barrier.srcAccessMask = 0;
 		barrier.dstAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+		srcStage = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
+		dstStage = VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
 	}
 	else 
 	{
@@ -1415,19 +1929,20 @@ void HelloTriangleApp::transitionImageLayout(VkImage image, VkFormat format, VkI
 	// let's come back here once we've sorted out what
 	// transitions we're gonna use.
 	// so uh, here's what the conditionals are doing:
-	// Preinitialized -> Transfer src, trans reads should
-	// wait on host writes
-	// Preinitialized -> Transfer dst, trans writes should
-	// wait on host writes
+	// Undefined -> Transfer dst, trans writes don't need
+	// to wait on anything, nothing was in there (these
+	// used to be preinitialized ones, from back when the
+	// host wrote straight into a linear staging image)
 	// Transfer Destination -> Shader reading, shader read
-	// should wait on transfer writes
+	// should wait on transfer writes (that one's up top,
+	// it's this->uploads' job now)
 	// if we need more options in the future, we could
 	// expand these
 
 	vkCmdPipelineBarrier(
 		cmdBuff,
-		VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
-		VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+		srcStage,
+		dstStage,
 		0,
 		0, nullptr,
 		0, nullptr,
@@ -1444,11 +1959,9 @@ void HelloTriangleApp::transitionImageLayout(VkImage image, VkFormat format, VkI
 	// pipeline barriers of the 3 avaiable types:
 	// - Memory barriers, - Buffer memory barriers, 
 	// - Image memory barriers <- our needs!
-
-	this->endSingleTimeCommands(cmdBuff);
 }
 
-void HelloTriangleApp::createImage(uint32_t width, uint32_t height, VkFormat format, VkImageTiling tiling, VkImageUsageFlags usage, VkMemoryPropertyFlags properties, VDeleter<VkImage>& image, VDeleter<VkDeviceMemory>& imageMemory)
+void HelloTriangleApp::createImage(uint32_t width, uint32_t height, uint32_t mipLevels, VkFormat format, VkImageTiling tiling, VkImageUsageFlags usage, VkMemoryPropertyFlags properties, VImage& image, VAllocation& imageMemory)
 {
 	VkImageCreateInfo imageInfo = {};
 	imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
@@ -1456,11 +1969,13 @@ void HelloTriangleApp::createImage(uint32_t width, uint32_t height, VkFormat for
 	imageInfo.extent.width = width;
 	imageInfo.extent.height = height;
 	imageInfo.extent.depth = 1; // we'll just assume so
-	imageInfo.mipLevels = 1; // yea, assume too
+	imageInfo.mipLevels = mipLevels; // not assumed anymore!
 	imageInfo.arrayLayers = 1; // yea lol
 	imageInfo.format = format;
 	imageInfo.tiling = tiling;
-	imageInfo.initialLayout = VK_IMAGE_LAYOUT_PREINITIALIZED;
+	imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+	// nothing gets written into an image by the host anymore
+	// so there's nothing to preserve
 	imageInfo.usage = usage;
 	imageInfo.samples = VK_SAMPLE_COUNT_1_BIT; // assume
 	imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
@@ -1475,52 +1990,29 @@ void HelloTriangleApp::createImage(uint32_t width, uint32_t height, VkFormat for
 	VkMemoryRequirements memReqs;
 	vkGetImageMemoryRequirements(this->device, image, &memReqs);
 
-	VkMemoryAllocateInfo allocInfo = {};
-	allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-	allocInfo.allocationSize = memReqs.size;
-	allocInfo.memoryTypeIndex = this->findMemoryType(memReqs.memoryTypeBits, properties);
-
-	if (vkAllocateMemory(this->device, &allocInfo, nullptr, imageMemory.replace()) != VK_SUCCESS)
-	{
-		throw std::runtime_error("Couldn't allocate image memory!");
-	}
+	// linear and optimal images can't share a page (see
+	// bufferImageGranularity), the allocator keeps them
+	// apart if we tell it which this is
+	imageMemory.reset(this->allocator.allocate(memReqs, this->findMemoryType(memReqs.memoryTypeBits, properties), tiling == VK_IMAGE_TILING_LINEAR));
 
 	// dont forget this!
-	vkBindImageMemory(this->device, image, imageMemory, 0);
+	vkBindImageMemory(this->device, image, imageMemory.memory(), imageMemory.offset());
 }
 
-void HelloTriangleApp::copyImage(VkImage srcImage, VkImage dstImage, uint32_t width, uint32_t height)
+void HelloTriangleApp::copyBufferToImage(VkBuffer buffer, VkImage image, const std::vector<VkBufferImageCopy> &regions)
 {
-	auto cmdBuff = this->beginSingleTimeCommands();
-	
-	VkImageSubresourceLayers subResource = {};
-	subResource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-	subResource.baseArrayLayer = 0;
-	subResource.mipLevel = 0;
-	subResource.layerCount = 1;
-
 	// Just like with buffers, we gotta specify which part
-	// of the image needs to be copied over.
-
-	VkImageCopy region = {};
-	region.srcSubresource = subResource;
-	region.dstSubresource = subResource;
-	region.srcOffset = { 0,0,0 }; // AGH! the 3 eye'd bug!
-	region.dstOffset = { 0,0,0 }; // THERES TWO??!! NOOOO
-	region.extent.width = width;
-	region.extent.height = height;
-	region.extent.depth = 1;
-
-	vkCmdCopyImage(
-		cmdBuff,
-		srcImage, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
-		dstImage, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-		1, &region);
-	// first 2 pairs of params specify the src/dst
-	// image & layout. this assumes that they've been
-	// transferred to their optimal layout by now
-
-	this->endSingleTimeCommands(cmdBuff);
+	// of the buffer goes to which part of the image. one
+	// region per mip level (or array layer), all in one
+	// command
+
+	vkCmdCopyBufferToImage(
+		this->uploads.getCommandBuffer(),
+		buffer,
+		image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+		(uint32_t)regions.size(), regions.data());
+	// this assumes the image's been transitioned to its
+	// transfer dst layout by now
 }
 
 VkFormat HelloTriangleApp::findSupportedFormat(const std::vector<VkFormat>& candidates, VkImageTiling tiling, VkFormatFeatureFlags features)
@@ -1566,6 +2058,8 @@ bool HelloTriangleApp::hasStencilComponent(VkFormat format)
 
 void HelloTriangleApp::createDepthResources()
 {
+	NUB_PROFILE_FUNCTION();
+
 	// making a depth image is actually pretty straight-
 	// forward lol. keep same resolution as color attach.
 	// defined by the swapchain extent, an image usage
@@ -1583,8 +2077,8 @@ void HelloTriangleApp::createDepthResources()
 	// now we've got sufficient info to just invoke our
 	// already-made createImage and createImageView funcs!
 
-	this->createImage(this->swapChainExtent.width, this->swapChainExtent.height, depthFormat, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, this->depthImage, this->depthImageMemory);
-	this->createImageView(this->depthImage, depthFormat, VK_IMAGE_ASPECT_DEPTH_BIT, this->depthImageView);
+	this->createImage(this->swapChainExtent.width, this->swapChainExtent.height, 1, depthFormat, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, this->depthImage, this->depthImageMemory);
+	this->createImageView(this->depthImage, depthFormat, VK_IMAGE_ASPECT_DEPTH_BIT, 0, 1, this->depthImageView);
 	// head over to that func for a second, we need to
 	// pass it our aspectMask type too, because prevously
 	// we just assumed we'd be using it for colour
@@ -1603,7 +2097,7 @@ void HelloTriangleApp::createDepthResources()
 	// suing a pipeline barrier, cause this just needs to
 	// happen once every pass!
 
-	this->transitionImageLayout(this->depthImage, depthFormat, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL);
+	this->transitionImageLayout(this->depthImage, depthFormat, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL, 1);
 	// the undefined layout can be used as initial one, 
 	// cause there aren't any existing depth img contents
 	// that actually matter (me irl)
@@ -1614,21 +2108,29 @@ void HelloTriangleApp::createDepthResources()
 
 void HelloTriangleApp::createTextureImage()
 {
-	int texWidth, texHeight, texChannels;
-	// TODO: magical strings!
-	stbi_uc *pixels = stbi_load(TEXTURE_PATH.c_str(), &texWidth, &texHeight, &texChannels, STBI_rgb_alpha);
-	VkDeviceSize imageSize = texWidth * texHeight * 4;
-	// 4 bytes as its got the alpha component too!
+	NUB_PROFILE_FUNCTION();
 
-	if (!pixels)
+	// Hey! here from the future! a block compressed .nubtex
+	// (made offline, see --compress-texture) is a quarter to
+	// an eighth the size and already has every mip, so use
+	// that if there is one and the gpu can sample it
+	// (the jpg decode started in initVulkan() is just left
+	// to finish and get thrown away then)
+	if (this->loadCompressedTexture())
 	{
-		throw std::runtime_error("Couldn't load texture image file!");
+		return;
 	}
 
-	// This is our staging image, so its just in this
-	// function scope
-	VDeleter<VkImage> stagingImage{ this->device, vkDestroyImage };
-	VDeleter<VkDeviceMemory> stagingImageMemory{ this->device, vkFreeMemory };
+	// Hey! here from the future! stbi_load used to be right
+	// here, now it's been going on a worker thread since the
+	// start of initVulkan() (see TextureDecoder). hopefully
+	// it's done by now, otherwise this is where we wait.
+	// get() rethrows if the file couldn't be loaded
+	MipChain mips;
+	{
+		NUB_PROFILE_SCOPE("wait for texture decode");
+		mips = this->textureDecode.get();
+	}
 
 	/* Since we abstracted this to this->createImage(),
 	we don't really need this here! just for reference
@@ -1703,79 +2205,345 @@ void HelloTriangleApp::createTextureImage()
 	
 	// poof! abstraction
 
-	this->createImage(
-		texWidth, 
-		texHeight, 
-		VK_FORMAT_R8G8B8A8_UNORM, 
-		VK_IMAGE_TILING_LINEAR, 
-		VK_IMAGE_USAGE_TRANSFER_SRC_BIT, 
-		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | 
-		VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, 
-		stagingImage, 
-		stagingImageMemory);
+	this->textureWidth = mips.widths[0];
+	this->textureHeight = mips.heights[0];
 
-	// let's copy the pixel data to the staging image!
-	void *data;
-	vkMapMemory(this->device, stagingImageMemory, 0, imageSize, 0, &data);
-	memcpy(data, pixels, (size_t)imageSize);
-	vkUnmapMemory(this->device, stagingImageMemory);
+	// Hey! here from the future with mipmaps! every level's
+	// half the size of the last, all the way down to 1x1
+	this->textureMipLevels = mipLevelCount(this->textureWidth, this->textureHeight);
 
-	// free the image data!
-	stbi_image_free(pixels);
+	// the gpu can make them itself with vkCmdBlitImage, if
+	// the format supports linear blits. otherwise (or when
+	// streaming, where we need them before the top level's
+	// even on the gpu) we make them on the cpu
+	VkFormatProperties formatProps;
+	this->textureFormat = VK_FORMAT_R8G8B8A8_UNORM;
+	vkGetPhysicalDeviceFormatProperties(this->physicalDevice, this->textureFormat, &formatProps);
+	VkFormatFeatureFlags blitFeatures = VK_FORMAT_FEATURE_BLIT_SRC_BIT | VK_FORMAT_FEATURE_BLIT_DST_BIT | VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT;
+	bool gpuMips = !STREAM_TEXTURE_MIPS && (formatProps.optimalTilingFeatures & blitFeatures) == blitFeatures;
 
-	// alright, that was the staging image, now onto the
-	// real mothercucker!
+	// alright, onto the real mothercucker! (the staging
+	// buffer's made in uploadTextureLevels now)
 
 	this->createImage(
-		texWidth,
-		texHeight,
-		VK_FORMAT_R8G8B8A8_UNORM,
+		this->textureWidth,
+		this->textureHeight,
+		this->textureMipLevels,
+		this->textureFormat,
 		VK_IMAGE_TILING_OPTIMAL,
+		VK_IMAGE_USAGE_TRANSFER_SRC_BIT |
 		VK_IMAGE_USAGE_TRANSFER_DST_BIT | 
 		VK_IMAGE_USAGE_SAMPLED_BIT,
 		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
 		this->textureImage,
 		this->textureImageMemory);
 	// ooh! the USAGE_SAMPLED_BIT lets us sample the texel
-	// data from the gpu shader-side!
+	// data from the gpu shader-side! (and TRANSFER_SRC is
+	// so the blits can read the level above)
 
 	// Hey! I'm here from the future! we're now done with
 	// the following helper functions to do the layout
 	// transitioning and image copying!
 
-	this->transitionImageLayout(
-		stagingImage,
-		VK_FORMAT_R8G8B8A8_UNORM,
-		VK_IMAGE_LAYOUT_PREINITIALIZED,
-		VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL);
-
 	this->transitionImageLayout(
 		this->textureImage,
-		VK_FORMAT_R8G8B8A8_UNORM,
-		VK_IMAGE_LAYOUT_PREINITIALIZED,
-		VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
+		this->textureFormat,
+		VK_IMAGE_LAYOUT_UNDEFINED,
+		VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+		this->textureMipLevels);
+
+	// the decoder only makes the cpu mips when streaming, if
+	// the blits aren't there either they're made here after all
+	if (!gpuMips && mips.levelCount() < this->textureMipLevels)
+	{
+		MipChain topLevel = std::move(mips);
+		buildMipChain(topLevel.level(0), this->textureWidth, this->textureHeight, this->textureMipLevels, mips);
+	}
 
-	this->copyImage(stagingImage, this->textureImage, texWidth, texHeight);
+	if (gpuMips)
+	{
+		this->uploadTextureLevels(mips, 0, 1);
+
+		// blits need a graphics queue, so hand the whole image
+		// over still in transfer dst, generateMipmaps takes
+		// it from there
+		this->uploads.releaseImage(this->textureImage, VK_IMAGE_ASPECT_COLOR_BIT, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+			VK_ACCESS_TRANSFER_READ_BIT | VK_ACCESS_TRANSFER_WRITE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, this->textureMipLevels);
+		this->generateMipmaps(this->textureImage, this->textureWidth, this->textureHeight, this->textureMipLevels);
+		return;
+	}
+
+	// when streaming the top level stays behind for
+	// streamTexture() to send after the first frame
+	this->textureBaseMipLevel = STREAM_TEXTURE_MIPS && this->textureMipLevels > 1 ? 1 : 0;
+	this->uploadTextureLevels(mips, this->textureBaseMipLevel, this->textureMipLevels - this->textureBaseMipLevel);
 
 	// remember this! make it _SHADER_READ_ONLY_OPTIMAL
 	// to allow our shader to sample it!
+	this->uploads.releaseImage(this->textureImage, VK_IMAGE_ASPECT_COLOR_BIT, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+		VK_ACCESS_SHADER_READ_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, this->textureBaseMipLevel, this->textureMipLevels - this->textureBaseMipLevel);
+
+	if (this->textureBaseMipLevel > 0)
+	{
+		this->textureStreamMips = std::move(mips);
+	}
+}
+
+bool HelloTriangleApp::loadCompressedTexture()
+{
+	if (!this->bcTexturesSupported)
+	{
+		return false;
+	}
+
+	// a broken or too big file falls back to the jpg rather
+	// than failing vkCreateImage
+	VkPhysicalDeviceProperties properties;
+	vkGetPhysicalDeviceProperties(this->physicalDevice, &properties);
+
+	VkFormat format;
+	MipChain mips;
+	if (!readTextureFile(TEXTURE_COMPRESSED_PATH, properties.limits.maxImageDimension2D, format, mips))
+	{
+		return false;
+	}
+
+	// the feature bit should mean every BC format samples,
+	// but it's cheap to make sure
+	VkFormatProperties formatProps;
+	vkGetPhysicalDeviceFormatProperties(this->physicalDevice, format, &formatProps);
+	if ((formatProps.optimalTilingFeatures & VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT) == 0)
+	{
+		return false;
+	}
+
+	this->textureFormat = format;
+	this->textureWidth = mips.widths[0];
+	this->textureHeight = mips.heights[0];
+	this->textureMipLevels = mips.levelCount();
+
+	this->createImage(
+		this->textureWidth,
+		this->textureHeight,
+		this->textureMipLevels,
+		this->textureFormat,
+		VK_IMAGE_TILING_OPTIMAL,
+		VK_IMAGE_USAGE_TRANSFER_DST_BIT |
+		VK_IMAGE_USAGE_SAMPLED_BIT,
+		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+		this->textureImage,
+		this->textureImageMemory);
+
 	this->transitionImageLayout(
 		this->textureImage,
-		VK_FORMAT_R8G8B8A8_UNORM,
+		this->textureFormat,
+		VK_IMAGE_LAYOUT_UNDEFINED,
 		VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-		VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+		this->textureMipLevels);
+
+	// the blocks go up exactly as they sit in the file, no
+	// streaming though, it's small enough to just send it all
+	this->uploadTextureLevels(mips, 0, this->textureMipLevels);
+	this->uploads.releaseImage(this->textureImage, VK_IMAGE_ASPECT_COLOR_BIT, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+		VK_ACCESS_SHADER_READ_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, this->textureMipLevels);
+
+	std::cout << "texture: " << TEXTURE_COMPRESSED_PATH << ", " << this->textureWidth << "x" << this->textureHeight << ", " << this->textureMipLevels << " mips\n";
+	return true;
+}
+
+void HelloTriangleApp::uploadTextureLevels(const MipChain &mips, uint32_t baseLevel, uint32_t levelCount)
+{
+	// Hey! here from the future! this used to make a linear
+	// staging image per level and copy image to image. but
+	// linear images can be tiny size-wise on some gpus, pad
+	// their rows, and only ever have the one level. so now
+	// the levels go into one staging buffer just as they
+	// are packed in mips.pixels, and one copy with a region
+	// per level pulls them all out
+	uint32_t lastLevel = baseLevel + levelCount - 1;
+	size_t first = mips.offsets[baseLevel];
+	size_t end = mips.offsets[lastLevel] + mips.levelSize(lastLevel);
+
+	VkBuffer stagingBuff = this->uploads.stage(mips.pixels.data() + first, end - first);
+
+	std::vector<VkBufferImageCopy> regions(levelCount);
+	for (uint32_t i = 0; i < levelCount; i++)
+	{
+		uint32_t level = baseLevel + i;
+		VkBufferImageCopy &region = regions[i];
+
+		region.bufferOffset = mips.offsets[level] - first;
+		region.bufferRowLength = 0;
+		region.bufferImageHeight = 0;
+		// 0 for both means the texels are tightly packed,
+		// no padding between rows
+
+		region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+		region.imageSubresource.mipLevel = level;
+		region.imageSubresource.baseArrayLayer = 0;
+		region.imageSubresource.layerCount = 1;
+
+		region.imageOffset = { 0, 0, 0 };
+		region.imageExtent = { mips.widths[level], mips.heights[level], 1 };
+		// whole levels only, so it's fine on transfer queues
+		// with a coarse minImageTransferGranularity too
+	}
+
+	this->copyBufferToImage(stagingBuff, this->textureImage, regions);
+}
+
+void HelloTriangleApp::generateMipmaps(VkImage image, uint32_t width, uint32_t height, uint32_t mipLevels)
+{
+	// Every level gets blitted (scaled copy, with linear
+	// filtering) from the one above it. so each level has
+	// to go from transfer dst to transfer src once it's
+	// been written, and then to shader read once the next
+	// one's been made out of it
+	auto cmdBuff = this->uploads.getGraphicsCommandBuffer();
+
+	VkImageMemoryBarrier barrier = {};
+	barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+	barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.image = image;
+	barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+	barrier.subresourceRange.levelCount = 1;
+	barrier.subresourceRange.baseArrayLayer = 0;
+	barrier.subresourceRange.layerCount = 1;
+
+	int32_t levelWidth = (int32_t)width;
+	int32_t levelHeight = (int32_t)height;
+
+	for (uint32_t level = 1; level < mipLevels; level++)
+	{
+		barrier.subresourceRange.baseMipLevel = level - 1;
+		barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+		barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+		barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+		vkCmdPipelineBarrier(cmdBuff, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+		int32_t nextWidth = levelWidth > 1 ? levelWidth / 2 : 1;
+		int32_t nextHeight = levelHeight > 1 ? levelHeight / 2 : 1;
+
+		VkImageBlit blit = {};
+		blit.srcSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+		blit.srcSubresource.mipLevel = level - 1;
+		blit.srcSubresource.baseArrayLayer = 0;
+		blit.srcSubresource.layerCount = 1;
+		blit.srcOffsets[0] = { 0, 0, 0 };
+		blit.srcOffsets[1] = { levelWidth, levelHeight, 1 };
+		blit.dstSubresource = blit.srcSubresource;
+		blit.dstSubresource.mipLevel = level;
+		blit.dstOffsets[0] = { 0, 0, 0 };
+		blit.dstOffsets[1] = { nextWidth, nextHeight, 1 };
+
+		vkCmdBlitImage(
+			cmdBuff,
+			image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+			image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+			1, &blit,
+			VK_FILTER_LINEAR);
+
+		barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+		barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+		barrier.srcAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+		barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+		vkCmdPipelineBarrier(cmdBuff, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+		levelWidth = nextWidth;
+		levelHeight = nextHeight;
+	}
+
+	// and the last level, which nothing got blitted from
+	barrier.subresourceRange.baseMipLevel = mipLevels - 1;
+	barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+	barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+	barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+	vkCmdPipelineBarrier(cmdBuff, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+}
+
+void HelloTriangleApp::streamTexture()
+{
+	NUB_PROFILE_FUNCTION();
+
+	if (this->textureBaseMipLevel == 0)
+	{
+		return;
+	}
+
+	// First time through: the small mips went off with the
+	// rest of the init uploads, so the first frame can draw
+	// with those. the top level gets its own batch behind
+	// them, and nothing waits on it
+	if (this->textureTopLevelTicket == 0)
+	{
+		this->uploadTextureLevels(this->textureStreamMips, 0, 1);
+		this->uploads.releaseImage(this->textureImage, VK_IMAGE_ASPECT_COLOR_BIT, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+			VK_ACCESS_SHADER_READ_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, 1);
+		this->textureTopLevelTicket = this->submitUploads();
+		this->textureStreamMips = MipChain();
+		return;
+	}
+
+	if (!this->uploads.isComplete(this->textureTopLevelTicket))
+	{
+		return;
+	}
+
+	// It's there! swap the view for one with every level.
+	// nothing in flight can still be using the descriptor
+	// set or the old view when they're rewritten. one
+	// wait, once
+	std::vector<VkFence> fences(this->inFlightFences.begin(), this->inFlightFences.end());
+	vkWaitForFences(this->device, (uint32_t)fences.size(), fences.data(), VK_TRUE, std::numeric_limits<uint64_t>::max());
+
+	this->textureBaseMipLevel = 0;
+	this->createTextureImageView();
+
+	VkDescriptorImageInfo imageInfo = {};
+	imageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+	imageInfo.imageView = this->textureImageView;
+	imageInfo.sampler = this->textureSampler;
+
+	VkWriteDescriptorSet descWrite = {};
+	descWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+	descWrite.dstSet = this->descriptorSet;
+	descWrite.dstBinding = 1;
+	descWrite.dstArrayElement = 0;
+	descWrite.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+	descWrite.descriptorCount = 1;
+	descWrite.pImageInfo = &imageInfo;
+
+	vkUpdateDescriptorSets(this->device, 1, &descWrite, 0, nullptr);
+
+	// updating a set that's bound in a recorded command
+	// buffer invalidates the buffer, so the prerecorded
+	// ones have to be baked again. (recorded every frame,
+	// the next frame just picks the new view up)
+	if (!RECORD_EVERY_FRAME)
+	{
+		this->createCommandBuffers();
+	}
+
+	std::cout << "texture: top level streamed in, " << this->textureMipLevels << " mips\n";
 }
 
 void HelloTriangleApp::createTextureImageView()
 {
-	this->createImageView(this->textureImage, VK_FORMAT_R8G8B8A8_UNORM, VK_IMAGE_ASPECT_COLOR_BIT, this->textureImageView);
+	NUB_PROFILE_FUNCTION();
+
+	// while streaming, the view starts at the first level
+	// that's actually on the gpu
+	this->createImageView(this->textureImage, this->textureFormat, VK_IMAGE_ASPECT_COLOR_BIT, this->textureBaseMipLevel, this->textureMipLevels - this->textureBaseMipLevel, this->textureImageView);
 
 	// Let's head over to our abstracted createImageView
 	// func. stay DRY, pupper
 
 }
 
-void HelloTriangleApp::createImageView(VkImage image, VkFormat format, VkImageAspectFlags aspectFlags, VDeleter<VkImageView>& imageView)
+void HelloTriangleApp::createImageView(VkImage image, VkFormat format, VkImageAspectFlags aspectFlags, uint32_t baseMipLevel, uint32_t mipLevels, VImageView& imageView)
 {
 	// This is pretty similar to createImageViews for our
 	// swapchain actually! just a few minor differences
@@ -1787,8 +2555,8 @@ void HelloTriangleApp::createImageView(VkImage image, VkFormat format, VkImageAs
 	viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
 	viewInfo.format = format;
 	viewInfo.subresourceRange.aspectMask = aspectFlags;
-	viewInfo.subresourceRange.baseMipLevel = 0;
-	viewInfo.subresourceRange.levelCount = 1;
+	viewInfo.subresourceRange.baseMipLevel = baseMipLevel;
+	viewInfo.subresourceRange.levelCount = mipLevels;
 	viewInfo.subresourceRange.baseArrayLayer = 0;
 	viewInfo.subresourceRange.layerCount = 1;
 	// we've omitted our explicit viewInfo.components part
@@ -1810,6 +2578,8 @@ void HelloTriangleApp::createImageView(VkImage image, VkFormat format, VkImageAs
 
 void HelloTriangleApp::createTextureSampler()
 {
+	NUB_PROFILE_FUNCTION();
+
 	VkSamplerCreateInfo samplerInfo = {};
 	samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
 	samplerInfo.magFilter = VK_FILTER_LINEAR;
@@ -1844,8 +2614,11 @@ void HelloTriangleApp::createTextureSampler()
 	samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR;
 	samplerInfo.mipLodBias = 0.0f;
 	samplerInfo.minLod = 0.0f;
-	samplerInfo.maxLod = 0.0f;
+	samplerInfo.maxLod = (float)this->textureMipLevels;
 	// they're all mipmap related (discussed next time!)
+	// Hey! it's next time! maxLod lets it go all the way
+	// down the chain. the lod's relative to the view, so
+	// this still works while it starts further down
 
 	if (vkCreateSampler(this->device, &samplerInfo, nullptr, this->textureSampler.replace()) != VK_SUCCESS)
 	{
@@ -1855,6 +2628,25 @@ void HelloTriangleApp::createTextureSampler()
 
 void HelloTriangleApp::loadModel()
 {
+	NUB_PROFILE_FUNCTION();
+
+	// Hey! here from the future! parsing the obj and
+	// deduping it takes ages for big scans, so the result
+	// gets dumped to a binary cache next to it. if that's
+	// there (and the obj hasn't changed since), we just
+	// map it and upload straight out of the mapping
+	auto loadStart = std::chrono::high_resolution_clock::now();
+
+	if (this->meshCache.open(MODEL_CACHE_PATH, MODEL_PATH))
+	{
+		this->mesh = this->meshCache.getView();
+
+		auto loadEnd = std::chrono::high_resolution_clock::now();
+		std::cout << "model: warm start from " << MODEL_CACHE_PATH << " in " << std::chrono::duration<double, std::milli>(loadEnd - loadStart).count() << " ms ("
+			<< this->mesh.vertexCount << " verts, " << this->mesh.indexCount << " indices)\n";
+		return;
+	}
+
 	tinyobj::attrib_t attrib;
 	std::vector<tinyobj::shape_t> shapes;
 	std::vector<tinyobj::material_t> materials;
@@ -1876,78 +2668,154 @@ void HelloTriangleApp::loadModel()
 	}
 
 	// Let's now combine all of these faces into a single
-	// model, let's concatenate all the shapes
+	// model, let's concatenate all the shapes. it's split
+	// into chunks that get deduped across all the cores,
+	// see MeshIngest.h
+	unsigned ingestThreads = std::max(1u, std::thread::hardware_concurrency());
+	auto dedupStart = std::chrono::high_resolution_clock::now();
+
+	ingestMesh(attrib, shapes, ingestThreads, this->vertices, this->indices);
+
+	auto dedupEnd = std::chrono::high_resolution_clock::now();
+	double dedupMs = std::chrono::duration<double, std::milli>(dedupEnd - dedupStart).count();
+	std::cout << "model: dedup " << this->indices.size() << " indices -> " << this->vertices.size() << " verts in " << dedupMs << " ms on " << ingestThreads << " threads ("
+		<< this->indices.size() / (dedupMs * 1000.0) << " M indices/s)\n";
+
+	// and reorder it so the gpu gets through it quicker, the
+	// cache below stores the result so this is only paid once
+	optimizeMesh(this->vertices, this->indices);
+
+	this->mesh.vertices = this->vertices.data();
+	this->mesh.vertexCount = this->vertices.size();
+	this->mesh.indices = this->indices.data();
+	this->mesh.indexCount = this->indices.size();
 
-	std::unordered_map<Vertex, int> uniqueVerts;
+	auto loadEnd = std::chrono::high_resolution_clock::now();
+	std::cout << "model: cold start, parsed " << MODEL_PATH << " in " << std::chrono::duration<double, std::milli>(loadEnd - loadStart).count() << " ms ("
+		<< this->mesh.vertexCount << " verts, " << this->mesh.indexCount << " indices)\n";
 
-	for (const auto &shape : shapes)
+	// not being able to write it isn't the end of the
+	// world, it'll just be a cold start next time too
+	if (!MeshCache::write(MODEL_CACHE_PATH, MODEL_PATH, this->vertices, this->indices))
 	{
-		for (const auto &index : shape.mesh.indices)
-		{
-			Vertex vertex = {};
-			
-			vertex.pos = {
-				attrib.vertices[3 * index.vertex_index + 0],
-				attrib.vertices[3 * index.vertex_index + 1],
-				attrib.vertices[3 * index.vertex_index + 2]
-			};
-			// sadly, tinyobjloader's attrib.vertices 
-			// array is in floats, so it isnt a glm::vec3,
-			// which results in us having to multiply the
-			// index by 3. likewise for the tex coords
-			// below
-
-			vertex.texCoord = {
-				attrib.texcoords[2 * index.texcoord_index + 0],
-				1.0f - attrib.texcoords[2 * index.texcoord_index + 1]
-			};
-
-			vertex.norm = { 1.0f, 1.0f, 1.0f };
-			// placeholder for now lol
-
-			if (uniqueVerts.count(vertex) == 0)
-			{
-				uniqueVerts[vertex] = this->vertices.size();
-				this->vertices.push_back(vertex);
-			}
-			this->indices.push_back(uniqueVerts[vertex]);
-		}
+		std::cout << "model: couldn't write " << MODEL_CACHE_PATH << "\n";
 	}
 }
 
+void HelloTriangleApp::chooseMeshFormats()
+{
+	NUB_PROFILE_FUNCTION();
+
+	// Hey! here from the future! the mesh stays full fat on
+	// the cpu side (and in the cache), it just gets squished
+	// on its way into the staging buffers if it can be.
+	// 16 bit indices need every vert to be reachable with
+	// one, the packed verts need the gpu to read the formats
+	// and the mesh to fit in them (mostly uvs in [0, 1])
+	this->indexType = canUseShortIndices(this->mesh.vertexCount) ? VK_INDEX_TYPE_UINT16 : VK_INDEX_TYPE_UINT32;
+
+	bool packVerts = PACK_VERTICES &&
+		packedVerticesSupported(this->physicalDevice) &&
+		canPackVertices(this->mesh.vertices, this->mesh.vertexCount);
+	this->vertexFormat = packVerts ? VertexFormat::Packed : VertexFormat::Full;
+
+	size_t fullBytes = this->mesh.vertexCount * sizeof(Vertex) + this->mesh.indexCount * sizeof(uint32_t);
+	size_t usedBytes =
+		this->mesh.vertexCount * (packVerts ? sizeof(PackedVertex) : sizeof(Vertex)) +
+		this->mesh.indexCount * (this->indexType == VK_INDEX_TYPE_UINT16 ? sizeof(uint16_t) : sizeof(uint32_t));
+
+	std::cout << "model: " << (packVerts ? "packed" : "full") << " verts, " << (this->indexType == VK_INDEX_TYPE_UINT16 ? 16 : 32) << " bit indices, "
+		<< usedBytes / 1024 << " kb of " << fullBytes / 1024 << " kb\n";
+}
+
+void HelloTriangleApp::buildScene()
+{
+	NUB_PROFILE_FUNCTION();
+
+	// still just the one model, but now as many copies of
+	// it as SCENE_INSTANCES says. however many there are
+	// it's one draw, the gpu walks the instance buffer
+	this->scene.clear();
+	uint32_t model = this->scene.addMesh((uint32_t)this->mesh.indexCount, 0, 0);
+
+	// copies go a bit more than the model's widest (in
+	// xy) apart, so neighbours don't overlap
+	float minX = 0.0f, maxX = 0.0f, minY = 0.0f, maxY = 0.0f;
+	for (size_t i = 0; i < this->mesh.vertexCount; i++)
+	{
+		const glm::vec3 &pos = this->mesh.vertices[i].pos;
+		minX = i == 0 ? pos.x : std::min(minX, pos.x);
+		maxX = i == 0 ? pos.x : std::max(maxX, pos.x);
+		minY = i == 0 ? pos.y : std::min(minY, pos.y);
+		maxY = i == 0 ? pos.y : std::max(maxY, pos.y);
+	}
+	const float spacingScale = 1.25f;
+	float spacing = std::max(maxX - minX, maxY - minY) * spacingScale;
+	addInstanceGrid(this->scene, model, std::max(SCENE_INSTANCES, 1u), spacing);
+
+	// the grid's side - 1 gaps of spacing plus one model
+	// across, back the camera off by how many models wide
+	// that is so it's framed like a single one would be
+	float side = std::ceil(std::sqrt((float)std::max(SCENE_INSTANCES, 1u)));
+	this->cameraScale = (side - 1.0f) * spacingScale + 1.0f;
+
+	std::vector<InstanceData> instances;
+	this->scene.build(instances, this->drawList);
+	this->createInstanceBuffer(instances);
+
+	std::cout << "scene: " << this->scene.meshCount() << " meshes, " << instances.size() << " instances, " << this->drawList.size() << " draws\n";
+}
+
+void HelloTriangleApp::createInstanceBuffer(const std::vector<InstanceData> &instances)
+{
+	// same staging dance as the vertex buffer, it's just
+	// another vertex buffer as far as vulkan's concerned
+	VkDeviceSize buffSize = sizeof(InstanceData) * instances.size();
+	VkBuffer stagingBuff = this->uploads.stage(instances.data(), buffSize);
+
+	this->createBuffer(
+		buffSize,
+		VK_BUFFER_USAGE_TRANSFER_DST_BIT |
+		VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+		this->instanceBuffer,
+		this->instanceBufferMemory);
+
+	this->copyBuffer(stagingBuff, this->instanceBuffer, buffSize);
+	this->uploads.releaseBuffer(this->instanceBuffer, VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT, VK_PIPELINE_STAGE_VERTEX_INPUT_BIT);
+}
+
 void HelloTriangleApp::createVertexBuffer()
 {
-	VkDeviceSize buffSize = sizeof(vertices[0]) * vertices.size();
+	NUB_PROFILE_FUNCTION();
+
+	VkDeviceSize buffSize = sizeof(Vertex) * this->mesh.vertexCount;
+	const void *vertexData = this->mesh.vertices;
+
+	// only lives till stage() below has copied it
+	std::vector<PackedVertex> packedVertices;
+	if (this->vertexFormat == VertexFormat::Packed)
+	{
+		packVertices(this->mesh.vertices, this->mesh.vertexCount, packedVertices);
+		buffSize = sizeof(PackedVertex) * packedVertices.size();
+		vertexData = packedVertices.data();
+	}
 
 	// woosh! we're gonna only use a host-visible buffer
 	// as a temporary buffer and use a device local one as
 	// the actual vertex buffer
-	VDeleter<VkBuffer> stagingBuff{ this->device, vkDestroyBuffer };
-	VDeleter<VkDeviceMemory> stagingBuffMemory{ this->device, vkFreeMemory };
-
-	// just using the staging buffer first!
 
-	this->createBuffer(
-		buffSize, 
-		VK_BUFFER_USAGE_TRANSFER_SRC_BIT, 
-		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | 
-		VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, 
-		stagingBuff, 
-		stagingBuffMemory);
-
-	void *data;
-	vkMapMemory(this->device, stagingBuffMemory, 0, buffSize, 0, &data);
-	// this func lets us access a region of the specified
-	// memory resource (defined by the offset and size)
-	// (which is 0 and buffInfo.size respectively). You
-	// can also do VK_WHOLE_SIZE to map all the memory
-	// the second last param is the flags, which dont
-	// exist yet in this API version lol
-
-	// let's simply memcpy it now!
-	memcpy(data, vertices.data(), (size_t)buffSize);
-	vkUnmapMemory(this->device, stagingBuffMemory);
-	// we don't need to look at that disgrace anymore!
+	// just using the staging buffer first! the upload
+	// context makes it, memcpy's our verts in, and keeps
+	// it alive till the batch copying out of it is done
+	// (the copy doesn't run till this->submitUploads())
+
+	VkBuffer stagingBuff = this->uploads.stage(vertexData, buffSize);
+	// vkMapMemory lets us access a region of the specified
+	// memory resource (defined by the offset and size).
+	// You can also do VK_WHOLE_SIZE to map all the memory
+	// the allocator does just that, once per block, and
+	// hands back a pointer to our slice of it
 	// sadly, the driver might not copy it immediately
 	// eg cause of caching. you can deal with this & other
 	// problems by using a memory heap that is
@@ -1992,29 +2860,30 @@ void HelloTriangleApp::createVertexBuffer()
 	// the vertex buffer usage flag
 
 	this->copyBuffer(stagingBuff, this->vertexBuffer, buffSize);
+	// and hand it over to the graphics queue for vertex
+	// fetching once the copy's done
+	this->uploads.releaseBuffer(this->vertexBuffer, VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT, VK_PIPELINE_STAGE_VERTEX_INPUT_BIT);
 }
 
 void HelloTriangleApp::createIndexBuffer()
 {
-	VkDeviceSize buffSize = sizeof(indices[0]) * indices.size();
+	NUB_PROFILE_FUNCTION();
+
+	VkDeviceSize buffSize = sizeof(uint32_t) * this->mesh.indexCount;
+	const void *indexData = this->mesh.indices;
+
+	std::vector<uint16_t> shortIndices;
+	if (this->indexType == VK_INDEX_TYPE_UINT16)
+	{
+		packIndices(this->mesh.indices, this->mesh.indexCount, shortIndices);
+		buffSize = sizeof(uint16_t) * shortIndices.size();
+		indexData = shortIndices.data();
+	}
 
 	// Pretty similar to making the vert buffer!
 	// Let's make a staging buff first
 
-	VDeleter<VkBuffer> stagingBuff{ this->device, vkDestroyBuffer };
-	VDeleter<VkDeviceMemory> stagingBuffMem{ this->device, vkFreeMemory };
-	this->createBuffer(
-		buffSize, 
-		VK_BUFFER_USAGE_TRANSFER_SRC_BIT, 
-		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | 
-		VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, 
-		stagingBuff, 
-		stagingBuffMem);
-
-	void *data;
-	vkMapMemory(this->device, stagingBuffMem, 0, buffSize, 0, &data);
-	memcpy(data, indices.data(), (size_t)buffSize);
-	vkUnmapMemory(this->device, stagingBuffMem);
+	VkBuffer stagingBuff = this->uploads.stage(indexData, buffSize);
 
 	// just like the vert buffer this is the real gpu buff
 	this->createBuffer(
@@ -2029,6 +2898,7 @@ void HelloTriangleApp::createIndexBuffer()
 
 	this->copyBuffer(stagingBuff, this->indexBuffer, buffSize);
 	// dont forget to actually copy the staging buff over!
+	this->uploads.releaseBuffer(this->indexBuffer, VK_ACCESS_INDEX_READ_BIT, VK_PIPELINE_STAGE_VERTEX_INPUT_BIT);
 
 	// now just head over to this->createCommandBuffers();
 	// to bind this newly alloc'd index buffer!
@@ -2036,31 +2906,51 @@ void HelloTriangleApp::createIndexBuffer()
 
 void HelloTriangleApp::createUniformBuffer()
 {
-	VkDeviceSize buffSize = sizeof(UniformBufferObject);
+	NUB_PROFILE_FUNCTION();
 
-	this->createBuffer(
-		buffSize, 
-		VK_BUFFER_USAGE_TRANSFER_SRC_BIT, 
-		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | 
-		VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, 
-		this->uniformStagingBuffer, 
-		this->uniformStagingBufferMemory);
+	// A uniform ring! one host visible buffer carved into
+	// slots, one per frame in flight. every draw shares
+	// its frame's matrices, the per instance ones are in
+	// the instance buffer. every slot has to start on a
+	// multiple of minUniformBufferOffsetAlignment for
+	// dynamic offsets to be legal, so round the ubo size
+	// up to that
+	VkPhysicalDeviceProperties properties;
+	vkGetPhysicalDeviceProperties(this->physicalDevice, &properties);
+	VkDeviceSize alignment = properties.limits.minUniformBufferOffsetAlignment;
+
+	this->uniformSlotSize = sizeof(UniformBufferObject);
+	if (alignment > 0)
+	{
+		this->uniformSlotSize = (this->uniformSlotSize + alignment - 1) & ~(alignment - 1);
+	}
+
+	VkDeviceSize buffSize = this->uniformSlotSize * MAX_FRAMES_IN_FLIGHT;
 
 	this->createBuffer(
 		buffSize, 
-		VK_BUFFER_USAGE_TRANSFER_DST_BIT | 
 		VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, 
-		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, 
+		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | 
+		VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, 
 		this->uniformBuffer, 
 		this->uniformBufferMemory);
 	//Standard stuff!
 
+	// and map it once, for good. the allocator keeps its
+	// block mapped till it's freed, so a frame's ubo
+	// update is literally a memcpy. being host coherent
+	// there's no flushing either; vkQueueSubmit makes host
+	// writes visible to the gpu by itself
+	this->uniformBufferMapped = this->uniformBufferMemory.map();
+
 	// Head off to this->updateUniformBuffer() which is
 	// gonna be called in the main loop!
 }
 
 void HelloTriangleApp::createDescriptorPool()
 {
+	NUB_PROFILE_FUNCTION();
+
 	// This sets up the descriptors that'll be bound
 	// we're gonna make a descriptor set too (not here!)
 	// Descriptor sets cant be made directly, they have to
@@ -2070,7 +2960,7 @@ void HelloTriangleApp::createDescriptorPool()
 	// combined image sampler descriptor!
 
 	std::array<VkDescriptorPoolSize, 2> poolSizes = {};
-	poolSizes[0].type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+	poolSizes[0].type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
 	poolSizes[0].descriptorCount = 1;
 	poolSizes[1].type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
 	poolSizes[1].descriptorCount = 1;
@@ -2082,6 +2972,8 @@ void HelloTriangleApp::createDescriptorPool()
 	poolInfo.poolSizeCount = poolSizes.size();
 	poolInfo.pPoolSizes = poolSizes.data();
 	poolInfo.maxSets = 1;
+	// just the one set, frames pick their ubo slot with a
+	// dynamic offset at bind time
 	
 	if (vkCreateDescriptorPool(this->device, &poolInfo, nullptr, this->descriptorPool.replace()) != VK_SUCCESS)
 	{
@@ -2091,6 +2983,8 @@ void HelloTriangleApp::createDescriptorPool()
 
 void HelloTriangleApp::createDescriptorSet()
 {
+	NUB_PROFILE_FUNCTION();
+
 	// You need to specify the pool to allocate from!
 
 	VkDescriptorSetLayout layouts[] = { this->descriptorSetLayout };
@@ -2113,6 +3007,8 @@ void HelloTriangleApp::createDescriptorSet()
 	buffInfo.buffer = this->uniformBuffer;
 	buffInfo.offset = 0;
 	buffInfo.range = sizeof(UniformBufferObject);
+	// offset stays 0, the dynamic offset gets added on top
+	// of it when binding. range is just one slot's worth
 	
 	// You update these descriptors using vkUpdateDescSets
 	// which takes an array of vkWriteDescSet as a param
@@ -2133,7 +3029,7 @@ void HelloTriangleApp::createDescriptorSet()
 	descWrites[0].dstSet = this->descriptorSet;
 	descWrites[0].dstBinding = 0;
 	descWrites[0].dstArrayElement = 0;
-	descWrites[0].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+	descWrites[0].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
 	descWrites[0].descriptorCount = 1;
 	descWrites[0].pBufferInfo = &buffInfo;
 	// first 2 params set it to our descSet, and set the
@@ -2156,6 +3052,8 @@ void HelloTriangleApp::createDescriptorSet()
 
 void HelloTriangleApp::createCommandBuffers()
 {
+	NUB_PROFILE_FUNCTION();
+
 	// Howdy fellow kids! I'm here from recreateSwapChain,
 	// and here i'm just checking if our cmd buff vec
 	// already has previous buffers; if so, let's get rid/
@@ -2164,8 +3062,23 @@ void HelloTriangleApp::createCommandBuffers()
 	{
 		vkFreeCommandBuffers(this->device, this->commandPool, this->commandBuffers.size(), this->commandBuffers.data());
 	}
+	for (const auto &secondaries : this->secondaryCommandBuffers)
+	{
+		this->recorder.free(secondaries);
+	}
+
+	// nothing to bake, drawFrame() records what it needs
+	// every frame, see recordFrame()
+	if (RECORD_EVERY_FRAME)
+	{
+		return;
+	}
 
-	this->commandBuffers.resize(this->swapChainFramebuffers.size());
+	// every frame in flight gets a buffer per framebuffer,
+	// since each one binds its own slot of the ubo ring
+	size_t imageCount = this->swapChainFramebuffers.size();
+	this->commandBuffers.resize(MAX_FRAMES_IN_FLIGHT * imageCount);
+	this->secondaryCommandBuffers.assign(this->commandBuffers.size(), std::vector<VkCommandBuffer>());
 
 	VkCommandBufferAllocateInfo allocInfo = {};
 	allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
@@ -2186,145 +3099,286 @@ void HelloTriangleApp::createCommandBuffers()
 
 	// we begin recording a command buff by calling
 	// vkBeginCommandBuffer.
-	for (size_t i = 0; i < this->commandBuffers.size(); i++)
-	{
-		VkCommandBufferBeginInfo begInfo = {};
-		begInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
-		begInfo.flags = VK_COMMAND_BUFFER_USAGE_SIMULTANEOUS_USE_BIT;
-		begInfo.pInheritanceInfo = nullptr; // optional
-		// for the flags param, it specifies how we're gon
-		// use the command buff, you could do:
-		// _one_time_submit_bit - the buff will be
-		// re-recorded right after exec. it once
-		// _render_pass_continue_bit - this is a secondary
-		// command buff that will be entirely within a
-		// single render pass
-		// simultaneous_use_bit - the buff can be
-		// re-submitted while it's also already pending an
-		// execution
-
-		// weeoooo weeeooooo
-		vkBeginCommandBuffer(this->commandBuffers[i], &begInfo);
-
-		VkRenderPassBeginInfo rendPassInfo = {};
-		rendPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
-		rendPassInfo.renderPass = this->renderPass;
-		rendPassInfo.framebuffer = this->swapChainFramebuffers[i];
-
-		rendPassInfo.renderArea.offset = { 0,0 }; // ey
-		rendPassInfo.renderArea.extent = this->swapChainExtent;
-
-		// Hey! here from the future with depth testing
-		std::array<VkClearValue, 2> clearValues = {};
-		clearValues[0].color = { 0.0f, 0.0f, 0.0f, 1.0f };
-		clearValues[1].depthStencil = { 1.0f, 0 };
-		// the range for the depth buffer is 0.0 to 1.0!
-		// dont forget! 1.0f is at the far plane.
-		// the initial value should be the furthest
-		// possible value
-
-		rendPassInfo.clearValueCount = clearValues.size();
-		rendPassInfo.pClearValues = clearValues.data();
-
-		// ooh
-		vkCmdBeginRenderPass(this->commandBuffers[i], &rendPassInfo, VK_SUBPASS_CONTENTS_INLINE);
-		// the render pass can now commence!
-		// all of the funcs that record commands can be
-		// recognised by their vkCmd prefix. they all
-		// return void, so no error handling till we're
-		// done! this is the risky life, my camaraderie
-		// by the way, _inline means that the renderpass
-		// commands will be embedded in the primary cmd
-		// buffer itself and no secondary buff will be
-		// executed. _secondary_command_buffers - the cmds
-		// will be executed from secondary command buffs
-		
-		// Basic drawing commands:
-		// I put it in this stupid scope block just to
-		// let you know that you're an idiot, and this is
-		// recording commands to the command buffer
+	for (size_t cmd = 0; cmd < this->commandBuffers.size(); cmd++)
+	{
+		size_t frame = cmd / imageCount;
+		uint32_t imageIndex = (uint32_t)(cmd % imageCount);
+		this->secondaryCommandBuffers[cmd] = this->recordCommandBuffer(this->commandBuffers[cmd], 0, frame, imageIndex, 0);
+	}
+}
+
+std::vector<VkCommandBuffer> HelloTriangleApp::recordCommandBuffer(VkCommandBuffer cmdBuff, VkCommandBufferUsageFlags usage, size_t frame, uint32_t imageIndex, uint32_t poolSet)
+{
+	VkCommandBufferBeginInfo begInfo = {};
+	begInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+	begInfo.flags = usage;
+	begInfo.pInheritanceInfo = nullptr; // optional
+	// we used to need _simultaneous_use_ here, but the
+	// in-flight fences now guarantee a buffer is done
+	// before its frame slot comes around again
+	// for the flags param, it specifies how we're gon
+	// use the command buff, you could do:
+	// _one_time_submit_bit - the buff will be
+	// re-recorded right after exec. it once
+	// _render_pass_continue_bit - this is a secondary
+	// command buff that will be entirely within a
+	// single render pass
+	// simultaneous_use_bit - the buff can be
+	// re-submitted while it's also already pending an
+	// execution
+
+	// weeoooo weeeooooo
+	vkBeginCommandBuffer(cmdBuff, &begInfo);
+
+	// the frame slot's gpu timings (read back in
+	// drawFrame() once its fence comes round again).
+	// the queries have to be reset outside the pass
+	this->frameProfiler.resetSlot(cmdBuff, (uint32_t)frame);
+	uint32_t renderPassScope = this->frameProfiler.beginScope(cmdBuff, (uint32_t)frame, "render pass", true);
+
+	VkRenderPassBeginInfo rendPassInfo = {};
+	rendPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+	rendPassInfo.renderPass = this->renderPass;
+	rendPassInfo.framebuffer = this->swapChainFramebuffers[imageIndex];
+
+	rendPassInfo.renderArea.offset = { 0,0 }; // ey
+	rendPassInfo.renderArea.extent = this->swapChainExtent;
+
+	// Hey! here from the future with depth testing
+	std::array<VkClearValue, 2> clearValues = {};
+	clearValues[0].color = { 0.0f, 0.0f, 0.0f, 1.0f };
+	clearValues[1].depthStencil = { 1.0f, 0 };
+	// the range for the depth buffer is 0.0 to 1.0!
+	// dont forget! 1.0f is at the far plane.
+	// the initial value should be the furthest
+	// possible value
+
+	rendPassInfo.clearValueCount = clearValues.size();
+	rendPassInfo.pClearValues = clearValues.data();
+
+	// ooh
+	vkCmdBeginRenderPass(cmdBuff, &rendPassInfo, VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
+	// the render pass can now commence!
+	// all of the funcs that record commands can be
+	// recognised by their vkCmd prefix. they all
+	// return void, so no error handling till we're
+	// done! this is the risky life, my camaraderie
+	// by the way, _inline means that the renderpass
+	// commands will be embedded in the primary cmd
+	// buffer itself and no secondary buff will be
+	// executed. _secondary_command_buffers - the cmds
+	// will be executed from secondary command buffs
+	
+	// Hey! here from the future! the draws are recorded
+	// into secondary buffers on a few threads at once
+	// now (see recordDraws() & ParallelRecorder), so the
+	// render pass is _secondary_command_buffers and all
+	// the primary does is run them
+	VkCommandBufferInheritanceInfo inheritance = {};
+	inheritance.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+	inheritance.renderPass = this->renderPass;
+	inheritance.subpass = 0;
+	inheritance.framebuffer = this->swapChainFramebuffers[imageIndex];
+	// they run inside the profiler's statistics query
+	inheritance.pipelineStatistics = this->frameProfiler.statisticsFlags();
+
+	std::vector<VkCommandBuffer> secondaries = this->recorder.record(inheritance, this->drawList.size(), [this, frame](VkCommandBuffer secondary, size_t firstDraw, size_t endDraw)
+	{
+		this->recordDraws(secondary, frame, firstDraw, endDraw);
+	}, poolSet);
+
+	if (!secondaries.empty())
+	{
+		vkCmdExecuteCommands(cmdBuff, (uint32_t)secondaries.size(), secondaries.data());
+	}
+
+	// just to remind you: we're not actually executing these yet, just
+	// recording them, numbolini
+	vkCmdEndRenderPass(cmdBuff);
+	this->frameProfiler.endScope(cmdBuff, (uint32_t)frame, renderPassScope);
+
+	if (vkEndCommandBuffer(cmdBuff) != VK_SUCCESS)
+	{
+		throw std::runtime_error("Failed to record command buffer!");
+	}
+
+	return secondaries;
+}
+
+VkCommandBuffer HelloTriangleApp::recordFrame(uint32_t imageIndex)
+{
+	NUB_PROFILE_FUNCTION();
+
+	// Hey! here from the future! instead of a buffer per
+	// [frame][image] baked up front, this frame slot's
+	// buffers get recorded fresh every frame, so the draw
+	// list can be different every time. we only get here
+	// once the slot's fence is through, so nothing the gpu
+	// still needs is touched
+	auto start = std::chrono::high_resolution_clock::now();
+
+	size_t frame = this->currentFrame;
+	VkCommandPool pool = this->frameCommandPools[frame];
+	VkCommandBuffer &cmdBuff = this->frameCommandBuffers[frame];
+
+	if (RESET_FRAME_POOLS)
+	{
+		// one call per pool recycles everything recorded
+		// from this slot last time round, the buffers stay
+		// allocated and just get begun again
+		vkResetCommandPool(this->device, pool, 0);
+		this->recorder.reset((uint32_t)frame);
+	}
+	else
+	{
+		// the way it'd go without: give every buffer back
+		// and allocate fresh ones
+		if (cmdBuff != VK_NULL_HANDLE)
 		{
-			// sticky!
-			vkCmdBindPipeline(this->commandBuffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, this->graphicsPipeline);
-			// that second enum param specifies whether
-			// the pipeline object is a compute or
-			// graphics pipeline
-
-			// Heyo! I'm visiting from
-			// this->createVertexBuffer();!
-			VkBuffer vertBuffers[] = { this->vertexBuffer };
-			VkDeviceSize offsets[] = { 0 };
-			vkCmdBindVertexBuffers(this->commandBuffers[i], 0, 1, vertBuffers, offsets);
-			// that vkCmd func is used to bind vertex
-			// buffers to bindings. Like the one we set up
-			// previously. after that first param, the 
-			// next 2 specify the offset & num of bindings
-			// we're going to specify vertex buffers for.
-			// the last 2 params specify the array of
-			// vert buffers to bind and the byte offsets
-			// to initially read from. also, down there,
-			// vkCmdDraw should be changed by now to pass
-			// the num of vertices in the buffer instead
-			// of our magical 3 lol
-
-			// Hey! I'm from the future! here to bind the
-			// index buffer as well!
-			vkCmdBindIndexBuffer(this->commandBuffers[i], this->indexBuffer, 0, VK_INDEX_TYPE_UINT32);
-
-			// Ey mang, I'm from this->createDescriptorSet
-			// to actually bind the desc. set to the 
-			// descriptors in the shader!
-			vkCmdBindDescriptorSets(this->commandBuffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, this->pipelineLayout, 0, 1, &this->descriptorSet, 0, nullptr);
-			// But! unlike shaders (vert, frag etc.),
-			// desc sets are not unique to the pipeline!
-			// so we need to specify if we want to bind
-			// the desc sets to the graphics or compute
-			// pipeline!
-			// the next param after that is the layout
-			// that the descs. are based on. the next
-			// three params specify the index of the first
-			// desc set, the number of sets to bind, and
-			// the array of sets to bind.
-			// PS: head over to createGraphicsPipeline
-			// to fix a little thing we did when we 
-			// flipped the clip-Y coords for MVP matrices
-
-			// the moment you've been waiting for,
-			// duh, duh luh duh duh duh, duh luh duh duh
-			// duh duh duh duh duh duh duh! duh dillie duh
-			// duh dillie duh dillie duh di di duh
-			// *breath*
-
-			//vkCmdDraw(this->commandBuffers[i], vertices.size(), 1, 0, 0);
-			// oh
-			// well, since we've done so much just now -
-			// specifying all the parameters for the
-			// pipeline, how to present it etc, this part
-			// is just pure ease
-			// those params by the way; are specifying the
-			// vertex count, instance count, first vert
-			// offset, and first instance offset
-
-			// we're drawing an indexed version now!
-			vkCmdDrawIndexed(this->commandBuffers[i], indices.size(), 1, 0, 0, 0);
-			// just 1 instance, offset of 0 to begin with,
-			// an offset of 0 per index, and an offset of
-			// 0 for instancing, which wont be used atm
+			vkFreeCommandBuffers(this->device, pool, 1, &cmdBuff);
+			cmdBuff = VK_NULL_HANDLE;
 		}
+		this->recorder.free(this->frameSecondaryCommandBuffers[frame], (uint32_t)frame);
+	}
+	this->frameSecondaryCommandBuffers[frame].clear();
 
-		// just to remind you: we're not actually executing these yet, just
-		// recording them, numbolini
-		vkCmdEndRenderPass(this->commandBuffers[i]);
+	if (cmdBuff == VK_NULL_HANDLE)
+	{
+		VkCommandBufferAllocateInfo allocInfo = {};
+		allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+		allocInfo.commandPool = pool;
+		allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+		allocInfo.commandBufferCount = 1;
 
-		if (vkEndCommandBuffer(this->commandBuffers[i]) != VK_SUCCESS)
+		if (vkAllocateCommandBuffers(this->device, &allocInfo, &cmdBuff) != VK_SUCCESS)
 		{
-			throw std::runtime_error("Failed to record command buffer!");
+			throw std::runtime_error("Couldn't allocate a frame command buffer!");
 		}
 	}
+
+	// the secondaries come out of this slot's set of the
+	// recorder's pools
+	this->frameSecondaryCommandBuffers[frame] = this->recordCommandBuffer(cmdBuff, VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT, frame, imageIndex, (uint32_t)frame);
+
+	auto end = std::chrono::high_resolution_clock::now();
+	this->recordCounters.frames++;
+	this->recordCounters.recordMs += std::chrono::duration<double, std::milli>(end - start).count();
+
+	return cmdBuff;
 }
 
-void HelloTriangleApp::createSemaphores()
+void HelloTriangleApp::recordDraws(VkCommandBuffer cmdBuff, size_t frame, size_t firstDraw, size_t endDraw)
 {
+	// Basic drawing commands:
+	// (these used to go straight into the primary buffer,
+	// now a few threads at once each get a slice of the
+	// draw list and their own secondary buffer, see
+	// ParallelRecorder. secondaries don't inherit a thing
+	// so every one binds & sets it all again)
+
+	// sticky!
+	vkCmdBindPipeline(cmdBuff, VK_PIPELINE_BIND_POINT_GRAPHICS, this->graphicsPipeline);
+	// that second enum param specifies whether
+	// the pipeline object is a compute or
+	// graphics pipeline
+
+	// the pipeline doesn't know the window size
+	// anymore, so tell it here
+	VkViewport viewport = {};
+	viewport.x = 0.0f;
+	viewport.y = 0.0f;
+	viewport.width = (float)this->swapChainExtent.width;
+	viewport.height = (float)this->swapChainExtent.height;
+	viewport.minDepth = 0.0f;
+	viewport.maxDepth = 1.0f;
+	// haha oh my god, depth buffering didnt work
+	// because these two little shits were switched
+	// around. 0 to 1.0 is normal
+	vkCmdSetViewport(cmdBuff, 0, 1, &viewport);
+
+	// What region of pixels will be stored
+	VkRect2D scissor = {};
+	scissor.offset = { 0,0 }; // hoo, hoo, I'm an owl
+	scissor.extent = this->swapChainExtent;
+	vkCmdSetScissor(cmdBuff, 0, 1, &scissor);
+
+	// Heyo! I'm visiting from
+	// this->createVertexBuffer();!
+	VkBuffer vertBuffers[] = { this->vertexBuffer, this->instanceBuffer };
+	VkDeviceSize offsets[] = { 0, 0 };
+	vkCmdBindVertexBuffers(cmdBuff, 0, 2, vertBuffers, offsets);
+	// that vkCmd func is used to bind vertex
+	// buffers to bindings. Like the one we set up
+	// previously. after that first param, the 
+	// next 2 specify the offset & num of bindings
+	// we're going to specify vertex buffers for.
+	// the last 2 params specify the array of
+	// vert buffers to bind and the byte offsets
+	// to initially read from. also, down there,
+	// vkCmdDraw should be changed by now to pass
+	// the num of vertices in the buffer instead
+	// of our magical 3 lol
+	// (future me: the second one is the instance
+	// buffer, see buildScene())
+
+	// Hey! I'm from the future! here to bind the
+	// index buffer as well!
+	vkCmdBindIndexBuffer(cmdBuff, this->indexBuffer, 0, this->indexType);
+
+	// Ey mang, I'm from this->createDescriptorSet
+	// to actually bind the desc. set to the 
+	// descriptors in the shader!
+	uint32_t dynamicOffset = this->uniformOffset(frame);
+	vkCmdBindDescriptorSets(cmdBuff, VK_PIPELINE_BIND_POINT_GRAPHICS, this->pipelineLayout, 0, 1, &this->descriptorSet, 1, &dynamicOffset);
+	// But! unlike shaders (vert, frag etc.),
+	// desc sets are not unique to the pipeline!
+	// so we need to specify if we want to bind
+	// the desc sets to the graphics or compute
+	// pipeline!
+	// the next param after that is the layout
+	// that the descs. are based on. the next
+	// three params specify the index of the first
+	// desc set, the number of sets to bind, and
+	// the array of sets to bind. the last 2 are the
+	// dynamic offsets, one per dynamic descriptor,
+	// which picks this frame's slot in the ubo ring
+	// PS: head over to createGraphicsPipeline
+	// to fix a little thing we did when we 
+	// flipped the clip-Y coords for MVP matrices
+
+	// the moment you've been waiting for,
+	// duh, duh luh duh duh duh, duh luh duh duh
+	// duh duh duh duh duh duh duh! duh dillie duh
+	// duh dillie duh dillie duh di di duh
+	// *breath*
+
+	//vkCmdDraw(cmdBuff, vertices.size(), 1, 0, 0);
+	// oh
+	// well, since we've done so much just now -
+	// specifying all the parameters for the
+	// pipeline, how to present it etc, this part
+	// is just pure ease
+	// those params by the way; are specifying the
+	// vertex count, instance count, first vert
+	// offset, and first instance offset
+
+	// we're drawing an indexed version now! (and a
+	// whole slice of the draw list, future me says)
+	for (size_t draw = firstDraw; draw < endDraw; draw++)
+	{
+		const DrawCommand &command = this->drawList[draw];
+		vkCmdDrawIndexed(cmdBuff, command.indexCount, command.instanceCount, command.firstIndex, command.vertexOffset, command.firstInstance);
+	}
+	// every copy of the mesh in one go, the draw's
+	// own range of the index buffer, its offset per
+	// index, and where its instances start in the
+	// instance buffer
+}
+
+void HelloTriangleApp::createSyncObjects()
+{
+	NUB_PROFILE_FUNCTION();
+
 	// heh, you gotta do the usual "creation struct args",
 	// but at this point in time, the api just needs you
 	// to specify its type lol
@@ -2332,15 +3386,32 @@ void HelloTriangleApp::createSemaphores()
 	VkSemaphoreCreateInfo semInfo = {};
 	semInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
 
-	if (vkCreateSemaphore(this->device, &semInfo, nullptr, this->imageAvailableSemaphore.replace()) != VK_SUCCESS ||
-		vkCreateSemaphore(this->device, &semInfo, nullptr, this->renderFinishedSemaphore.replace()) != VK_SUCCESS)
+	// fences are for the cpu to wait on, we start them
+	// signalled so the very first wait on each frame slot
+	// doesn't hang forever
+	VkFenceCreateInfo fenceInfo = {};
+	fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+	fenceInfo.flags = VK_FENCE_CREATE_SIGNALED_BIT;
+
+	resizeHandles(this->imageAvailableSemaphores, MAX_FRAMES_IN_FLIGHT, this->device);
+	resizeHandles(this->renderFinishedSemaphores, MAX_FRAMES_IN_FLIGHT, this->device);
+	resizeHandles(this->inFlightFences, MAX_FRAMES_IN_FLIGHT, this->device);
+
+	for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
 	{
-		throw std::runtime_error("Couldn't create semaphores!");
+		if (vkCreateSemaphore(this->device, &semInfo, nullptr, this->imageAvailableSemaphores[i].replace()) != VK_SUCCESS ||
+			vkCreateSemaphore(this->device, &semInfo, nullptr, this->renderFinishedSemaphores[i].replace()) != VK_SUCCESS ||
+			vkCreateFence(this->device, &fenceInfo, nullptr, this->inFlightFences[i].replace()) != VK_SUCCESS)
+		{
+			throw std::runtime_error("Couldn't create frame sync objects!");
+		}
 	}
 }
 
 void HelloTriangleApp::updateUniformBuffer()
 {
+	NUB_PROFILE_FUNCTION();
+
 	// Updated each frame!
 	static auto startTime = std::chrono::high_resolution_clock::now();
 
@@ -2351,26 +3422,27 @@ void HelloTriangleApp::updateUniformBuffer()
 	// This is where we define our MVP matrices!
 	UniformBufferObject ubo = {};
 	ubo.model = glm::rotate(glm::mat4(), time * glm::radians(10.0f), glm::vec3(0.0f, 0.0f, 1.0f));
-	ubo.view = glm::lookAt(glm::vec3(1.0f, 4.0f, 2.0f), glm::vec3(0.0f, 0.0f, 0.25f), glm::vec3(0.0f, 0.0f, 1.0f));
-	ubo.proj = glm::perspective(glm::radians(25.0f), this->swapChainExtent.width / (float)this->swapChainExtent.height, 0.1f, 1000.0f);
+	ubo.view = glm::lookAt(glm::vec3(1.0f, 4.0f, 2.0f) * this->cameraScale, glm::vec3(0.0f, 0.0f, 0.25f), glm::vec3(0.0f, 0.0f, 1.0f));
+	ubo.proj = glm::perspective(glm::radians(25.0f), this->swapChainExtent.width / (float)this->swapChainExtent.height, 0.1f * this->cameraScale, 1000.0f * this->cameraScale);
 
 	// right then. GLM was designed for opengl, and VK has
 	// inverted Y clip coords
 	ubo.proj[1][1] *= -1;
 
-	// Passing it to vulkan! not very efficient though!
-	void *data;
-	vkMapMemory(this->device, this->uniformStagingBufferMemory, 0, sizeof(ubo), 0, &data);
-	memcpy(data, &ubo, sizeof(ubo));
-	vkUnmapMemory(this->device, this->uniformStagingBufferMemory);
-
-	this->copyBuffer(this->uniformStagingBuffer, this->uniformBuffer, sizeof(ubo));
+	// Passing it to vulkan! straight into this frame's slot
+	// of the persistently mapped ring. no map/unmap, no
+	// staging copy, no submit. the other slots may still be
+	// getting read by the gpu, so hands off those
+	char *slot = static_cast<char *>(this->uniformBufferMapped) + this->uniformOffset(this->currentFrame);
+	memcpy(slot, &ubo, sizeof(ubo));
 	// If you want per-frame uploading of data, try using
 	// Push Constants. may cover later :(
 }
 
 void HelloTriangleApp::drawFrame()
 {
+	NUB_PROFILE_FUNCTION();
+
 	// Here's a brief overview of what this drawfunc will
 	// do:
 	// acquire an image in the swap chain
@@ -2396,17 +3468,51 @@ void HelloTriangleApp::drawFrame()
 	// are used to sync operations within or across
 	// command queues. so it's more appropriate here.
 
+	// Frames in flight! before touching anything that
+	// belongs to this frame slot (its ubo, command buffers
+	// and semaphores), wait till the gpu's done with the
+	// last frame that used it. the other slot(s) can still
+	// be chugging along on the gpu meanwhile
+	// (the texture's top level sneaks in here, before
+	// this frame's fence gets reset, see streamTexture)
+	this->streamTexture();
+
+	VkFence frameFence = this->inFlightFences[this->currentFrame];
+	{
+		NUB_PROFILE_SCOPE("wait for frame slot");
+		vkWaitForFences(this->device, 1, &frameFence, VK_TRUE, std::numeric_limits<uint64_t>::max());
+	}
+	this->completedFrames = std::max(this->completedFrames, this->inFlightFrameNumbers[this->currentFrame]);
+
+	// the slot's last frame is done, so its gpu timings
+	// are in. reading them now can't stall
+	this->collectFrameTimings(this->currentFrame);
+
+	// good a place as any to free staging buffers of
+	// uploads the gpu's done with, and whatever old
+	// swapchains no frame is using anymore
+	this->uploads.retireCompleted();
+	this->destroyRetiredSwapChains(false);
+
 	// Hey, I'm here from the future! (recreateSwapChain)
 	// let's aquire the return value of vkAcNextImgKHR
 
-	uint32_t imageIndex;
-	auto result = vkAcquireNextImageKHR(
-		this->device, 
-		this->swapChain, 
-		std::numeric_limits<uint64_t>::max(), 
-		this->imageAvailableSemaphore, 
-		VK_NULL_HANDLE, 
-		&imageIndex);
+	// headless has an offscreen image per frame slot, so
+	// there's nothing to acquire, the slot's image is free
+	// as soon as its fence is
+	uint32_t imageIndex = (uint32_t)this->currentFrame;
+	auto result = VK_SUCCESS;
+	if (!this->headless)
+	{
+		NUB_PROFILE_SCOPE("vkAcquireNextImageKHR");
+		result = vkAcquireNextImageKHR(
+			this->device,
+			this->swapChain,
+			std::numeric_limits<uint64_t>::max(),
+			this->imageAvailableSemaphores[this->currentFrame],
+			VK_NULL_HANDLE,
+			&imageIndex);
+	}
 	// third param specifies a timeout in ns for an image
 	// to become available using the max value of a 64 bit
 	// uint to disable the timeout
@@ -2432,15 +3538,21 @@ void HelloTriangleApp::drawFrame()
 		throw std::runtime_error("Couldn't acquire a swapchain image!");
 	}
 
+	// only reset once we know we're actually submitting,
+	// else an early return above would leave it unsignalled
+	vkResetFences(this->device, 1, &frameFence);
+
+	this->updateUniformBuffer();
+
 	// submitting the command buffer
 
 	// let's config our queue submission and syncing
 	VkSubmitInfo submitInfo = {};
 	submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
 
-	VkSemaphore waitSemaphores[] = { this->imageAvailableSemaphore };
+	VkSemaphore waitSemaphores[] = { this->imageAvailableSemaphores[this->currentFrame] };
 	VkPipelineStageFlags waitStages[] = { VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT };
-	submitInfo.waitSemaphoreCount = 1;
+	submitInfo.waitSemaphoreCount = this->headless ? 0 : 1;
 	submitInfo.pWaitSemaphores = waitSemaphores;
 	submitInfo.pWaitDstStageMask = waitStages;
 	// the three params specify which semaphores to wait
@@ -2455,25 +3567,45 @@ void HelloTriangleApp::drawFrame()
 	// the waitStages array corresponds to the semaphore
 	// with the same index in pWaitSemaphores
 
+	VkCommandBuffer cmdBuff = RECORD_EVERY_FRAME ?
+		this->recordFrame(imageIndex) :
+		this->commandBuffers[this->currentFrame * this->swapChainFramebuffers.size() + imageIndex];
+
 	submitInfo.commandBufferCount = 1;
-	submitInfo.pCommandBuffers = &this->commandBuffers[imageIndex];
+	submitInfo.pCommandBuffers = &cmdBuff;
 	// these params specify which command buffers to
 	// actually submit for execution. we should submit
 	// the command buffer that corresponds/binds to the
-	// swapchain image
+	// swapchain image (and to this frame's ubo)
 
-	VkSemaphore signalSemaphores[] = { this->renderFinishedSemaphore };
-	submitInfo.signalSemaphoreCount = 1;
+	VkSemaphore signalSemaphores[] = { this->renderFinishedSemaphores[this->currentFrame] };
+	submitInfo.signalSemaphoreCount = this->headless ? 0 : 1;
 	submitInfo.pSignalSemaphores = signalSemaphores;
 	// these specify which semaphores to signal once the
 	// command buffer(s) are done
+	// (none of either headless, no acquire or present)
 
-	if (vkQueueSubmit(this->graphicsQueue, 1, &submitInfo, VK_NULL_HANDLE) != VK_SUCCESS)
+	if (vkQueueSubmit(this->graphicsQueue, 1, &submitInfo, frameFence) != VK_SUCCESS)
 	{
 		throw std::runtime_error("Couldn't submit draw command buffer!");
 	}
+	this->frameProfiler.submitted((uint32_t)this->currentFrame);
+	this->submitCounters.submits++;
+	this->submittedFrames++;
+	this->inFlightFrameNumbers[this->currentFrame] = this->submittedFrames;
 	// the last optional arg specifies a fence that will
-	// be signalled upon completion
+	// be signalled upon completion. that's the one we wait
+	// on up top when this frame slot comes back around
+
+	if (this->headless)
+	{
+		// nothing's presented, the submit's the closest
+		// thing there is to it
+		this->markPresented();
+		this->lastImageIndex = imageIndex;
+		this->currentFrame = (this->currentFrame + 1) % MAX_FRAMES_IN_FLIGHT;
+		return;
+	}
 
 	// subpass dependencies
 	// hey idiot, remember that those subpasses in the
@@ -2516,13 +3648,17 @@ void HelloTriangleApp::drawFrame()
 	// Poof! I'm also here from recreateSwapChain,
 	// lets get that return val too!
 
-	result = vkQueuePresentKHR(this->presentQueue, &presentInfo);
+	{
+		NUB_PROFILE_SCOPE("vkQueuePresentKHR");
+		result = vkQueuePresentKHR(this->presentQueue, &presentInfo);
+	}
+	this->markPresented();
 	// oh man
 	// submits the request to present an image
 	// I ain't gonna accept your request unless you say
 	// please, you nutbag
 
-	if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR)
+	if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR || this->framebufferResized)
 	{
 		this->recreateSwapChain();
 	}
@@ -2530,22 +3666,117 @@ void HelloTriangleApp::drawFrame()
 	{
 		throw std::runtime_error("Couldn't present swapchain image!");
 	}
+
+	this->currentFrame = (this->currentFrame + 1) % MAX_FRAMES_IN_FLIGHT;
+}
+
+void HelloTriangleApp::collectFrameTimings(size_t frame)
+{
+	// whichever frame last ran in this slot, before the
+	// next submit overwrites its number
+	if (!this->frameProfiler.collect((uint32_t)frame))
+	{
+		return;
+	}
+	if (GPU_PROFILE_EVERY_FRAME)
+	{
+		this->frameProfiler.printLatest(std::cout);
+	}
+
+	for (const GpuScopeResult &result : this->frameProfiler.latest())
+	{
+		if (result.name == "render pass")
+		{
+			this->frameStats.setGpuTime(this->inFlightFrameNumbers[frame], result.ms);
+		}
+	}
+}
+
+void HelloTriangleApp::markPresented()
+{
+	// present to present's what the user actually sees,
+	// a hitch shows up here whether the cpu or the gpu
+	// (or the compositor) was the one that caused it
+	auto now = std::chrono::high_resolution_clock::now();
+	this->lastPresentIntervalMs = this->presentedOnce ? std::chrono::duration<double, std::milli>(now - this->lastPresent).count() : 0.0;
+	this->lastPresent = now;
+	this->presentedOnce = true;
 }
 
 void HelloTriangleApp::recreateSwapChain()
 {
-	vkDeviceWaitIdle(device);
-	// we shouldnt touch resources that may still be used
+	NUB_PROFILE_FUNCTION();
+
+	// Hey! here from the future! no more vkDeviceWaitIdle
+	// up here. it drained the whole gpu on every resize,
+	// now the old stuff's just moved out of the way into
+	// a RetiredSwapChain and new stuff made next to it.
+	// frames in flight keep on using the old stuff, and
+	// destroyRetiredSwapChains() gets rid of it once
+	// their fences say they're done
+
+	// minimised, there's nothing to make a swapchain for.
+	// framebufferResized stays set so we try again next
+	// frame
+	int width, height;
+	glfwGetWindowSize(this->window, &width, &height);
+	if (width == 0 || height == 0)
+	{
+		this->framebufferResized = true;
+		return;
+	}
+	this->framebufferResized = false;
 
-	this->createSwapChain();
+	RetiredSwapChain retired(this->allocator);
+	retired.lastFrame = this->submittedFrames;
+	retired.swapChain = this->swapChain.release();
+	for (auto &imageView : this->swapChainImageViews)
+	{
+		retired.imageViews.push_back(imageView.release());
+	}
+	this->swapChainImageViews.clear();
+	for (auto &framebuffer : this->swapChainFramebuffers)
+	{
+		retired.framebuffers.push_back(framebuffer.release());
+	}
+	this->swapChainFramebuffers.clear();
+	retired.depthImageView = this->depthImageView.release();
+	retired.depthImage = this->depthImage.release();
+	retired.depthImageMemory = std::move(this->depthImageMemory);
+	retired.commandBuffers.swap(this->commandBuffers);
+	retired.secondaryCommandBuffers.swap(this->secondaryCommandBuffers);
+
+	VkFormat oldImageFormat = this->swapChainImageFormat;
+
+	// the old swapchain goes in as oldSwapchain, so the
+	// driver can hand its resources over to the new one
+	this->createSwapChain(retired.swapChain);
 	this->createImageViews();
-	this->createRenderPass();
-	this->createGraphicsPipeline();
+
+	// Hey! here from the future! the viewport & scissor are
+	// dynamic now, so the pipeline & render pass don't
+	// care about the size and live on through resizes. only
+	// if the surface format changed (moved to an hdr
+	// monitor, say) do they have to be remade
+	if (this->swapChainImageFormat != oldImageFormat)
+	{
+		retired.pipeline = this->graphicsPipeline.release();
+		retired.pipelineLayout = this->pipelineLayout.release();
+		retired.renderPass = this->renderPass.release();
+		this->createRenderPass();
+		this->createGraphicsPipeline();
+	}
+
 	this->createDepthResources();
 	this->createFrameBuffers();
 	this->createCommandBuffers();
+	// the depth image's layout transition got recorded as
+	// an upload, send it before the next frame's draws
+	this->submitUploads();
 
-	// the really handy VDeleter implements proper RAII
+	this->retiredSwapChains.push_back(std::move(retired));
+
+	// the really handy VHandle implements proper RAII
 	// so, most of the funcs will work A-OK for re-
 	// creation & will auto clean up older objects. But,
 	// this->createSwapChain(); & 
@@ -2555,6 +3786,50 @@ void HelloTriangleApp::recreateSwapChain()
 	// we set up our static onWindowResize() callback
 }
 
+void HelloTriangleApp::destroyRetiredSwapChains(bool everything)
+{
+	NUB_PROFILE_FUNCTION();
+
+	// everything is for shutting down, after a device idle
+	while (!this->retiredSwapChains.empty() && (everything || this->retiredSwapChains.front().lastFrame <= this->completedFrames))
+	{
+		RetiredSwapChain &retired = this->retiredSwapChains.front();
+
+		if (!retired.commandBuffers.empty())
+		{
+			vkFreeCommandBuffers(this->device, this->commandPool, (uint32_t)retired.commandBuffers.size(), retired.commandBuffers.data());
+		}
+		for (const auto &secondaries : retired.secondaryCommandBuffers)
+		{
+			this->recorder.free(secondaries);
+		}
+		for (VkFramebuffer framebuffer : retired.framebuffers)
+		{
+			vkDestroyFramebuffer(this->device, framebuffer, nullptr);
+		}
+		for (VkImageView imageView : retired.imageViews)
+		{
+			vkDestroyImageView(this->device, imageView, nullptr);
+		}
+		vkDestroyImageView(this->device, retired.depthImageView, nullptr);
+		vkDestroyImage(this->device, retired.depthImage, nullptr);
+		vkDestroyPipeline(this->device, retired.pipeline, nullptr);
+		vkDestroyPipelineLayout(this->device, retired.pipelineLayout, nullptr);
+		vkDestroyRenderPass(this->device, retired.renderPass, nullptr);
+		// its images were all presented & waited on by now
+		vkDestroySwapchainKHR(this->device, retired.swapChain, nullptr);
+
+		// (depthImageMemory goes back to the allocator here)
+		this->retiredSwapChains.pop_front();
+	}
+}
+
+uint32_t HelloTriangleApp::uniformOffset(size_t frame)
+{
+	// where frame's ubo lives in the ring
+	return (uint32_t)(frame * this->uniformSlotSize);
+}
+
 bool QueueFamilyIndices::isComplete()
 {
 	return this->graphicsFamily >= 0 && this->presentFamily >= 0;
@@ -2562,13 +3837,71 @@ bool QueueFamilyIndices::isComplete()
 
 void HelloTriangleApp::loop()
 {
+	// little frame time log, printed about once a second
+	auto logStart = std::chrono::high_resolution_clock::now();
+	auto lastFrame = logStart;
+	double worstFrameMs = 0.0;
+	uint32_t loggedFrames = 0;
+	SubmitCounters loggedCounters = this->submitCounters;
+	RecordCounters loggedRecordCounters = this->recordCounters;
+
 	while (!glfwWindowShouldClose(this->window))
 	{
+		NUB_PROFILE_SCOPE("frame");
+		auto frameStart = std::chrono::high_resolution_clock::now();
+		uint64_t submittedBefore = this->submittedFrames;
 		glfwPollEvents();
 
-		this->updateUniformBuffer();
 		// finally, some good hardcore action
+		// (the ubo update lives in drawFrame now, it has
+		// to wait for its frame slot to free up first)
 		this->drawFrame();
+
+		auto now = std::chrono::high_resolution_clock::now();
+		// a frame that bailed out to recreate the swapchain
+		// never made it to the screen, so it isn't one
+		if (this->submittedFrames != submittedBefore)
+		{
+			FrameSample sample;
+			sample.frame = this->submittedFrames;
+			sample.cpuMs = std::chrono::duration<double, std::milli>(now - frameStart).count();
+			sample.presentIntervalMs = this->lastPresentIntervalMs;
+			this->frameStats.add(sample);
+		}
+		if (this->frameStatsRequested)
+		{
+			this->frameStatsRequested = false;
+			this->writeFrameStats();
+		}
+
+		double frameMs = std::chrono::duration<double, std::milli>(now - lastFrame).count();
+		lastFrame = now;
+		worstFrameMs = std::max(worstFrameMs, frameMs);
+		loggedFrames++;
+
+		double elapsedMs = std::chrono::duration<double, std::milli>(now - logStart).count();
+		if (elapsedMs >= 1000.0)
+		{
+			std::cout << "frame time: avg " << elapsedMs / loggedFrames << " ms, worst " << worstFrameMs << " ms (" << loggedFrames << " frames, " << MAX_FRAMES_IN_FLIGHT << " in flight)\n";
+			std::cout << "\tper frame: " << (double)(this->submitCounters.submits - loggedCounters.submits) / loggedFrames << " queue submits, " << (double)(this->submitCounters.queueWaitIdles - loggedCounters.queueWaitIdles) / loggedFrames << " queue idle waits\n";
+			loggedCounters = this->submitCounters;
+
+			uint64_t recordedFrames = this->recordCounters.frames - loggedRecordCounters.frames;
+			if (recordedFrames > 0)
+			{
+				std::cout << "\trecording: avg " << (this->recordCounters.recordMs - loggedRecordCounters.recordMs) / recordedFrames << " ms per frame ("
+					<< (RESET_FRAME_POOLS ? "reset pools" : "free & reallocate") << ", " << this->drawList.size() << " draws of " << this->scene.instanceCount() << " instances)\n";
+			}
+			loggedRecordCounters = this->recordCounters;
+
+			this->frameProfiler.printAverages(std::cout);
+			this->uploadProfiler.printAverages(std::cout);
+			this->frameProfiler.resetAverages();
+			this->uploadProfiler.resetAverages();
+			logStart = now;
+			worstFrameMs = 0.0;
+			loggedFrames = 0;
+		}
 	}
 
 	// remember y'nubhead - all the operations in that
@@ -2576,6 +3909,125 @@ void HelloTriangleApp::loop()
 	// shut down, we need to make sure everything's
 	// cleaner than an abortion clinic
 	vkDeviceWaitIdle(this->device);
+	this->submitCounters.queueWaitIdles++;
+
+	// the last frames in flight's gpu times are in now
+	for (size_t frame = 0; frame < MAX_FRAMES_IN_FLIGHT; frame++)
+	{
+		this->collectFrameTimings(frame);
+	}
+	this->writeFrameStats();
+
+	this->destroyRetiredSwapChains(true);
+	this->savePipelineCache();
+	this->writeCpuTrace();
+}
+
+void HelloTriangleApp::loopHeadless(uint32_t frameCount, const std::string &dumpPath)
+{
+	// Same drawFrame() as the windowed loop, just a fixed
+	// number of times as fast as it'll go, so runs can be
+	// compared with each other. the frame stats keep the
+	// last FRAME_STATS_CAPACITY frames' times, same as the
+	// windowed loop, and sum them up at the end
+	// (the first frame pays for the texture streaming in
+	// and everything being cold, so it's kept out of them)
+	double firstFrameMs = 0.0;
+
+	auto start = std::chrono::high_resolution_clock::now();
+	for (uint32_t frame = 0; frame < frameCount; frame++)
+	{
+		NUB_PROFILE_SCOPE("frame");
+		auto frameStart = std::chrono::high_resolution_clock::now();
+		this->drawFrame();
+		double cpuMs = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - frameStart).count();
+
+		if (frame == 0)
+		{
+			firstFrameMs = cpuMs;
+			continue;
+		}
+		FrameSample sample;
+		sample.frame = this->submittedFrames;
+		sample.cpuMs = cpuMs;
+		sample.presentIntervalMs = this->lastPresentIntervalMs;
+		this->frameStats.add(sample);
+	}
+
+	// the last MAX_FRAMES_IN_FLIGHT frames are only
+	// submitted so far, count their gpu time too
+	vkDeviceWaitIdle(this->device);
+	this->submitCounters.queueWaitIdles++;
+	double totalMs = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+	for (size_t frame = 0; frame < MAX_FRAMES_IN_FLIGHT; frame++)
+	{
+		this->collectFrameTimings(frame);
+	}
+
+	VkPhysicalDeviceProperties properties;
+	vkGetPhysicalDeviceProperties(this->physicalDevice, &properties);
+	std::cout << "headless: " << frameCount << " frames at " << this->swapChainExtent.width << "x" << this->swapChainExtent.height << " on " << properties.deviceName
+		<< " in " << totalMs << " ms (" << (totalMs > 0.0 ? frameCount * 1000.0 / totalMs : 0.0) << " fps)\n";
+
+	std::cout << "\tfirst frame: " << firstFrameMs << " ms\n";
+	if (this->recordCounters.frames > 0)
+	{
+		std::cout << "\trecording: avg " << this->recordCounters.recordMs / this->recordCounters.frames << " ms per frame\n";
+	}
+
+	// every frame's (and upload batch's) gpu side, the
+	// last few frames were collected after the idle
+	this->uploads.retireCompleted();
+	this->frameProfiler.printAverages(std::cout);
+	this->uploadProfiler.printAverages(std::cout);
+
+	if (!dumpPath.empty())
+	{
+		this->dumpFrame(this->lastImageIndex, dumpPath);
+	}
+
+	this->savePipelineCache();
+	this->writeCpuTrace();
+	this->writeFrameStats();
+}
+
+void HelloTriangleApp::writeCpuTrace()
+{
+	// everything NUB_PROFILE_SCOPE caught, startup and
+	// every frame, on every thread. nothing at all if it's
+	// compiled out
+	if (CpuProfiler::eventCount() == 0)
+	{
+		return;
+	}
+
+	if (CpuProfiler::writeChromeTrace(CPU_TRACE_PATH))
+	{
+		std::cout << "cpu trace: " << CpuProfiler::eventCount() << " scopes written to " << CPU_TRACE_PATH << " (open in ui.perfetto.dev or chrome://tracing)\n";
+	}
+	else
+	{
+		std::cerr << "Couldn't write the cpu trace to " << CPU_TRACE_PATH << "!\n";
+	}
+}
+
+void HelloTriangleApp::writeFrameStats()
+{
+	if (this->frameStats.size() == 0)
+	{
+		return;
+	}
+
+	std::cout << "frame stats: last " << this->frameStats.size() << " frames\n";
+	this->frameStats.print(std::cout);
+	if (this->frameStats.writeCsv(FRAME_STATS_PATH))
+	{
+		std::cout << "\twritten to " << FRAME_STATS_PATH << "\n";
+	}
+	else
+	{
+		std::cerr << "Couldn't write the frame stats to " << FRAME_STATS_PATH << "!\n";
+	}
 }
 
 // a thousand SLOC, and we just rendered a multi coloured triangle. amazing
\ No newline at end of file
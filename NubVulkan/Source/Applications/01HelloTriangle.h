@@ -4,7 +4,19 @@
 #include <GLFW/glfw3.h>
 
 #include <Util/Constants.h>
-#include <Util/VDeleter.h>
+#include <Util/VHandle.h>
+#include <Util/MemoryAllocator.h>
+#include <Util/UploadContext.h>
+#include <Util/MeshCache.h>
+#include <Util/PipelineCache.h>
+#include <Util/TextureMips.h>
+#include <Util/TextureFile.h>
+#include <Util/TextureDecoder.h>
+#include <Util/ParallelRecorder.h>
+#include <Util/Scene.h>
+#include <Util/GpuProfiler.h>
+#include <Util/CpuProfiler.h>
+#include <Util/FrameStats.h>
 
 #include <iostream>
 #include <stdexcept>
@@ -16,6 +28,7 @@
 #include <fstream>
 #include <chrono>
 #include <unordered_map>
+#include <deque>
 
 #define GLM_FORCE_RADIANS
 #define GLM_FORCE_DEPTH_ZERO_TO_ONE // 0.0 - 1.0 instead of GL's -1.0 - 0.0
@@ -26,10 +39,52 @@ struct QueueFamilyIndices
 {
 	int graphicsFamily = -1;
 	int presentFamily = -1;
+	// Optional, -1 if there's no family besides graphics that can copy
+	int transferFamily = -1;
 
 	bool isComplete();
 };
 
+// Running totals of how often we hit the queue, the frame time log
+// diffs these to show per-frame costs
+struct SubmitCounters
+{
+	uint64_t submits = 0;
+	// every vkQueueWaitIdle & vkDeviceWaitIdle, none of which
+	// should be happening per frame any more
+	uint64_t queueWaitIdles = 0;
+};
+
+// Same idea for the time recordFrame() spends
+struct RecordCounters
+{
+	uint64_t frames = 0;
+	double recordMs = 0.0;
+};
+
+// Everything a swapchain recreation replaced. frames still in flight
+// can be using any of it, so it hangs around till they're done (see
+// destroyRetiredSwapChains()). pipeline, layout & render pass are only
+// set if the surface format changed
+struct RetiredSwapChain
+{
+	RetiredSwapChain(MemoryAllocator &allocator) : depthImageMemory(allocator) {}
+
+	// The last frame submitted before it was retired
+	uint64_t lastFrame = 0;
+	VkSwapchainKHR swapChain = VK_NULL_HANDLE;
+	std::vector<VkImageView> imageViews;
+	std::vector<VkFramebuffer> framebuffers;
+	VkImage depthImage = VK_NULL_HANDLE;
+	VkImageView depthImageView = VK_NULL_HANDLE;
+	VAllocation depthImageMemory;
+	std::vector<VkCommandBuffer> commandBuffers;
+	std::vector<std::vector<VkCommandBuffer>> secondaryCommandBuffers;
+	VkPipeline pipeline = VK_NULL_HANDLE;
+	VkPipelineLayout pipelineLayout = VK_NULL_HANDLE;
+	VkRenderPass renderPass = VK_NULL_HANDLE;
+};
+
 struct SwapChainSupportDetails
 {
 	VkSurfaceCapabilitiesKHR capabilities;
@@ -41,6 +96,13 @@ class HelloTriangleApp
 {
 public:
 	void run();
+	// Sets everything up like run() does, then times recording a draw
+	// list of drawCount draws on 1, 2, 4... threads instead of drawing
+	void benchmarkRecording(size_t drawCount);
+	// No window, no surface, no swapchain: renders frameCount (>= 1) frames
+	// into offscreen images, prints frame time stats, and writes the
+	// last frame to dumpPath (a .ppm) if it's not empty
+	void runHeadless(uint32_t frameCount, const std::string &dumpPath);
 
 protected:
 
@@ -55,6 +117,7 @@ private:
 	VkSurfaceFormatKHR chooseSwapSurfaceFormat(const std::vector<VkSurfaceFormatKHR> &availableFormats);
 	VkPresentModeKHR chooseSwapPresentMode(const std::vector<VkPresentModeKHR> availablePresentModes);
 	void createLogicalDevice();
+	void createAllocator();
 	bool checkValidationLayerSupport();
 	std::vector<const char *> getRequiredExtensions();
 	static VKAPI_ATTR VkBool32 VKAPI_CALL debugCallback(VkDebugReportFlagsEXT flags, VkDebugReportObjectTypeEXT objType, uint64_t obj, size_t location, int32_t code, const char* layerPrefix, const char* msg, void* userData);
@@ -64,106 +127,228 @@ private:
 	static std::vector<char> readFile(const std::string &fileName);
 	uint32_t findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties);
 	static void onWindowResized(GLFWwindow *window, int width, int height);
-	void createShaderModule(const std::vector<char> &code, VDeleter<VkShaderModule> &shaderModule);
-	void createSwapChain();
+	static void onKey(GLFWwindow *window, int key, int scancode, int action, int mods);
+	void createShaderModule(const std::vector<char> &code, VShaderModule &shaderModule);
+	void createSwapChain(VkSwapchainKHR oldSwapChain = VK_NULL_HANDLE);
+	void createOffscreenTargets();
+	void dumpFrame(uint32_t imageIndex, const std::string &path);
 	void createInstance();
 	void createSurface();
 	void createImageViews();
 	void createRenderPass();
 	void createDescriptorSetLayout();
 	void createGraphicsPipeline();
+	void createPipelineCache();
+	void savePipelineCache();
 	void createFrameBuffers();
 	void createCommandPool();
-	VkCommandBuffer beginSingleTimeCommands();
-	void endSingleTimeCommands(VkCommandBuffer cmdBuff);
-	void createBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, VDeleter<VkBuffer> &buff, VDeleter<VkDeviceMemory> &buffMemory);
+	UploadTicket submitUploads();
+	void createBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, VBuffer &buff, VAllocation &buffMemory);
 	void copyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size);
-	void transitionImageLayout(VkImage image, VkFormat format, VkImageLayout oldLayout, VkImageLayout newLayout);
-	void createImage(uint32_t width, uint32_t height, VkFormat format, VkImageTiling tiling, VkImageUsageFlags usage, VkMemoryPropertyFlags properties, VDeleter<VkImage> &image, VDeleter<VkDeviceMemory> &imageMemory);
-	void copyImage(VkImage srcImage, VkImage dstImage, uint32_t width, uint32_t height);
+	void transitionImageLayout(VkImage image, VkFormat format, VkImageLayout oldLayout, VkImageLayout newLayout, uint32_t mipLevels);
+	void createImage(uint32_t width, uint32_t height, uint32_t mipLevels, VkFormat format, VkImageTiling tiling, VkImageUsageFlags usage, VkMemoryPropertyFlags properties, VImage &image, VAllocation &imageMemory);
+	void copyBufferToImage(VkBuffer buffer, VkImage image, const std::vector<VkBufferImageCopy> &regions);
 	VkFormat findSupportedFormat(const std::vector<VkFormat> &candidates, VkImageTiling tiling, VkFormatFeatureFlags features);
 	VkFormat findDepthFormat();
 	bool hasStencilComponent(VkFormat format);
 	void createDepthResources();
 	void createTextureImage();
+	bool loadCompressedTexture();
+	void uploadTextureLevels(const MipChain &mips, uint32_t baseLevel, uint32_t levelCount);
+	void generateMipmaps(VkImage image, uint32_t width, uint32_t height, uint32_t mipLevels);
+	void streamTexture();
 	void createTextureImageView();
-	void createImageView(VkImage image, VkFormat format, VkImageAspectFlags aspectFlags, VDeleter<VkImageView> &imageView);
+	void createImageView(VkImage image, VkFormat format, VkImageAspectFlags aspectFlags, uint32_t baseMipLevel, uint32_t mipLevels, VImageView &imageView);
 	void createTextureSampler();
 	void loadModel();
+	void chooseMeshFormats();
+	void buildScene();
+	void createInstanceBuffer(const std::vector<InstanceData> &instances);
 	void createVertexBuffer();
 	void createIndexBuffer();
 	void createUniformBuffer();
 	void createDescriptorPool();
 	void createDescriptorSet();
 	void createCommandBuffers();
-	void createSemaphores();
+	std::vector<VkCommandBuffer> recordCommandBuffer(VkCommandBuffer cmdBuff, VkCommandBufferUsageFlags usage, size_t frame, uint32_t imageIndex, uint32_t poolSet);
+	void recordDraws(VkCommandBuffer cmdBuff, size_t frame, size_t firstDraw, size_t endDraw);
+	VkCommandBuffer recordFrame(uint32_t imageIndex);
+	void createSyncObjects();
 	void updateUniformBuffer();
+	uint32_t uniformOffset(size_t frame);
 	void drawFrame();
+	void collectFrameTimings(size_t frame);
+	void markPresented();
 	void recreateSwapChain();
+	void destroyRetiredSwapChains(bool everything);
 	void loop();
+	void loopHeadless(uint32_t frameCount, const std::string &dumpPath);
+	void writeCpuTrace();
+	void writeFrameStats();
 
-	GLFWwindow *window;
+	GLFWwindow *window = nullptr;
+	// Set by runHeadless(), everything window/surface/swapchain is
+	// skipped and createOffscreenTargets() stands in for the swapchain
+	bool headless = false;
 	
-	VDeleter<VkInstance> instance{ vkDestroyInstance };
-	VDeleter<VkDebugReportCallbackEXT> callback{instance, DestroyDebugReportCallbackEXT};
-	VDeleter<VkSurfaceKHR> surface{ instance, vkDestroySurfaceKHR };
+	VInstance instance;
+	VDebugReportCallback callback{ instance };
+	VSurface surface{ instance };
 	
 	// Automatically deallocated/deleted upon VkInstance deletion, yay
 	VkPhysicalDevice physicalDevice = VK_NULL_HANDLE;
-	VDeleter<VkDevice> device{ vkDestroyDevice };
+	// textureCompressionBC, turned on in createLogicalDevice() if it's there
+	bool bcTexturesSupported = false;
+	// pipelineStatisticsQuery & inheritedQueries, both or neither
+	bool pipelineStatisticsSupported = false;
+	VDevice device;
 
 	VkQueue graphicsQueue;
 	VkQueue presentQueue;
+	// Same as graphicsQueue if there's no separate transfer family
+	VkQueue transferQueue;
+
+	// Every buffer & image's memory comes out of here. has to outlive
+	// all of them, but go before the device does
+	MemoryAllocator allocator;
+	// Times each upload batch on the transfer queue, has to outlive uploads
+	GpuProfiler uploadProfiler{ device };
+	// Batches up staging copies & layout transitions, see submitUploads()
+	UploadContext uploads{ device, allocator };
 
-	VDeleter<VkSwapchainKHR> swapChain{ device, vkDestroySwapchainKHR };
+	VSwapchain swapChain{ device };
 	// Also cleaned up by VkSwapchain deletion, yea buddy
 	std::vector<VkImage> swapChainImages;
 	VkFormat swapChainImageFormat;
 	VkExtent2D swapChainExtent;
-	std::vector<VDeleter<VkImageView>> swapChainImageViews;
-	std::vector<VDeleter<VkFramebuffer>> swapChainFramebuffers;
+	std::vector<VImageView> swapChainImageViews;
+	std::vector<VFramebuffer> swapChainFramebuffers;
+	// Headless: what swapChainImages points at instead, one per frame in
+	// flight. lastImageIndex is whichever was rendered to last
+	std::vector<VImage> offscreenImages;
+	std::vector<VAllocation> offscreenImageMemory;
+	uint32_t lastImageIndex = 0;
 
-	VDeleter<VkRenderPass> renderPass{ device, vkDestroyRenderPass };
+	VRenderPass renderPass{ device };
 	// must be before pipelineLayout for proper RAII!
-	VDeleter<VkDescriptorSetLayout> descriptorSetLayout{ device, vkDestroyDescriptorSetLayout };
-	VDeleter<VkPipelineLayout> pipelineLayout{ device, vkDestroyPipelineLayout };
-	VDeleter<VkPipeline> graphicsPipeline{ device, vkDestroyPipeline };
+	VDescriptorSetLayout descriptorSetLayout{ device };
+	VPipelineLayout pipelineLayout{ device };
+	VPipeline graphicsPipeline{ device };
+	// Every pipeline's made through this, loaded from & saved back to
+	// PIPELINE_CACHE_PATH. 0 loaded bytes means we started cold
+	VPipelineCache pipelineCache{ device };
+	size_t pipelineCacheLoadedBytes = 0;
 
-	VDeleter<VkCommandPool> commandPool{ device, vkDestroyCommandPool };
+	VCommandPool commandPool{ device };
 	
-	VDeleter<VkImage> depthImage{ device, vkDestroyImage };
-	VDeleter<VkDeviceMemory> depthImageMemory{ device, vkFreeMemory };
-	VDeleter<VkImageView> depthImageView{ device, vkDestroyImageView };
+	VImage depthImage{ device };
+	VAllocation depthImageMemory{ allocator };
+	VImageView depthImageView{ device };
+
+	VImage textureImage{ device };
+	VAllocation textureImageMemory{ allocator };
+	VImageView textureImageView{ device };
+	VSampler textureSampler{ device };
+	// R8G8B8A8_UNORM, or a BC format if loadCompressedTexture() worked
+	VkFormat textureFormat = VK_FORMAT_R8G8B8A8_UNORM;
+	uint32_t textureWidth = 0;
+	uint32_t textureHeight = 0;
+	uint32_t textureMipLevels = 1;
+	// Streaming (see STREAM_TEXTURE_MIPS): the view starts at this level
+	// till the top level's uploaded, which waits in textureStreamMips
+	// and is in flight once textureTopLevelTicket's set
+	uint32_t textureBaseMipLevel = 0;
+	MipChain textureStreamMips;
+	UploadTicket textureTopLevelTicket = 0;
 
-	VDeleter<VkImage> textureImage{ device, vkDestroyImage };
-	VDeleter<VkDeviceMemory> textureImageMemory{ device, vkFreeMemory };
-	VDeleter<VkImageView> textureImageView{ device, vkDestroyImageView };
-	VDeleter<VkSampler> textureSampler{ device, vkDestroySampler };
+	// initVulkan()'s steps & the decode workers' jobs, printed once
+	// everything's set up. has to outlive textureDecoder
+	TextureDecoder textureDecoder;
+	// Kicked off at the top of initVulkan(), picked up by
+	// createTextureImage()
+	std::future<MipChain> textureDecode;
 
+	// Only filled on a cold start, otherwise mesh points into meshCache
 	std::vector<Vertex> vertices;
 	std::vector<uint32_t> indices;
+	MeshCache meshCache;
+	MeshView mesh;
+	// What mesh gets turned into on the gpu, see chooseMeshFormats()
+	VertexFormat vertexFormat = VertexFormat::Full;
+	VkIndexType indexType = VK_INDEX_TYPE_UINT32;
 
 	// Needs to be in this order! memory will free once buff is destroyed
-	VDeleter<VkBuffer> vertexBuffer{ device, vkDestroyBuffer };
-	VDeleter<VkDeviceMemory> vertexBufferMemory{ device, vkFreeMemory };
-	VDeleter<VkBuffer> indexBuffer{ device, vkDestroyBuffer };
-	VDeleter<VkDeviceMemory> indexBufferMemory{ device, vkFreeMemory };
-
-	// The staging buffs need to stay around cause we'll be updating it
-	// every frame
-	VDeleter<VkBuffer> uniformStagingBuffer{ device, vkDestroyBuffer };
-	VDeleter<VkDeviceMemory> uniformStagingBufferMemory{ device, vkFreeMemory };
-	VDeleter<VkBuffer> uniformBuffer{ device, vkDestroyBuffer };
-	VDeleter<VkDeviceMemory> uniformBufferMemory{ device, vkFreeMemory };
+	VBuffer vertexBuffer{ device };
+	VAllocation vertexBufferMemory{ allocator };
+	VBuffer indexBuffer{ device };
+	VAllocation indexBufferMemory{ allocator };
+	// Every instance's transform, bound as the second vertex binding
+	VBuffer instanceBuffer{ device };
+	VAllocation instanceBufferMemory{ allocator };
+
+	// Host visible ring of ubo slots, mapped for its whole life. each
+	// frame in flight writes its own slot, so we never scribble over a
+	// ubo the gpu is still reading
+	VBuffer uniformBuffer{ device };
+	VAllocation uniformBufferMemory{ allocator };
+	void *uniformBufferMapped = nullptr;
+	VkDeviceSize uniformSlotSize = 0;
 	
-	VDeleter<VkDescriptorPool> descriptorPool{ device, vkDestroyDescriptorPool };
+	VDescriptorPool descriptorPool{ device };
 	// auto free'd when pool is gone
 	VkDescriptorSet descriptorSet;
 
+	// What's in the world, and the draws it boils down to (one per
+	// mesh), split between the recording threads
+	Scene scene;
+	std::vector<DrawCommand> drawList;
+	// How far the camera backs off so the whole scene's in view
+	float cameraScale = 1.0f;
+	// A command pool per recording thread
+	ParallelRecorder recorder{ device };
+	// Times the render pass on the gpu, a slot per frame in flight
+	GpuProfiler frameProfiler{ device };
+
 	// Each one holds record of our commands. Auto free'd when pool is gone
+	// laid out as [frame in flight][swapchain image]
 	std::vector<VkCommandBuffer> commandBuffers;
+	// The secondaries each of those runs, one per recording thread
+	std::vector<std::vector<VkCommandBuffer>> secondaryCommandBuffers;
+
+	// RECORD_EVERY_FRAME's instead: a transient pool per frame in
+	// flight, its one primary, and the secondaries that ran last time
+	std::vector<VCommandPool> frameCommandPools;
+	std::vector<VkCommandBuffer> frameCommandBuffers;
+	std::vector<std::vector<VkCommandBuffer>> frameSecondaryCommandBuffers;
 	
-	VDeleter<VkSemaphore> imageAvailableSemaphore{ device, vkDestroySemaphore };
-	VDeleter<VkSemaphore> renderFinishedSemaphore{ device, vkDestroySemaphore };
+	std::vector<VSemaphore> imageAvailableSemaphores;
+	std::vector<VSemaphore> renderFinishedSemaphores;
+	std::vector<VFence> inFlightFences;
+	size_t currentFrame = 0;
+	// Frames are numbered from 1 as they're submitted. each slot
+	// remembers which one it last ran, so once its fence is waited on
+	// we know everything up to there is done
+	uint64_t submittedFrames = 0;
+	uint64_t completedFrames = 0;
+	std::array<uint64_t, MAX_FRAMES_IN_FLIGHT> inFlightFrameNumbers = {};
+
+	// Set by onWindowResized(), drawFrame() recreates the swapchain
+	// once it's done presenting. however many resize events came in
+	bool framebufferResized = false;
+	// Oldest first, freed as completedFrames catches up
+	std::deque<RetiredSwapChain> retiredSwapChains;
+
+	SubmitCounters submitCounters;
+	RecordCounters recordCounters;
+
+	// Every frame's cpu, present to present & gpu times, for catching
+	// stutter. the loop adds a sample per frame it submits, drawFrame()
+	// times the presents and fills in the gpu side as it's read back
+	FrameStats frameStats{ FRAME_STATS_CAPACITY };
+	std::chrono::high_resolution_clock::time_point lastPresent;
+	bool presentedOnce = false;
+	double lastPresentIntervalMs = 0.0;
+	// Set by onKey(), the loop writes the stats out when it sees it
+	bool frameStatsRequested = false;
 
 };
\ No newline at end of file
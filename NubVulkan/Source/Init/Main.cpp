@@ -1,19 +1,183 @@
-
 #include <Applications/01HelloTriangle.h>
+#include <Util/MemoryAllocatorTests.h>
+#include <Util/MeshCache.h>
+#include <Util/MeshIngest.h>
+#include <Util/MeshOptimizer.h>
+#include <Util/TextureFile.h>
+
+#include <cstdint>
+#include <cstdlib>
+#include <functional>
+#include <string>
 
-int main() 
+namespace
 {
-	HelloTriangleApp app;
+	// Every mode (and the normal run) fails the same way, the
+	// error goes to stderr and the exit code says so
+	int runMode(const std::function<void()> &mode)
+	{
+		try
+		{
+			mode();
+		}
+		catch (const std::runtime_error &err)
+		{
+			std::cerr << err.what() << "\n";
+			return EXIT_FAILURE;
+		}
+		return EXIT_SUCCESS;
+	}
 
-	try
+	void printUsage()
 	{
-		app.run();
+		std::cerr << "usage:\n"
+			<< "\tNubVulkan\n"
+			<< "\tNubVulkan --bench-ingest model.obj\n"
+			<< "\tNubVulkan --bench-dedup\n"
+			<< "\tNubVulkan --analyze-mesh model.obj\n"
+			<< "\tNubVulkan --bench-mesh-cache model.obj\n"
+			<< "\tNubVulkan --compress-texture in.jpg out.nubtex\n"
+			<< "\tNubVulkan --bench-compress in.jpg\n"
+			<< "\tNubVulkan --bench-record [draws]\n"
+			<< "\tNubVulkan --headless [frames >= 1, 1000 by default] [out.ppm]\n"
+			<< "\tNubVulkan --test-allocator\n";
 	}
-	catch (const std::runtime_error &err)
+
+	// A whole positive number and nothing else, 0 if it isn't one.
+	// 64 bit even where long isn't, so too big is still too big
+	// (it saturates rather than wrapping)
+	unsigned long long parseCount(const char *text)
+	{
+		char *end = nullptr;
+		unsigned long long count = std::strtoull(text, &end, 10);
+		if (end == text || *end != '\0' || text[0] == '-')
+		{
+			return 0;
+		}
+		return count;
+	}
+}
+
+int main(int argc, char **argv)
+{
+	std::string command = argc >= 2 ? argv[1] : "";
+
+	// NubVulkan --bench-ingest path/to/model.obj
+	// times the obj dedup at a bunch of thread counts,
+	// doesn't touch vulkan or open a window at all
+	if (argc >= 3 && command == "--bench-ingest")
 	{
-		std::cerr << err.what() << "\n";
+		return runMode([&]() { benchmarkMeshIngest(argv[2]); });
+	}
+
+	// NubVulkan --bench-dedup
+	// VertexHashMap vs std::unordered_map on made up
+	// vertex streams, no model or gpu needed
+	if (command == "--bench-dedup")
+	{
+		return runMode([]() { benchmarkVertexDedup(); });
+	}
+
+	// NubVulkan --analyze-mesh path/to/model.obj
+	// prints the vertex cache & fetch stats before and
+	// after each optimizeMesh() pass, also gpu free
+	if (argc >= 3 && command == "--analyze-mesh")
+	{
+		return runMode([&]() { analyzeMeshFile(argv[2]); });
+	}
+
+	// NubVulkan --bench-mesh-cache path/to/model.obj
+	// cold load vs warm start from the .nubmesh cache,
+	// side by side. gpu free as well
+	if (argc >= 3 && command == "--bench-mesh-cache")
+	{
+		return runMode([&]() { benchmarkMeshCache(argv[2]); });
+	}
+
+	// NubVulkan --compress-texture in.jpg out.nubtex
+	// mips + BC1/BC3 compresses an image for the loader
+	// to pick up (see TEXTURE_COMPRESSED_PATH)
+	if (argc >= 4 && command == "--compress-texture")
+	{
+		return runMode([&]() { compressTextureFile(argv[2], argv[3]); });
+	}
+
+	// NubVulkan --bench-compress in.jpg
+	// encode speed & PSNR of both formats, cpu only
+	if (argc >= 3 && command == "--bench-compress")
+	{
+		return runMode([&]() { benchmarkTextureCompression(argv[2]); });
+	}
+
+	// NubVulkan --bench-record [draws]
+	// opens the window & sets up as usual, then times
+	// recording the model split into that many draws
+	// (10000 by default) at 1, 2, 4... threads. point
+	// VK_ICD_FILENAMES at a software driver (lavapipe,
+	// swiftshader) to take the gpu out of it
+	if (command == "--bench-record")
+	{
+		size_t drawCount = argc >= 3 ? (size_t)parseCount(argv[2]) : 10000;
+		if (drawCount == 0)
+		{
+			std::cerr << "--bench-record needs at least 1 draw, got \"" << argv[2] << "\"\n";
+			printUsage();
+			return EXIT_FAILURE;
+		}
+
+		HelloTriangleApp app;
+		return runMode([&]() { app.benchmarkRecording(drawCount); });
+	}
+
+	// NubVulkan --headless [frames] [out.ppm]
+	// no window or display needed at all: renders that
+	// many frames (1000 by default) offscreen and prints
+	// frame time stats, then dumps the last frame if
+	// given a path. VK_ICD_FILENAMES pointed at lavapipe
+	// runs it on a box without a gpu
+	if (command == "--headless")
+	{
+		unsigned long long frameCount = argc >= 3 ? parseCount(argv[2]) : 1000;
+		if (frameCount == 0)
+		{
+			std::cerr << "--headless needs at least 1 frame, got \"" << argv[2] << "\"\n";
+			printUsage();
+			return EXIT_FAILURE;
+		}
+		if (frameCount > UINT32_MAX)
+		{
+			std::cerr << "--headless can do at most " << UINT32_MAX << " frames, got \"" << argv[2] << "\"\n";
+			printUsage();
+			return EXIT_FAILURE;
+		}
+		std::string dumpPath = argc >= 4 ? argv[3] : "";
+
+		HelloTriangleApp app;
+		return runMode([&]() { app.runHeadless((uint32_t)frameCount, dumpPath); });
+	}
+
+	// NubVulkan --test-allocator
+	// MemoryAllocator's bookkeeping against a fake
+	// backend, no gpu. fails if any check does
+	if (command == "--test-allocator")
+	{
+		return runMode([]()
+		{
+			if (runMemoryAllocatorTests() != 0)
+			{
+				throw std::runtime_error("Memory allocator tests failed!");
+			}
+		});
+	}
+
+	// a mode that's misspelt or missing its arguments
+	// shouldn't quietly open the window instead
+	if (!command.empty())
+	{
+		printUsage();
 		return EXIT_FAILURE;
 	}
 
-	return EXIT_SUCCESS;
+	HelloTriangleApp app;
+	return runMode([&]() { app.run(); });
 }
\ No newline at end of file
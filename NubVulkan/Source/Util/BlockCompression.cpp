@@ -0,0 +1,426 @@
+#include <Util/BlockCompression.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace
+{
+	uint16_t packRGB565(const float *color)
+	{
+		int r = std::min(std::max((int)std::lround(color[0] * 31.0f / 255.0f), 0), 31);
+		int g = std::min(std::max((int)std::lround(color[1] * 63.0f / 255.0f), 0), 63);
+		int b = std::min(std::max((int)std::lround(color[2] * 31.0f / 255.0f), 0), 31);
+		return (uint16_t)((r << 11) | (g << 5) | b);
+	}
+
+	void unpackRGB565(uint16_t color, int *rgb)
+	{
+		int r = (color >> 11) & 31;
+		int g = (color >> 5) & 63;
+		int b = color & 31;
+		// replicate the top bits into the bottom ones, so 31
+		// comes out as 255 and not 248
+		rgb[0] = (r << 3) | (r >> 2);
+		rgb[1] = (g << 2) | (g >> 4);
+		rgb[2] = (b << 3) | (b >> 2);
+	}
+
+	// The 4 colour palette. (the 3 colour + black mode, when c0 <= c1,
+	// is never written, only decoded)
+	void colorPalette(uint16_t c0, uint16_t c1, int palette[4][3])
+	{
+		unpackRGB565(c0, palette[0]);
+		unpackRGB565(c1, palette[1]);
+		for (int c = 0; c < 3; c++)
+		{
+			palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+			palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+		}
+	}
+
+	// Nearest palette entry for every texel, returns the total squared
+	// error. indices are 2 bits a texel, texel 0 in the low bits
+	uint32_t fitColorIndices(const uint8_t *rgba, uint16_t c0, uint16_t c1, uint32_t &indices)
+	{
+		int palette[4][3];
+		colorPalette(c0, c1, palette);
+
+		uint32_t error = 0;
+		indices = 0;
+		for (int i = 0; i < 16; i++)
+		{
+			uint32_t best = 0;
+			uint32_t bestError = UINT32_MAX;
+			for (uint32_t p = 0; p < 4; p++)
+			{
+				int dr = rgba[i * 4 + 0] - palette[p][0];
+				int dg = rgba[i * 4 + 1] - palette[p][1];
+				int db = rgba[i * 4 + 2] - palette[p][2];
+				uint32_t texelError = (uint32_t)(dr * dr + dg * dg + db * db);
+				if (texelError < bestError)
+				{
+					best = p;
+					bestError = texelError;
+				}
+			}
+			indices |= best << (i * 2);
+			error += bestError;
+		}
+		return error;
+	}
+
+	// Least squares endpoints for a fixed set of indices: each texel's
+	// colour is wa * a + wb * b, solve for the a & b that fit best
+	bool refineEndpoints(const uint8_t *rgba, uint32_t indices, float *a, float *b)
+	{
+		static const float weights[4] = { 1.0f, 0.0f, 2.0f / 3.0f, 1.0f / 3.0f };
+
+		float aa = 0.0f, ab = 0.0f, bb = 0.0f;
+		float ax[3] = {}, bx[3] = {};
+		for (int i = 0; i < 16; i++)
+		{
+			float wa = weights[(indices >> (i * 2)) & 3];
+			float wb = 1.0f - wa;
+			aa += wa * wa;
+			ab += wa * wb;
+			bb += wb * wb;
+			for (int c = 0; c < 3; c++)
+			{
+				ax[c] += wa * rgba[i * 4 + c];
+				bx[c] += wb * rgba[i * 4 + c];
+			}
+		}
+
+		float det = aa * bb - ab * ab;
+		if (std::fabs(det) < 1e-6f)
+		{
+			return false;
+		}
+
+		for (int c = 0; c < 3; c++)
+		{
+			a[c] = (ax[c] * bb - bx[c] * ab) / det;
+			b[c] = (bx[c] * aa - ax[c] * ab) / det;
+		}
+		return true;
+	}
+
+	void encodeColorBlock(const uint8_t *rgba, uint8_t *out)
+	{
+		// The colours of a block mostly lie along one line, find it
+		// (the principal axis of their covariance, by a few rounds of
+		// power iteration) and take the texels furthest along it
+		float mean[3] = {};
+		for (int i = 0; i < 16; i++)
+		{
+			for (int c = 0; c < 3; c++)
+			{
+				mean[c] += rgba[i * 4 + c] / 16.0f;
+			}
+		}
+
+		float cov[3][3] = {};
+		for (int i = 0; i < 16; i++)
+		{
+			float d[3] = { rgba[i * 4] - mean[0], rgba[i * 4 + 1] - mean[1], rgba[i * 4 + 2] - mean[2] };
+			for (int r = 0; r < 3; r++)
+			{
+				for (int c = 0; c < 3; c++)
+				{
+					cov[r][c] += d[r] * d[c];
+				}
+			}
+		}
+
+		float axis[3] = { 1.0f, 1.0f, 1.0f };
+		for (int iteration = 0; iteration < 4; iteration++)
+		{
+			float next[3];
+			for (int r = 0; r < 3; r++)
+			{
+				next[r] = cov[r][0] * axis[0] + cov[r][1] * axis[1] + cov[r][2] * axis[2];
+			}
+			float biggest = std::max(std::fabs(next[0]), std::max(std::fabs(next[1]), std::fabs(next[2])));
+			if (biggest < 1e-6f)
+			{
+				break;
+			}
+			for (int c = 0; c < 3; c++)
+			{
+				axis[c] = next[c] / biggest;
+			}
+		}
+
+		int minTexel = 0, maxTexel = 0;
+		float minT = 0.0f, maxT = 0.0f;
+		for (int i = 0; i < 16; i++)
+		{
+			float t = rgba[i * 4] * axis[0] + rgba[i * 4 + 1] * axis[1] + rgba[i * 4 + 2] * axis[2];
+			if (i == 0 || t < minT)
+			{
+				minT = t;
+				minTexel = i;
+			}
+			if (i == 0 || t > maxT)
+			{
+				maxT = t;
+				maxTexel = i;
+			}
+		}
+
+		float maxColor[3] = { (float)rgba[maxTexel * 4], (float)rgba[maxTexel * 4 + 1], (float)rgba[maxTexel * 4 + 2] };
+		float minColor[3] = { (float)rgba[minTexel * 4], (float)rgba[minTexel * 4 + 1], (float)rgba[minTexel * 4 + 2] };
+		uint16_t c0 = packRGB565(maxColor);
+		uint16_t c1 = packRGB565(minColor);
+		uint32_t indices;
+		uint32_t error = fitColorIndices(rgba, c0, c1, indices);
+
+		// Then nudge the endpoints to fit the texels that picked them,
+		// keeping it only if it actually helped
+		for (int iteration = 0; iteration < 2 && error > 0; iteration++)
+		{
+			float a[3], b[3];
+			if (!refineEndpoints(rgba, indices, a, b))
+			{
+				break;
+			}
+
+			uint16_t refined0 = packRGB565(a);
+			uint16_t refined1 = packRGB565(b);
+			uint32_t refinedIndices;
+			uint32_t refinedError = fitColorIndices(rgba, refined0, refined1, refinedIndices);
+			if (refinedError >= error)
+			{
+				break;
+			}
+
+			c0 = refined0;
+			c1 = refined1;
+			indices = refinedIndices;
+			error = refinedError;
+		}
+
+		// c0 > c1 is what says "4 colour mode" to the decoder. swapping
+		// them swaps index 0 with 1 and 2 with 3. equal endpoints would
+		// flip it into 3 colour mode, where only index 0 is safe
+		if (c0 < c1)
+		{
+			std::swap(c0, c1);
+			indices ^= 0x55555555;
+		}
+		else if (c0 == c1)
+		{
+			indices = 0;
+		}
+
+		out[0] = (uint8_t)(c0 & 0xFF);
+		out[1] = (uint8_t)(c0 >> 8);
+		out[2] = (uint8_t)(c1 & 0xFF);
+		out[3] = (uint8_t)(c1 >> 8);
+		memcpy(out + 4, &indices, 4);
+	}
+
+	void decodeColorBlock(const uint8_t *block, uint8_t *rgba, bool alwaysFourColors)
+	{
+		uint16_t c0 = (uint16_t)(block[0] | (block[1] << 8));
+		uint16_t c1 = (uint16_t)(block[2] | (block[3] << 8));
+		uint32_t indices;
+		memcpy(&indices, block + 4, 4);
+
+		int palette[4][3];
+		colorPalette(c0, c1, palette);
+		bool transparentBlack = !alwaysFourColors && c0 <= c1;
+		if (transparentBlack)
+		{
+			for (int c = 0; c < 3; c++)
+			{
+				palette[2][c] = (palette[0][c] + palette[1][c]) / 2;
+				palette[3][c] = 0;
+			}
+		}
+
+		for (int i = 0; i < 16; i++)
+		{
+			uint32_t index = (indices >> (i * 2)) & 3;
+			rgba[i * 4 + 0] = (uint8_t)palette[index][0];
+			rgba[i * 4 + 1] = (uint8_t)palette[index][1];
+			rgba[i * 4 + 2] = (uint8_t)palette[index][2];
+			rgba[i * 4 + 3] = transparentBlack && index == 3 ? 0 : 255;
+		}
+	}
+
+	void alphaPalette(uint8_t a0, uint8_t a1, int palette[8])
+	{
+		palette[0] = a0;
+		palette[1] = a1;
+		if (a0 > a1)
+		{
+			for (int k = 2; k < 8; k++)
+			{
+				palette[k] = ((8 - k) * a0 + (k - 1) * a1) / 7;
+			}
+		}
+		else
+		{
+			for (int k = 2; k < 6; k++)
+			{
+				palette[k] = ((6 - k) * a0 + (k - 1) * a1) / 5;
+			}
+			palette[6] = 0;
+			palette[7] = 255;
+		}
+	}
+
+	void encodeAlphaBlock(const uint8_t *rgba, uint8_t *out)
+	{
+		uint8_t a0 = 0, a1 = 255;
+		for (int i = 0; i < 16; i++)
+		{
+			a0 = std::max(a0, rgba[i * 4 + 3]);
+			a1 = std::min(a1, rgba[i * 4 + 3]);
+		}
+
+		int palette[8];
+		alphaPalette(a0, a1, palette);
+
+		// a0 == a1 means every texel's index 0 anyway
+		uint64_t indices = 0;
+		if (a0 > a1)
+		{
+			for (int i = 0; i < 16; i++)
+			{
+				uint64_t best = 0;
+				int bestError = 256;
+				for (int p = 0; p < 8; p++)
+				{
+					int texelError = std::abs(rgba[i * 4 + 3] - palette[p]);
+					if (texelError < bestError)
+					{
+						best = (uint64_t)p;
+						bestError = texelError;
+					}
+				}
+				indices |= best << (i * 3);
+			}
+		}
+
+		out[0] = a0;
+		out[1] = a1;
+		for (int i = 0; i < 6; i++)
+		{
+			out[2 + i] = (uint8_t)(indices >> (i * 8));
+		}
+	}
+
+	void decodeAlphaBlock(const uint8_t *block, uint8_t *rgba)
+	{
+		int palette[8];
+		alphaPalette(block[0], block[1], palette);
+
+		uint64_t indices = 0;
+		for (int i = 0; i < 6; i++)
+		{
+			indices |= (uint64_t)block[2 + i] << (i * 8);
+		}
+
+		for (int i = 0; i < 16; i++)
+		{
+			rgba[i * 4 + 3] = (uint8_t)palette[(indices >> (i * 3)) & 7];
+		}
+	}
+}
+
+size_t blockBytes(BlockFormat format)
+{
+	return format == BlockFormat::BC1 ? 8 : 16;
+}
+
+size_t compressedSize(BlockFormat format, uint32_t width, uint32_t height)
+{
+	return (size_t)((width + 3) / 4) * ((height + 3) / 4) * blockBytes(format);
+}
+
+void encodeBC1Block(const uint8_t *rgba, uint8_t *out)
+{
+	encodeColorBlock(rgba, out);
+}
+
+void encodeBC3Block(const uint8_t *rgba, uint8_t *out)
+{
+	encodeAlphaBlock(rgba, out);
+	encodeColorBlock(rgba, out + 8);
+}
+
+void decodeBC1Block(const uint8_t *block, uint8_t *rgba)
+{
+	decodeColorBlock(block, rgba, false);
+}
+
+void decodeBC3Block(const uint8_t *block, uint8_t *rgba)
+{
+	decodeColorBlock(block + 8, rgba, true);
+	decodeAlphaBlock(block, rgba);
+}
+
+void compressImage(const uint8_t *pixels, uint32_t width, uint32_t height, BlockFormat format, uint8_t *out)
+{
+	uint8_t texels[16 * 4];
+	size_t bytes = blockBytes(format);
+
+	for (uint32_t by = 0; by < height; by += 4)
+	{
+		for (uint32_t bx = 0; bx < width; bx += 4)
+		{
+			for (uint32_t y = 0; y < 4; y++)
+			{
+				uint32_t sy = std::min(by + y, height - 1);
+				for (uint32_t x = 0; x < 4; x++)
+				{
+					uint32_t sx = std::min(bx + x, width - 1);
+					memcpy(texels + (y * 4 + x) * 4, pixels + ((size_t)sy * width + sx) * 4, 4);
+				}
+			}
+
+			if (format == BlockFormat::BC1)
+			{
+				encodeBC1Block(texels, out);
+			}
+			else
+			{
+				encodeBC3Block(texels, out);
+			}
+			out += bytes;
+		}
+	}
+}
+
+void decompressImage(const uint8_t *blocks, uint32_t width, uint32_t height, BlockFormat format, uint8_t *pixels)
+{
+	uint8_t texels[16 * 4];
+	size_t bytes = blockBytes(format);
+
+	for (uint32_t by = 0; by < height; by += 4)
+	{
+		for (uint32_t bx = 0; bx < width; bx += 4)
+		{
+			if (format == BlockFormat::BC1)
+			{
+				decodeBC1Block(blocks, texels);
+			}
+			else
+			{
+				decodeBC3Block(blocks, texels);
+			}
+			blocks += bytes;
+
+			for (uint32_t y = 0; y < 4 && by + y < height; y++)
+			{
+				for (uint32_t x = 0; x < 4 && bx + x < width; x++)
+				{
+					memcpy(pixels + ((size_t)(by + y) * width + bx + x) * 4, texels + (y * 4 + x) * 4, 4);
+				}
+			}
+		}
+	}
+}
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// BC1 (aka DXT1, 4 bits a texel, no alpha) and BC3 (aka DXT5, 8 bits a
+// texel, BC1 colour + a separate alpha block). every 4x4 block of texels
+// is stored as two endpoint colours and a 2 bit index per texel picking
+// one of 4 colours along the line between them
+enum class BlockFormat
+{
+	BC1,
+	BC3
+};
+
+size_t blockBytes(BlockFormat format);
+// Bytes for a whole width x height image, partial blocks round up
+size_t compressedSize(BlockFormat format, uint32_t width, uint32_t height);
+
+// rgba is 16 texels, 4 bytes each, row by row
+void encodeBC1Block(const uint8_t *rgba, uint8_t *out);
+void encodeBC3Block(const uint8_t *rgba, uint8_t *out);
+void decodeBC1Block(const uint8_t *block, uint8_t *rgba);
+void decodeBC3Block(const uint8_t *block, uint8_t *rgba);
+
+// Whole rgba8 images. blocks hanging off the right/bottom edge repeat
+// the last column/row
+void compressImage(const uint8_t *pixels, uint32_t width, uint32_t height, BlockFormat format, uint8_t *out);
+void decompressImage(const uint8_t *blocks, uint32_t width, uint32_t height, BlockFormat format, uint8_t *pixels);
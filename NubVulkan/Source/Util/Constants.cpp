@@ -1,5 +1,7 @@
 #include <Util/Constants.h>
 
+#include <cstring>
+
 VkResult CreateDebugReportCallbackEXT(VkInstance instance, const VkDebugReportCallbackCreateInfoEXT * pCreateInfo, const VkAllocationCallbacks * pAllocator, VkDebugReportCallbackEXT * pCallback)
 {
 	auto func = (PFN_vkCreateDebugReportCallbackEXT)vkGetInstanceProcAddr(instance, "vkCreateDebugReportCallbackEXT");
@@ -23,7 +25,7 @@ void DestroyDebugReportCallbackEXT(VkInstance instance, VkDebugReportCallbackEXT
 	}
 }
 
-VkVertexInputBindingDescription Vertex::getBindingDescription()
+VkVertexInputBindingDescription Vertex::getBindingDescription(VertexFormat format)
 {
 	// A vertex binding description describes (duh) at
 	// which rate to load data from memory. it specifies
@@ -33,19 +35,19 @@ VkVertexInputBindingDescription Vertex::getBindingDescription()
 	
 	VkVertexInputBindingDescription bindDesc = {};
 	bindDesc.binding = 0;
-	bindDesc.stride = sizeof(Vertex);
+	bindDesc.stride = format == VertexFormat::Packed ? sizeof(PackedVertex) : sizeof(Vertex);
 	bindDesc.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
 	// _vertex will move to the next data entry after each
 	// vertex, whereas
 	// _instance will move to the next data entry after
 	// each instance
-	// right now we're not doing instanced rendering, so
-	// we can stick to per-vertex data
+	// this binding's per-vertex, the per-instance stuff
+	// lives in its own binding (see InstanceData)
 
 	return bindDesc;
 }
 
-std::array<VkVertexInputAttributeDescription, 3> Vertex::getAttributeDescriptions()
+std::array<VkVertexInputAttributeDescription, 3> Vertex::getAttributeDescriptions(VertexFormat format)
 {
 	// the magic number for the array size of 3 is 'cause
 	// of the amount of attributes we have, which is the
@@ -71,10 +73,47 @@ std::array<VkVertexInputAttributeDescription, 3> Vertex::getAttributeDescription
 	attribDescs[2].format = VK_FORMAT_R32G32_SFLOAT;
 	attribDescs[2].offset = offsetof(Vertex, texCoord);
 
+	// same locations, the formats just do the unpacking.
+	// the shader still gets its vec3, vec3 and vec2
+	if (format == VertexFormat::Packed)
+	{
+		attribDescs[0].format = VK_FORMAT_R16G16B16A16_SFLOAT;
+		attribDescs[0].offset = offsetof(PackedVertex, pos);
+
+		attribDescs[1].format = VK_FORMAT_R8G8B8A8_SNORM;
+		attribDescs[1].offset = offsetof(PackedVertex, norm);
+
+		attribDescs[2].format = VK_FORMAT_R16G16_UNORM;
+		attribDescs[2].offset = offsetof(PackedVertex, texCoord);
+	}
+
 	return attribDescs;
 }
 
 bool Vertex::operator==(const Vertex & other) const
 {
-	return this->pos == other.pos && this->norm == other.norm && this->texCoord == other.texCoord;
+	// Raw bytes, same as hashVertex & VertexHashMap, so anything
+	// equal hashes the same. comparing the floats would call -0.0
+	// and 0.0 equal while their bits (and hashes) differ
+	return memcmp(this, &other, sizeof(Vertex)) == 0;
+}
+
+uint64_t hashVertex(const Vertex &vertex)
+{
+	// Four 64 bit words, each one mixed with murmur3's
+	// finalizer and folded into the running hash
+	uint64_t words[sizeof(Vertex) / sizeof(uint64_t)];
+	memcpy(words, &vertex, sizeof(words));
+
+	uint64_t hash = 0x9E3779B97F4A7C15ull;
+	for (uint64_t word : words)
+	{
+		word ^= word >> 33;
+		word *= 0xFF51AFD7ED558CCDull;
+		word ^= word >> 33;
+		word *= 0xC4CEB9FE1A85EC53ull;
+		word ^= word >> 33;
+		hash = (hash ^ word) * 0x100000001B3ull + (hash >> 29);
+	}
+	return hash ^ (hash >> 32);
 }
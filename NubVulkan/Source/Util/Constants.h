@@ -7,6 +7,14 @@
 #include <glm/glm.hpp>
 #include <glm/gtx/hash.hpp>
 
+// Which layout the vertex buffer's in. Full is just Vertex, Packed is
+// PackedVertex below (see chooseMeshFormats())
+enum class VertexFormat
+{
+	Full,
+	Packed
+};
+
 struct Vertex
 {
 	glm::vec3 pos;
@@ -16,25 +24,40 @@ struct Vertex
 	// Helper functions for this vertex class; oops, sorry, struct...
 
 	// Binding descriptions - yep! you gotta tell vulkan, so why not here?
-	static VkVertexInputBindingDescription getBindingDescription();
+	static VkVertexInputBindingDescription getBindingDescription(VertexFormat format = VertexFormat::Full);
 
 	// Attribute descriptions - VAO's pretty much
-	static std::array<VkVertexInputAttributeDescription, 3> getAttributeDescriptions();
+	static std::array<VkVertexInputAttributeDescription, 3> getAttributeDescriptions(VertexFormat format = VertexFormat::Full);
 
+	// Bitwise, to match hashVertex. -0.0 and 0.0 aren't the same vertex
 	bool operator==(const Vertex &other) const;
 };
 
+// Hey! from the future! Vertex squished down to 16 bytes. the shader
+// can't tell the difference, the attribute formats turn it all back
+// into floats before it gets there
+struct PackedVertex
+{
+	uint16_t pos[4];      // half floats, w is just padding
+	int8_t norm[4];       // snorm8, w is padding again
+	uint16_t texCoord[2]; // unorm16, so uvs have to be in [0, 1]
+};
+
+// Hashes the raw 32 bytes of a vertex. way fewer collisions than
+// xor'ing glm's hashes together
+uint64_t hashVertex(const Vertex &vertex);
+
 namespace std
 {
 	// A hash struct, something i don't know yet. I'm sorry
+	// (future me: it used to shift & xor glm's hashes, which collided
+	// like crazy. see hashVertex)
 	template<> 
 	struct hash<Vertex>
 	{
 		size_t operator()(Vertex const &vertex) const
 		{
-			return ((hash<glm::vec3>()(vertex.pos) ^
-				(hash<glm::vec3>()(vertex.norm) << 1)) >> 1) ^
-				(hash<glm::vec2>()(vertex.texCoord) << 1);
+			return (size_t)hashVertex(vertex);
 		}
 	};
 }
@@ -70,8 +93,60 @@ struct UniformBufferObject
 const int WIDTH = 1280;
 const int HEIGHT = 720;
 
+// How many frames the cpu is allowed to get ahead of the gpu. each one
+// gets its own semaphores, fence, command buffers and ubo
+const int MAX_FRAMES_IN_FLIGHT = 2;
+
+// How many copies of the model to draw, on a grid. they're all one
+// instanced draw, so this can go to 100000+ without costing any more
+// cpu time per frame
+const unsigned SCENE_INSTANCES = 1;
+
+// How many threads record the draw list into secondary command
+// buffers, 0 for one per hardware thread
+const unsigned RECORDING_THREADS = 0;
+
+// Record the frame's command buffers fresh every frame (from transient
+// pools) instead of baking one per [frame][image] up front, so what's
+// drawn can change from frame to frame
+const bool RECORD_EVERY_FRAME = true;
+// When recording every frame: vkResetCommandPool the frame's pools and
+// reuse its buffers, or free & reallocate them all (slower, just there
+// to compare against in the frame time log)
+const bool RESET_FRAME_POOLS = true;
+
+// Count primitives & shader invocations in the render pass along with
+// its gpu time, when the device can (see GpuProfiler)
+const bool GPU_PIPELINE_STATISTICS = true;
+// Print every frame's gpu timings as they're read back, not just the
+// averages in the frame time log. lots of output
+const bool GPU_PROFILE_EVERY_FRAME = false;
+
+// How many frames' timings FrameStats keeps, the newest ones. a minute
+// or so at 60 fps
+const unsigned FRAME_STATS_CAPACITY = 4096;
+
+// Use PackedVertex for the model when the gpu & the mesh allow it
+const bool PACK_VERTICES = true;
+
+// Upload the texture's small mips first and only send the top level
+// after the first frame, so it shows up (blurry) straight away. mips
+// come from the cpu when streaming, otherwise they're blitted on the gpu
+const bool STREAM_TEXTURE_MIPS = true;
+
 const std::string MODEL_PATH = "Models/chalet.obj";
+// Parsed + deduped MODEL_PATH, see MeshCache
+const std::string MODEL_CACHE_PATH = "Models/chalet.nubmesh";
 const std::string TEXTURE_PATH = "Textures/chalet.jpg";
+// Block compressed TEXTURE_PATH, made with --compress-texture. used
+// instead when it's there and the gpu does BC
+const std::string TEXTURE_COMPRESSED_PATH = "Textures/chalet.nubtex";
+// The driver's compiled pipelines, see createPipelineCache()
+const std::string PIPELINE_CACHE_PATH = "pipeline.nubcache";
+// Every NUB_PROFILE_SCOPE from the run, written on the way out
+const std::string CPU_TRACE_PATH = "trace.json";
+// Every kept frame's timings, written on the way out and on F2
+const std::string FRAME_STATS_PATH = "framestats.csv";
 
 const std::vector<const char *> validationLayers = {
 	"VK_LAYER_LUNARG_standard_validation"
@@ -0,0 +1,155 @@
+#include <Util/CpuProfiler.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace
+{
+	struct Event
+	{
+		const char *name;
+		int64_t startUs;
+		int64_t endUs;
+	};
+
+	// Only its own thread ever writes to one of these. count is
+	// published with release, so a reader that loads it with
+	// acquire can read that many events without a lock
+	struct ThreadBuffer
+	{
+		uint32_t id = 0;
+		std::string name;
+		std::unique_ptr<Event[]> events;
+		std::atomic<size_t> count{ 0 };
+		std::atomic<uint64_t> dropped{ 0 };
+	};
+
+	const std::chrono::steady_clock::time_point processStart = std::chrono::steady_clock::now();
+
+	// Buffers are never freed, a thread that's gone still has its
+	// events in the trace
+	std::mutex registryMutex;
+	std::vector<std::unique_ptr<ThreadBuffer>> registry;
+
+	thread_local ThreadBuffer *localBuffer = nullptr;
+
+	ThreadBuffer &getLocalBuffer()
+	{
+		if (!localBuffer)
+		{
+			std::unique_ptr<ThreadBuffer> buffer(new ThreadBuffer());
+			buffer->events.reset(new Event[CPU_PROFILE_EVENTS_PER_THREAD]);
+
+			std::lock_guard<std::mutex> lock(registryMutex);
+			buffer->id = (uint32_t)registry.size();
+			buffer->name = buffer->id == 0 ? "main" : "thread " + std::to_string(buffer->id);
+			localBuffer = buffer.get();
+			registry.push_back(std::move(buffer));
+		}
+		return *localBuffer;
+	}
+
+	void writeEscaped(std::ostream &out, const std::string &text)
+	{
+		for (char c : text)
+		{
+			if (c == '"' || c == '\\')
+			{
+				out << '\\' << c;
+			}
+			else if ((unsigned char)c < 0x20)
+			{
+				char escaped[8];
+				snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+				out << escaped;
+			}
+			else
+			{
+				out << c;
+			}
+		}
+	}
+}
+
+int64_t CpuProfiler::now()
+{
+	return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - processStart).count();
+}
+
+void CpuProfiler::record(const char *name, int64_t startUs, int64_t endUs)
+{
+	ThreadBuffer &buffer = getLocalBuffer();
+	size_t index = buffer.count.load(std::memory_order_relaxed);
+	if (index >= CPU_PROFILE_EVENTS_PER_THREAD)
+	{
+		buffer.dropped.fetch_add(1, std::memory_order_relaxed);
+		return;
+	}
+
+	buffer.events[index] = { name, startUs, endUs };
+	buffer.count.store(index + 1, std::memory_order_release);
+}
+
+void CpuProfiler::setThreadName(const std::string &name)
+{
+	ThreadBuffer &buffer = getLocalBuffer();
+	std::lock_guard<std::mutex> lock(registryMutex);
+	buffer.name = name;
+}
+
+size_t CpuProfiler::eventCount()
+{
+	std::lock_guard<std::mutex> lock(registryMutex);
+	size_t count = 0;
+	for (const auto &buffer : registry)
+	{
+		count += buffer->count.load(std::memory_order_acquire);
+	}
+	return count;
+}
+
+bool CpuProfiler::writeChromeTrace(const std::string &path)
+{
+	std::ofstream file(path, std::ios::trunc);
+	if (!file.is_open())
+	{
+		return false;
+	}
+
+	// "X" events are complete spans (start + duration, in
+	// microseconds), "M" ones name the threads
+	std::lock_guard<std::mutex> lock(registryMutex);
+	file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+	bool first = true;
+	for (const auto &buffer : registry)
+	{
+		file << (first ? "\n" : ",\n") << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << buffer->id << ",\"args\":{\"name\":\"";
+		writeEscaped(file, buffer->name);
+		file << "\"}}";
+		first = false;
+
+		uint64_t dropped = buffer->dropped.load(std::memory_order_relaxed);
+		if (dropped > 0)
+		{
+			file << ",\n{\"name\":\"dropped_events\",\"ph\":\"M\",\"pid\":1,\"tid\":" << buffer->id << ",\"args\":{\"count\":" << dropped << "}}";
+		}
+
+		size_t count = buffer->count.load(std::memory_order_acquire);
+		for (size_t i = 0; i < count; i++)
+		{
+			const Event &event = buffer->events[i];
+			file << ",\n{\"name\":\"";
+			writeEscaped(file, event.name);
+			file << "\",\"cat\":\"cpu\",\"ph\":\"X\",\"pid\":1,\"tid\":" << buffer->id
+				<< ",\"ts\":" << event.startUs << ",\"dur\":" << event.endUs - event.startUs << "}";
+		}
+	}
+	file << "\n]}\n";
+
+	return (bool)file;
+}
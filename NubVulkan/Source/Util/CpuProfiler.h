@@ -0,0 +1,62 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Define NUB_NO_PROFILING (eg in the project's preprocessor definitions)
+// and every NUB_PROFILE_SCOPE / NUB_PROFILE_FUNCTION compiles to nothing
+#ifndef NUB_NO_PROFILING
+#define NUB_PROFILING
+#endif
+
+// How many scopes each thread can record before the rest get dropped.
+// ~1.5mb a thread, only for threads that actually record something
+const size_t CPU_PROFILE_EVENTS_PER_THREAD = 65536;
+
+// Records timed scopes on any thread and writes them out as a Chrome
+// trace (chrome://tracing or ui.perfetto.dev). every thread appends to
+// its own buffer, so recording never takes a lock; the only lock is the
+// one time a thread registers its buffer. names have to be string
+// literals (or otherwise live forever), nothing's copied
+class CpuProfiler
+{
+public:
+	// Microseconds since the process started
+	static int64_t now();
+	static void record(const char *name, int64_t startUs, int64_t endUs);
+	// Shows up as the thread's name in the trace. copied, call it from
+	// the thread itself
+	static void setThreadName(const std::string &name);
+
+	static size_t eventCount();
+	// Safe to call while other threads are still recording, it just
+	// won't see what they record after it's started
+	static bool writeChromeTrace(const std::string &path);
+};
+
+// Times from here to the end of the enclosing block
+class CpuProfileScope
+{
+public:
+	explicit CpuProfileScope(const char *name) : name(name), start(CpuProfiler::now()) {}
+	~CpuProfileScope() { CpuProfiler::record(this->name, this->start, CpuProfiler::now()); }
+
+	CpuProfileScope(const CpuProfileScope &) = delete;
+	CpuProfileScope &operator=(const CpuProfileScope &) = delete;
+
+private:
+	const char *name;
+	int64_t start;
+};
+
+#define NUB_PROFILE_CONCAT_INNER(a, b) a##b
+#define NUB_PROFILE_CONCAT(a, b) NUB_PROFILE_CONCAT_INNER(a, b)
+
+#ifdef NUB_PROFILING
+#define NUB_PROFILE_SCOPE(name) CpuProfileScope NUB_PROFILE_CONCAT(profileScope, __LINE__)(name)
+#define NUB_PROFILE_FUNCTION() NUB_PROFILE_SCOPE(__FUNCTION__)
+#else
+#define NUB_PROFILE_SCOPE(name) ((void)0)
+#define NUB_PROFILE_FUNCTION() ((void)0)
+#endif
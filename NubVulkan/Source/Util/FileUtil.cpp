@@ -0,0 +1,39 @@
+#include <Util/FileUtil.h>
+
+#include <cstdio>
+#include <fstream>
+
+uint64_t hashFnv1a(const void *data, size_t size, uint64_t hash)
+{
+	const uint8_t *bytes = static_cast<const uint8_t *>(data);
+	for (size_t i = 0; i < size; i++)
+	{
+		hash ^= bytes[i];
+		hash *= 1099511628211ull;
+	}
+	return hash;
+}
+
+bool writeFileReplacing(const std::string &path, const std::function<void(std::ostream &)> &write)
+{
+	std::string tempPath = path + ".tmp";
+	{
+		std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+		if (!file.is_open())
+		{
+			return false;
+		}
+
+		write(file);
+
+		if (!file)
+		{
+			file.close();
+			std::remove(tempPath.c_str());
+			return false;
+		}
+	}
+
+	std::remove(path.c_str());
+	return std::rename(tempPath.c_str(), path.c_str()) == 0;
+}
@@ -0,0 +1,20 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <ostream>
+#include <string>
+
+// Where an FNV-1a hash starts, pass the last result back in to keep
+// going over data that comes in pieces
+const uint64_t FNV1A_SEED = 14695981039346656037ull;
+
+// FNV-1a, 64 bit. not crypto, just "did this change / get garbled"
+uint64_t hashFnv1a(const void *data, size_t size, uint64_t hash = FNV1A_SEED);
+
+// Writes path by handing write() a stream to path + ".tmp", then
+// swapping that in under the real name. a crash halfway never leaves a
+// half written file behind that looks valid. false if anything failed,
+// and the old file (if any) is left as it was
+bool writeFileReplacing(const std::string &path, const std::function<void(std::ostream &)> &write);
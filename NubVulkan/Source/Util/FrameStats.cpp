@@ -0,0 +1,211 @@
+#include <Util/FrameStats.h>
+
+#include <algorithm>
+#include <fstream>
+#include <stdexcept>
+
+namespace
+{
+	// What print()'s histogram uses, 1 ms buckets out to a bit past
+	// a 30 fps frame
+	const double HISTOGRAM_BUCKET_MS = 1.0;
+	const size_t HISTOGRAM_BUCKETS = 40;
+	const size_t HISTOGRAM_BAR_WIDTH = 50;
+
+	const char *metricName(FrameMetric metric)
+	{
+		switch (metric)
+		{
+		case FrameMetric::Cpu:
+			return "cpu";
+		case FrameMetric::PresentInterval:
+			return "present interval";
+		default:
+			return "gpu";
+		}
+	}
+
+	// Nearest rank, sorted has to have something in it
+	double percentile(const std::vector<double> &sorted, double p)
+	{
+		return sorted[std::min(sorted.size() - 1, (size_t)(p * (sorted.size() - 1) + 0.5))];
+	}
+}
+
+FrameStats::FrameStats(size_t capacity)
+	: samples(capacity)
+{
+	if (capacity == 0)
+	{
+		throw std::runtime_error("Couldn't make frame stats with no room for any frames!");
+	}
+}
+
+void FrameStats::add(const FrameSample &sample)
+{
+	this->samples[this->head] = sample;
+	this->head = (this->head + 1) % this->samples.size();
+	this->count = std::min(this->count + 1, this->samples.size());
+}
+
+void FrameStats::setGpuTime(uint64_t frame, double ms)
+{
+	// newest first, it's only ever a couple of frames back
+	for (size_t i = this->count; i > 0; i--)
+	{
+		FrameSample &s = this->samples[(this->head + this->samples.size() - this->count + i - 1) % this->samples.size()];
+		if (s.frame == frame)
+		{
+			s.gpuMs = ms;
+			return;
+		}
+		if (s.frame < frame)
+		{
+			return;
+		}
+	}
+}
+
+void FrameStats::clear()
+{
+	this->head = 0;
+	this->count = 0;
+}
+
+const FrameSample &FrameStats::sample(size_t index) const
+{
+	return this->samples[(this->head + this->samples.size() - this->count + index) % this->samples.size()];
+}
+
+std::vector<double> FrameStats::values(FrameMetric metric) const
+{
+	std::vector<double> result;
+	result.reserve(this->count);
+	for (size_t i = 0; i < this->count; i++)
+	{
+		const FrameSample &s = this->sample(i);
+		switch (metric)
+		{
+		case FrameMetric::Cpu:
+			result.push_back(s.cpuMs);
+			break;
+		case FrameMetric::PresentInterval:
+			result.push_back(s.presentIntervalMs);
+			break;
+		case FrameMetric::Gpu:
+			if (s.gpuMs >= 0.0)
+			{
+				result.push_back(s.gpuMs);
+			}
+			break;
+		}
+	}
+	return result;
+}
+
+FrameMetricSummary FrameStats::summarize(FrameMetric metric) const
+{
+	FrameMetricSummary summary;
+	std::vector<double> sorted = this->values(metric);
+	if (sorted.empty())
+	{
+		return summary;
+	}
+	std::sort(sorted.begin(), sorted.end());
+
+	double sum = 0.0;
+	for (double ms : sorted)
+	{
+		sum += ms;
+	}
+
+	summary.count = sorted.size();
+	summary.avg = sum / sorted.size();
+	summary.min = sorted.front();
+	summary.p50 = percentile(sorted, 0.50);
+	summary.p95 = percentile(sorted, 0.95);
+	summary.p99 = percentile(sorted, 0.99);
+	summary.max = sorted.back();
+	return summary;
+}
+
+std::vector<size_t> FrameStats::histogram(FrameMetric metric, double bucketMs, size_t bucketCount) const
+{
+	std::vector<size_t> buckets(bucketCount);
+	if (bucketCount == 0 || bucketMs <= 0.0)
+	{
+		return buckets;
+	}
+
+	for (double ms : this->values(metric))
+	{
+		buckets[std::min(bucketCount - 1, (size_t)(std::max(ms, 0.0) / bucketMs))]++;
+	}
+	return buckets;
+}
+
+void FrameStats::print(std::ostream &out) const
+{
+	const FrameMetric metrics[] = { FrameMetric::Cpu, FrameMetric::PresentInterval, FrameMetric::Gpu };
+	for (FrameMetric metric : metrics)
+	{
+		FrameMetricSummary summary = this->summarize(metric);
+		if (summary.count == 0)
+		{
+			continue;
+		}
+		out << "\t" << metricName(metric) << ": avg " << summary.avg << " ms, min " << summary.min << " ms, p50 " << summary.p50
+			<< " ms, p95 " << summary.p95 << " ms, p99 " << summary.p99 << " ms, max " << summary.max << " ms (" << summary.count << " frames)\n";
+	}
+
+	// the interval's the one that shows a hitch, whichever
+	// side caused it. empty buckets are skipped
+	std::vector<size_t> buckets = this->histogram(FrameMetric::PresentInterval, HISTOGRAM_BUCKET_MS, HISTOGRAM_BUCKETS);
+	size_t tallest = *std::max_element(buckets.begin(), buckets.end());
+	if (tallest == 0)
+	{
+		return;
+	}
+	out << "\tpresent interval histogram:\n";
+	for (size_t bucket = 0; bucket < buckets.size(); bucket++)
+	{
+		if (buckets[bucket] == 0)
+		{
+			continue;
+		}
+		out << "\t\t" << bucket * HISTOGRAM_BUCKET_MS;
+		if (bucket + 1 < buckets.size())
+		{
+			out << "-" << (bucket + 1) * HISTOGRAM_BUCKET_MS << " ms: ";
+		}
+		else
+		{
+			out << "+ ms: ";
+		}
+		// at least one # so a single stutter still shows up
+		out << std::string(std::max<size_t>(1, buckets[bucket] * HISTOGRAM_BAR_WIDTH / tallest), '#') << " " << buckets[bucket] << "\n";
+	}
+}
+
+bool FrameStats::writeCsv(const std::string &path) const
+{
+	std::ofstream file(path, std::ios::trunc);
+	if (!file.is_open())
+	{
+		return false;
+	}
+
+	file << "frame,cpu_ms,present_interval_ms,gpu_ms\n";
+	for (size_t i = 0; i < this->count; i++)
+	{
+		const FrameSample &s = this->sample(i);
+		file << s.frame << "," << s.cpuMs << "," << s.presentIntervalMs << ",";
+		if (s.gpuMs >= 0.0)
+		{
+			file << s.gpuMs;
+		}
+		file << "\n";
+	}
+
+	return (bool)file;
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// One frame's worth of timings. gpuMs is negative until the gpu
+// profiler's read it back, which is a few frames later
+struct FrameSample
+{
+	uint64_t frame = 0;
+	// Poll + drawFrame() on the main thread
+	double cpuMs = 0.0;
+	// Since the last frame was presented (submitted, headless)
+	double presentIntervalMs = 0.0;
+	double gpuMs = -1.0;
+};
+
+enum class FrameMetric
+{
+	Cpu,
+	PresentInterval,
+	Gpu
+};
+
+struct FrameMetricSummary
+{
+	size_t count = 0;
+	double avg = 0.0;
+	double min = 0.0;
+	double p50 = 0.0;
+	double p95 = 0.0;
+	double p99 = 0.0;
+	double max = 0.0;
+};
+
+// The last capacity frames' timings in a ring, so it costs the same
+// no matter how long it runs and can stay on in release builds. the
+// averages in the frame time log hide stutter, the tail percentiles
+// & histogram are what catch it
+class FrameStats
+{
+public:
+	explicit FrameStats(size_t capacity);
+
+	void add(const FrameSample &sample);
+	// Fills in a frame's gpu time once it's known. nothing if the
+	// frame's already dropped out of the ring
+	void setGpuTime(uint64_t frame, double ms);
+	void clear();
+
+	size_t size() const { return this->count; }
+	size_t capacity() const { return this->samples.size(); }
+	// Oldest first
+	const FrameSample &sample(size_t index) const;
+
+	// Over every sample that has the metric (gpu time might not be in
+	// for all of them). nearest rank percentiles
+	FrameMetricSummary summarize(FrameMetric metric) const;
+	// bucketMs wide buckets from 0, anything past the last one lands
+	// in the last one
+	std::vector<size_t> histogram(FrameMetric metric, double bucketMs, size_t bucketCount) const;
+
+	// Summaries of all three & the present interval's histogram
+	void print(std::ostream &out) const;
+	// frame,cpu_ms,present_interval_ms,gpu_ms a line, oldest first.
+	// gpu_ms is left empty where it's not known
+	bool writeCsv(const std::string &path) const;
+
+private:
+	std::vector<double> values(FrameMetric metric) const;
+
+	std::vector<FrameSample> samples;
+	// Where the next one goes, and how many are in there
+	size_t head = 0;
+	size_t count = 0;
+};
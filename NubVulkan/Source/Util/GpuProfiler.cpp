@@ -0,0 +1,263 @@
+#include <Util/GpuProfiler.h>
+
+#include <stdexcept>
+
+namespace
+{
+	// Results come back in bit order, so these line up with
+	// GpuScopeResult's counts
+	const VkQueryPipelineStatisticFlags STATISTICS_FLAGS =
+		VK_QUERY_PIPELINE_STATISTIC_INPUT_ASSEMBLY_PRIMITIVES_BIT |
+		VK_QUERY_PIPELINE_STATISTIC_VERTEX_SHADER_INVOCATIONS_BIT |
+		VK_QUERY_PIPELINE_STATISTIC_CLIPPING_PRIMITIVES_BIT |
+		VK_QUERY_PIPELINE_STATISTIC_FRAGMENT_SHADER_INVOCATIONS_BIT;
+	const uint32_t STATISTICS_COUNT = 4;
+}
+
+GpuProfiler::Slot::Slot(const VDevice &device) :
+	timestamps{ device },
+	statistics{ device }
+{
+}
+
+GpuProfiler::GpuProfiler(const VDevice &device) : device(device)
+{
+}
+
+void GpuProfiler::init(VkPhysicalDevice physicalDevice, uint32_t queueFamily, uint32_t maxScopes, bool pipelineStatistics)
+{
+	this->maxScopes = maxScopes;
+	this->slots.clear();
+
+	uint32_t familyCount = 0;
+	vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &familyCount, nullptr);
+	std::vector<VkQueueFamilyProperties> families(familyCount);
+	vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &familyCount, families.data());
+	if (queueFamily >= familyCount)
+	{
+		throw std::runtime_error("GpuProfiler given a queue family that doesn't exist!");
+	}
+
+	VkPhysicalDeviceProperties properties;
+	vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+
+	// vkCmdResetQueryPool is graphics & compute only
+	const VkQueueFamilyProperties &family = families[queueFamily];
+	bool canReset = (family.queueFlags & (VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT)) != 0;
+
+	this->timestampsSupported = family.timestampValidBits > 0 && canReset && maxScopes > 0;
+	this->timestampMask = family.timestampValidBits >= 64 ? ~0ull : (1ull << family.timestampValidBits) - 1;
+	this->timestampPeriod = properties.limits.timestampPeriod;
+	this->statisticsSupported = this->timestampsSupported && pipelineStatistics && (family.queueFlags & VK_QUEUE_GRAPHICS_BIT) != 0;
+}
+
+VkQueryPipelineStatisticFlags GpuProfiler::statisticsFlags() const
+{
+	return this->statisticsSupported ? STATISTICS_FLAGS : 0;
+}
+
+GpuProfiler::Slot &GpuProfiler::getSlot(uint32_t slot)
+{
+	while (this->slots.size() <= slot)
+	{
+		std::unique_ptr<Slot> newSlot(new Slot(this->device));
+
+		VkQueryPoolCreateInfo poolInfo = {};
+		poolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+		poolInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+		poolInfo.queryCount = this->maxScopes * 2;
+		if (vkCreateQueryPool(this->device, &poolInfo, nullptr, newSlot->timestamps.replace()) != VK_SUCCESS)
+		{
+			throw std::runtime_error("Couldn't create timestamp query pool!");
+		}
+
+		if (this->statisticsSupported)
+		{
+			poolInfo.queryType = VK_QUERY_TYPE_PIPELINE_STATISTICS;
+			poolInfo.queryCount = this->maxScopes;
+			poolInfo.pipelineStatistics = STATISTICS_FLAGS;
+			if (vkCreateQueryPool(this->device, &poolInfo, nullptr, newSlot->statistics.replace()) != VK_SUCCESS)
+			{
+				throw std::runtime_error("Couldn't create pipeline statistics query pool!");
+			}
+		}
+
+		this->slots.push_back(std::move(newSlot));
+	}
+	return *this->slots[slot];
+}
+
+void GpuProfiler::resetSlot(VkCommandBuffer cmdBuff, uint32_t slot)
+{
+	if (!this->timestampsSupported)
+	{
+		return;
+	}
+
+	Slot &s = this->getSlot(slot);
+	s.scopes.clear();
+	vkCmdResetQueryPool(cmdBuff, s.timestamps, 0, this->maxScopes * 2);
+	if (this->statisticsSupported)
+	{
+		vkCmdResetQueryPool(cmdBuff, s.statistics, 0, this->maxScopes);
+	}
+}
+
+uint32_t GpuProfiler::beginScope(VkCommandBuffer cmdBuff, uint32_t slot, const std::string &name, bool statistics)
+{
+	if (!this->timestampsSupported)
+	{
+		return 0;
+	}
+
+	Slot &s = this->getSlot(slot);
+	uint32_t scope = (uint32_t)s.scopes.size();
+	if (scope >= this->maxScopes)
+	{
+		return this->maxScopes;
+	}
+
+	statistics = statistics && this->statisticsSupported;
+	s.scopes.push_back({ name, statistics });
+
+	// top of pipe: stamped as soon as everything before it
+	// has at least started
+	vkCmdWriteTimestamp(cmdBuff, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, s.timestamps, scope * 2);
+	if (statistics)
+	{
+		vkCmdBeginQuery(cmdBuff, s.statistics, scope, 0);
+	}
+	return scope;
+}
+
+void GpuProfiler::endScope(VkCommandBuffer cmdBuff, uint32_t slot, uint32_t scope)
+{
+	if (!this->timestampsSupported || scope >= this->maxScopes)
+	{
+		return;
+	}
+
+	Slot &s = this->getSlot(slot);
+	if (s.scopes[scope].statistics)
+	{
+		vkCmdEndQuery(cmdBuff, s.statistics, scope);
+	}
+	// bottom of pipe: once everything before it is done
+	vkCmdWriteTimestamp(cmdBuff, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, s.timestamps, scope * 2 + 1);
+}
+
+void GpuProfiler::submitted(uint32_t slot)
+{
+	if (this->timestampsSupported)
+	{
+		this->getSlot(slot).pending = true;
+	}
+}
+
+bool GpuProfiler::collect(uint32_t slot)
+{
+	if (!this->timestampsSupported || slot >= this->slots.size() || !this->slots[slot]->pending)
+	{
+		return false;
+	}
+
+	Slot &s = *this->slots[slot];
+	s.pending = false;
+	if (s.scopes.empty())
+	{
+		return false;
+	}
+
+	// no _WAIT_BIT, the fence was already waited on. if the
+	// driver still says not ready, this slot's just dropped
+	uint32_t scopeCount = (uint32_t)s.scopes.size();
+	std::vector<uint64_t> stamps(scopeCount * 2);
+	if (vkGetQueryPoolResults(this->device, s.timestamps, 0, scopeCount * 2, stamps.size() * sizeof(uint64_t), stamps.data(), sizeof(uint64_t), VK_QUERY_RESULT_64_BIT) != VK_SUCCESS)
+	{
+		return false;
+	}
+
+	this->latestResults.clear();
+	for (uint32_t scope = 0; scope < scopeCount; scope++)
+	{
+		GpuScopeResult result;
+		result.name = s.scopes[scope].name;
+		// masked, so a counter that wrapped in between still
+		// comes out right
+		uint64_t ticks = (stamps[scope * 2 + 1] - stamps[scope * 2]) & this->timestampMask;
+		result.ms = ticks * this->timestampPeriod / 1000000.0;
+
+		uint64_t counts[STATISTICS_COUNT];
+		if (s.scopes[scope].statistics &&
+			vkGetQueryPoolResults(this->device, s.statistics, scope, 1, sizeof(counts), counts, sizeof(counts), VK_QUERY_RESULT_64_BIT) == VK_SUCCESS)
+		{
+			result.hasStatistics = true;
+			result.inputPrimitives = counts[0];
+			result.vertexInvocations = counts[1];
+			result.clippingPrimitives = counts[2];
+			result.fragmentInvocations = counts[3];
+		}
+		this->latestResults.push_back(result);
+
+		auto found = this->averages.find(result.name);
+		if (found == this->averages.end())
+		{
+			this->averageOrder.push_back(result.name);
+			found = this->averages.insert({ result.name, Average() }).first;
+		}
+		Average &average = found->second;
+		average.total.name = result.name;
+		average.total.ms += result.ms;
+		average.total.hasStatistics = average.total.hasStatistics || result.hasStatistics;
+		average.total.inputPrimitives += result.inputPrimitives;
+		average.total.vertexInvocations += result.vertexInvocations;
+		average.total.clippingPrimitives += result.clippingPrimitives;
+		average.total.fragmentInvocations += result.fragmentInvocations;
+		average.samples++;
+	}
+
+	return true;
+}
+
+void GpuProfiler::printResult(std::ostream &out, const GpuScopeResult &result, uint64_t samples)
+{
+	out << "\tgpu " << result.name << ": " << result.ms / samples << " ms";
+	if (result.hasStatistics)
+	{
+		out << ", " << result.inputPrimitives / samples << " primitives in, " << result.clippingPrimitives / samples << " out of clipping, "
+			<< result.vertexInvocations / samples << " vertex & " << result.fragmentInvocations / samples << " fragment invocations";
+	}
+	if (samples > 1)
+	{
+		out << " (avg of " << samples << ")";
+	}
+	out << "\n";
+}
+
+void GpuProfiler::printLatest(std::ostream &out) const
+{
+	for (const GpuScopeResult &result : this->latestResults)
+	{
+		printResult(out, result, 1);
+	}
+}
+
+void GpuProfiler::printAverages(std::ostream &out) const
+{
+	for (const std::string &name : this->averageOrder)
+	{
+		const Average &average = this->averages.at(name);
+		if (average.samples > 0)
+		{
+			printResult(out, average.total, average.samples);
+		}
+	}
+}
+
+void GpuProfiler::resetAverages()
+{
+	for (auto &average : this->averages)
+	{
+		average.second = Average();
+	}
+}
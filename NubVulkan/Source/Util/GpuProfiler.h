@@ -0,0 +1,119 @@
+#pragma once
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include <Util/VHandle.h>
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// What one scope measured on the gpu. the counts are only there if it
+// was a statistics scope and the device does pipeline statistics
+struct GpuScopeResult
+{
+	std::string name;
+	double ms = 0.0;
+	bool hasStatistics = false;
+	uint64_t inputPrimitives = 0;
+	uint64_t vertexInvocations = 0;
+	uint64_t clippingPrimitives = 0;
+	uint64_t fragmentInvocations = 0;
+};
+
+// Times named scopes of command buffers on the gpu with timestamp
+// queries, and optionally counts what went through the pipeline in
+// them. work is split into slots, each being whatever gets submitted
+// and finishes together (a frame in flight, an upload batch) with its
+// own query pools. results are only read once the slot's fence says
+// it's done, so reading them never waits on the gpu.
+//
+// Some queues can't do timestamps (timestampValidBits is 0) and
+// transfer-only ones can't reset queries, in which case everything
+// here just quietly does nothing
+class GpuProfiler
+{
+public:
+	GpuProfiler(const VDevice &device);
+
+	GpuProfiler(const GpuProfiler &) = delete;
+	GpuProfiler &operator=(const GpuProfiler &) = delete;
+
+	// The pipelineStatisticsQuery & inheritedQueries features have to
+	// be turned on for pipelineStatistics (secondaries run inside the
+	// scopes). maxScopes is per slot, any past that aren't measured
+	void init(VkPhysicalDevice physicalDevice, uint32_t queueFamily, uint32_t maxScopes, bool pipelineStatistics);
+	bool hasTimestamps() const { return this->timestampsSupported; }
+	bool hasPipelineStatistics() const { return this->statisticsSupported; }
+	// What secondaries executed inside a statistics scope have to put in
+	// their inheritance info, 0 without statistics
+	VkQueryPipelineStatisticFlags statisticsFlags() const;
+
+	// Recording: forgets the slot's scopes and resets its queries.
+	// outside a render pass, before any of the slot's scopes
+	void resetSlot(VkCommandBuffer cmdBuff, uint32_t slot);
+	// Returns what endScope() wants. begin & end go either both inside
+	// or both outside a render pass
+	uint32_t beginScope(VkCommandBuffer cmdBuff, uint32_t slot, const std::string &name, bool statistics = false);
+	void endScope(VkCommandBuffer cmdBuff, uint32_t slot, uint32_t scope);
+
+	// Submitting: mark the slot submitted, then collect() it once its
+	// fence has been waited on. anything that isn't ready is skipped.
+	// true if latest() now holds the slot's scopes
+	void submitted(uint32_t slot);
+	bool collect(uint32_t slot);
+
+	// The last collect()'s scopes, and the average of every scope (by
+	// name) collected since resetAverages()
+	const std::vector<GpuScopeResult> &latest() const { return this->latestResults; }
+	void printLatest(std::ostream &out) const;
+	void printAverages(std::ostream &out) const;
+	void resetAverages();
+
+private:
+	struct Scope
+	{
+		std::string name;
+		bool statistics;
+	};
+
+	struct Slot
+	{
+		Slot(const VDevice &device);
+
+		// Two timestamps per scope, start & end. one statistics
+		// query per scope, only made with statistics on
+		VQueryPool timestamps;
+		VQueryPool statistics;
+		std::vector<Scope> scopes;
+		bool pending = false;
+	};
+
+	struct Average
+	{
+		GpuScopeResult total;
+		uint64_t samples = 0;
+	};
+
+	// Makes its query pools the first time it's asked for
+	Slot &getSlot(uint32_t slot);
+	static void printResult(std::ostream &out, const GpuScopeResult &result, uint64_t samples);
+
+	const VDevice &device;
+	uint32_t maxScopes = 0;
+	bool timestampsSupported = false;
+	bool statisticsSupported = false;
+	uint64_t timestampMask = 0;
+	// Nanoseconds per tick
+	double timestampPeriod = 0.0;
+
+	std::vector<std::unique_ptr<Slot>> slots;
+	std::vector<GpuScopeResult> latestResults;
+	// In the order names were first seen, so printing's stable
+	std::vector<std::string> averageOrder;
+	std::map<std::string, Average> averages;
+};
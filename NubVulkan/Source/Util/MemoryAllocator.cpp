@@ -0,0 +1,463 @@
+#include <Util/MemoryAllocator.h>
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace
+{
+	VkDeviceSize alignUp(VkDeviceSize value, VkDeviceSize alignment)
+	{
+		return (value + alignment - 1) / alignment * alignment;
+	}
+}
+
+VulkanMemoryBackend::VulkanMemoryBackend(const VDevice &device) : device(device)
+{
+}
+
+VkDeviceMemory VulkanMemoryBackend::allocate(uint32_t memoryTypeIndex, VkDeviceSize size)
+{
+	VkMemoryAllocateInfo allocInfo = {};
+	allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+	allocInfo.allocationSize = size;
+	allocInfo.memoryTypeIndex = memoryTypeIndex;
+
+	VkDeviceMemory memory = VK_NULL_HANDLE;
+	if (vkAllocateMemory(this->device, &allocInfo, nullptr, &memory) != VK_SUCCESS)
+	{
+		return VK_NULL_HANDLE;
+	}
+	return memory;
+}
+
+void VulkanMemoryBackend::free(VkDeviceMemory memory)
+{
+	vkFreeMemory(this->device, memory, nullptr);
+}
+
+void *VulkanMemoryBackend::map(VkDeviceMemory memory, VkDeviceSize size)
+{
+	void *data = nullptr;
+	if (vkMapMemory(this->device, memory, 0, size, 0, &data) != VK_SUCCESS)
+	{
+		return nullptr;
+	}
+	return data;
+}
+
+void VulkanMemoryBackend::unmap(VkDeviceMemory memory)
+{
+	vkUnmapMemory(this->device, memory);
+}
+
+MemoryAllocator::~MemoryAllocator()
+{
+	this->cleanup();
+}
+
+void MemoryAllocator::init(std::unique_ptr<MemoryBackend> backend, const VkPhysicalDeviceMemoryProperties &memProperties, VkDeviceSize preferredBlockSize)
+{
+	this->cleanup();
+
+	this->backend = std::move(backend);
+	this->memProperties = memProperties;
+	this->preferredBlockSize = preferredBlockSize;
+	// Linear and optimal resources get their own pools, that way
+	// bufferImageGranularity never matters inside a block
+	this->pools.resize(memProperties.memoryTypeCount * 2);
+}
+
+void MemoryAllocator::cleanup()
+{
+	// Whatever's still allocated by now is leaked by its owner, the
+	// blocks go regardless
+	for (auto &pool : this->pools)
+	{
+		while (!pool.blocks.empty())
+		{
+			this->releaseBlock(pool.blocks.back().get());
+		}
+	}
+	this->pools.clear();
+	this->backend.reset();
+}
+
+VkDeviceSize MemoryAllocator::getBlockSize(uint32_t memoryTypeIndex)
+{
+	// Don't want to eat a whole small heap (like the 256mb host
+	// visible + device local one on amd) in one or two blocks
+	VkDeviceSize heapSize = this->memProperties.memoryHeaps[this->memProperties.memoryTypes[memoryTypeIndex].heapIndex].size;
+	if (heapSize <= 1024ull * 1024 * 1024)
+	{
+		return std::min(this->preferredBlockSize, alignUp(heapSize / 8, 32));
+	}
+	return this->preferredBlockSize;
+}
+
+MemoryAllocation *MemoryAllocator::allocate(const VkMemoryRequirements &memReqs, uint32_t memoryTypeIndex, bool linear)
+{
+	if (!this->backend || memoryTypeIndex >= this->memProperties.memoryTypeCount)
+	{
+		throw std::runtime_error("Couldn't allocate memory, allocator isn't set up for that type!");
+	}
+
+	size_t poolIndex = memoryTypeIndex * 2 + (linear ? 1 : 0);
+	Pool &pool = this->pools[poolIndex];
+	VkDeviceSize alignment = std::max<VkDeviceSize>(memReqs.alignment, 1);
+	VkDeviceSize blockSize = this->getBlockSize(memoryTypeIndex);
+
+	MemoryBlock *block = nullptr;
+	VkDeviceSize rangeOffset = 0;
+	VkDeviceSize rangeSize = 0;
+	VkDeviceSize alignedOffset = 0;
+
+	if (memReqs.size > blockSize / 2)
+	{
+		// Big boy, it'd just fragment a shared block. gets its own
+		block = this->createBlock(poolIndex, memoryTypeIndex, memReqs.size, true);
+		this->carve(block, memReqs.size, alignment, rangeOffset, rangeSize, alignedOffset);
+	}
+	else
+	{
+		// First fit, blocks are in creation order so the old full ones
+		// get topped up before new ones are touched
+		for (auto &candidate : pool.blocks)
+		{
+			if (!candidate->dedicated && this->carve(candidate.get(), memReqs.size, alignment, rangeOffset, rangeSize, alignedOffset))
+			{
+				block = candidate.get();
+				break;
+			}
+		}
+
+		if (block == nullptr)
+		{
+			block = this->createBlock(poolIndex, memoryTypeIndex, blockSize, false);
+			this->carve(block, memReqs.size, alignment, rangeOffset, rangeSize, alignedOffset);
+		}
+	}
+
+	std::unique_ptr<MemoryAllocation> allocation(new MemoryAllocation());
+	allocation->memory = block->memory;
+	allocation->offset = alignedOffset;
+	allocation->size = memReqs.size;
+	allocation->alignment = alignment;
+	allocation->memoryTypeIndex = memoryTypeIndex;
+	allocation->block = block;
+	allocation->rangeOffset = rangeOffset;
+	allocation->rangeSize = rangeSize;
+	if (block->mapped != nullptr)
+	{
+		allocation->mapped = static_cast<char *>(block->mapped) + alignedOffset;
+	}
+
+	block->usedBytes += rangeSize;
+	MemoryAllocation *result = allocation.get();
+	block->allocations[rangeOffset] = std::move(allocation);
+	return result;
+}
+
+void MemoryAllocator::free(MemoryAllocation *allocation)
+{
+	if (allocation == nullptr)
+	{
+		return;
+	}
+
+	MemoryBlock *block = allocation->block;
+	this->giveBack(block, allocation->rangeOffset, allocation->rangeSize);
+	block->usedBytes -= allocation->rangeSize;
+	block->allocations.erase(allocation->rangeOffset);
+
+	if (!block->allocations.empty())
+	{
+		return;
+	}
+
+	// Keep one empty shared block around per pool so something that
+	// gets freed and reallocated every frame doesn't hammer the driver
+	bool keep = !block->dedicated;
+	if (keep)
+	{
+		for (auto &other : this->pools[block->poolIndex].blocks)
+		{
+			if (other.get() != block && !other->dedicated && other->allocations.empty())
+			{
+				keep = false;
+				break;
+			}
+		}
+	}
+
+	if (!keep)
+	{
+		this->releaseBlock(block);
+	}
+}
+
+void *MemoryAllocator::map(MemoryAllocation *allocation)
+{
+	MemoryBlock *block = allocation->block;
+	// You can't map the same VkDeviceMemory twice, so the whole
+	// block gets mapped once and everyone in it shares that
+	if (block->mapped == nullptr && !this->mapBlock(block))
+	{
+		throw std::runtime_error("Couldn't map memory block!");
+	}
+	return allocation->mapped;
+}
+
+uint32_t MemoryAllocator::defragment(const DefragmentCallback &relocate)
+{
+	uint32_t moved = 0;
+
+	for (auto &pool : this->pools)
+	{
+		std::vector<MemoryBlock *> blocks;
+		for (auto &block : pool.blocks)
+		{
+			if (!block->dedicated)
+			{
+				blocks.push_back(block.get());
+			}
+		}
+
+		if (blocks.size() < 2)
+		{
+			continue;
+		}
+
+		// Drain the emptiest blocks into the fullest ones. only ever
+		// move "up" the list so nothing ping pongs
+		std::sort(blocks.begin(), blocks.end(), [](MemoryBlock *a, MemoryBlock *b) { return a->usedBytes < b->usedBytes; });
+
+		for (size_t src = 0; src + 1 < blocks.size(); src++)
+		{
+			MemoryBlock *source = blocks[src];
+
+			std::vector<MemoryAllocation *> residents;
+			for (auto &entry : source->allocations)
+			{
+				residents.push_back(entry.second.get());
+			}
+
+			for (MemoryAllocation *allocation : residents)
+			{
+				for (size_t dst = blocks.size() - 1; dst > src; dst--)
+				{
+					MemoryBlock *dest = blocks[dst];
+
+					MemoryAllocation to = *allocation;
+					if (!this->carve(dest, allocation->size, allocation->alignment, to.rangeOffset, to.rangeSize, to.offset))
+					{
+						continue;
+					}
+
+					to.memory = dest->memory;
+					to.block = dest;
+					to.mapped = nullptr;
+					// (mapping it points whoever's already in
+					// there at it too, like map() would)
+					if (allocation->mapped != nullptr && dest->mapped == nullptr && !this->mapBlock(dest))
+					{
+						this->giveBack(dest, to.rangeOffset, to.rangeSize);
+						continue;
+					}
+					if (dest->mapped != nullptr)
+					{
+						to.mapped = static_cast<char *>(dest->mapped) + to.offset;
+					}
+
+					if (!relocate(*allocation, to))
+					{
+						this->giveBack(dest, to.rangeOffset, to.rangeSize);
+						break;
+					}
+
+					// Move it over, same MemoryAllocation object so the
+					// owner's pointer stays good
+					std::unique_ptr<MemoryAllocation> owned = std::move(source->allocations[allocation->rangeOffset]);
+					source->allocations.erase(allocation->rangeOffset);
+					this->giveBack(source, allocation->rangeOffset, allocation->rangeSize);
+					source->usedBytes -= allocation->rangeSize;
+
+					*allocation = to;
+					dest->usedBytes += to.rangeSize;
+					dest->allocations[to.rangeOffset] = std::move(owned);
+
+					moved++;
+					break;
+				}
+			}
+		}
+	}
+
+	this->releaseEmptyBlocks();
+	return moved;
+}
+
+void MemoryAllocator::releaseEmptyBlocks()
+{
+	for (auto &pool : this->pools)
+	{
+		std::vector<MemoryBlock *> empty;
+		for (auto &block : pool.blocks)
+		{
+			if (block->allocations.empty())
+			{
+				empty.push_back(block.get());
+			}
+		}
+
+		for (MemoryBlock *block : empty)
+		{
+			this->releaseBlock(block);
+		}
+	}
+}
+
+MemoryAllocatorStats MemoryAllocator::getStats() const
+{
+	MemoryAllocatorStats stats;
+
+	for (auto &pool : this->pools)
+	{
+		for (auto &block : pool.blocks)
+		{
+			stats.blockCount++;
+			if (block->dedicated)
+			{
+				stats.dedicatedBlockCount++;
+			}
+			stats.blockBytes += block->size;
+
+			for (auto &entry : block->allocations)
+			{
+				stats.allocationCount++;
+				stats.usedBytes += entry.second->size;
+				stats.wastedBytes += entry.second->rangeSize - entry.second->size;
+			}
+
+			for (auto &range : block->freeRanges)
+			{
+				stats.freeBytes += range.second;
+				stats.largestFreeRange = std::max(stats.largestFreeRange, range.second);
+			}
+		}
+	}
+
+	return stats;
+}
+
+uint32_t MemoryAllocator::findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties) const
+{
+	for (uint32_t i = 0; i < this->memProperties.memoryTypeCount; i++)
+	{
+		if (typeFilter & (1 << i) && (this->memProperties.memoryTypes[i].propertyFlags & properties) == properties)
+		{
+			return i;
+		}
+	}
+
+	throw std::runtime_error("Couldn't find suitable memory type!");
+}
+
+MemoryBlock *MemoryAllocator::createBlock(size_t poolIndex, uint32_t memoryTypeIndex, VkDeviceSize size, bool dedicated)
+{
+	VkDeviceMemory memory = this->backend->allocate(memoryTypeIndex, size);
+	if (memory == VK_NULL_HANDLE)
+	{
+		throw std::runtime_error("Couldn't allocate memory block!");
+	}
+
+	std::unique_ptr<MemoryBlock> block(new MemoryBlock());
+	block->memory = memory;
+	block->size = size;
+	block->dedicated = dedicated;
+	block->poolIndex = poolIndex;
+	block->freeRanges[0] = size;
+
+	MemoryBlock *result = block.get();
+	this->pools[poolIndex].blocks.push_back(std::move(block));
+	return result;
+}
+
+void MemoryAllocator::releaseBlock(MemoryBlock *block)
+{
+	if (block->mapped != nullptr)
+	{
+		this->backend->unmap(block->memory);
+	}
+	this->backend->free(block->memory);
+
+	auto &blocks = this->pools[block->poolIndex].blocks;
+	blocks.erase(std::find_if(blocks.begin(), blocks.end(), [block](const std::unique_ptr<MemoryBlock> &b) { return b.get() == block; }));
+}
+
+bool MemoryAllocator::mapBlock(MemoryBlock *block)
+{
+	block->mapped = this->backend->map(block->memory, VK_WHOLE_SIZE);
+	if (block->mapped == nullptr)
+	{
+		return false;
+	}
+
+	for (auto &entry : block->allocations)
+	{
+		entry.second->mapped = static_cast<char *>(block->mapped) + entry.second->offset;
+	}
+	return true;
+}
+
+bool MemoryAllocator::carve(MemoryBlock *block, VkDeviceSize size, VkDeviceSize alignment, VkDeviceSize &rangeOffset, VkDeviceSize &rangeSize, VkDeviceSize &alignedOffset)
+{
+	for (auto it = block->freeRanges.begin(); it != block->freeRanges.end(); ++it)
+	{
+		VkDeviceSize start = it->first;
+		VkDeviceSize end = it->first + it->second;
+		VkDeviceSize aligned = alignUp(start, alignment);
+
+		if (aligned + size > end)
+		{
+			continue;
+		}
+
+		// The padding in front stays part of the allocation, it'd be
+		// too small to be any use on its own anyway
+		rangeOffset = start;
+		rangeSize = aligned + size - start;
+		alignedOffset = aligned;
+
+		block->freeRanges.erase(it);
+		if (aligned + size < end)
+		{
+			block->freeRanges[aligned + size] = end - (aligned + size);
+		}
+		return true;
+	}
+	return false;
+}
+
+void MemoryAllocator::giveBack(MemoryBlock *block, VkDeviceSize rangeOffset, VkDeviceSize rangeSize)
+{
+	auto it = block->freeRanges.insert(std::make_pair(rangeOffset, rangeSize)).first;
+
+	// Glue it to whatever free range comes right after...
+	auto next = std::next(it);
+	if (next != block->freeRanges.end() && it->first + it->second == next->first)
+	{
+		it->second += next->second;
+		block->freeRanges.erase(next);
+	}
+
+	// ...and right before
+	if (it != block->freeRanges.begin())
+	{
+		auto prev = std::prev(it);
+		if (prev->first + prev->second == it->first)
+		{
+			prev->second += it->second;
+			block->freeRanges.erase(it);
+		}
+	}
+}
@@ -0,0 +1,210 @@
+#pragma once
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include <Util/VHandle.h>
+
+#include <functional>
+#include <map>
+#include <memory>
+#include <vector>
+
+// Hands out VkDeviceMemory to the allocator. Kept behind an interface
+// so the allocator's bookkeeping can be driven by a fake backend with
+// no gpu around
+class MemoryBackend
+{
+public:
+	virtual ~MemoryBackend() {}
+
+	// VK_NULL_HANDLE if the driver said no
+	virtual VkDeviceMemory allocate(uint32_t memoryTypeIndex, VkDeviceSize size) = 0;
+	virtual void free(VkDeviceMemory memory) = 0;
+	virtual void *map(VkDeviceMemory memory, VkDeviceSize size) = 0;
+	virtual void unmap(VkDeviceMemory memory) = 0;
+};
+
+// The real deal, straight to vkAllocateMemory and co.
+class VulkanMemoryBackend : public MemoryBackend
+{
+public:
+	VulkanMemoryBackend(const VDevice &device);
+
+	VkDeviceMemory allocate(uint32_t memoryTypeIndex, VkDeviceSize size) override;
+	void free(VkDeviceMemory memory) override;
+	void *map(VkDeviceMemory memory, VkDeviceSize size) override;
+	void unmap(VkDeviceMemory memory) override;
+
+private:
+	const VDevice &device;
+};
+
+struct MemoryBlock;
+
+// A slice of some block. bind your buffer/image to memory + offset.
+// the allocator owns these, so the address stays put for as long as
+// the allocation lives (even across defragment())
+struct MemoryAllocation
+{
+	VkDeviceMemory memory = VK_NULL_HANDLE;
+	VkDeviceSize offset = 0;
+	VkDeviceSize size = 0;
+	VkDeviceSize alignment = 1;
+	uint32_t memoryTypeIndex = 0;
+	// Only set once the block's been mapped, see MemoryAllocator::map()
+	void *mapped = nullptr;
+
+	// Bookkeeping, the range we carved out of the block including the
+	// alignment padding in front of offset
+	MemoryBlock *block = nullptr;
+	VkDeviceSize rangeOffset = 0;
+	VkDeviceSize rangeSize = 0;
+};
+
+struct MemoryBlock
+{
+	VkDeviceMemory memory = VK_NULL_HANDLE;
+	VkDeviceSize size = 0;
+	VkDeviceSize usedBytes = 0;
+	void *mapped = nullptr;
+	// Too big to share, got a block all to itself
+	bool dedicated = false;
+	size_t poolIndex = 0;
+
+	// offset -> size, neighbours are always merged
+	std::map<VkDeviceSize, VkDeviceSize> freeRanges;
+	// rangeOffset -> allocation
+	std::map<VkDeviceSize, std::unique_ptr<MemoryAllocation>> allocations;
+};
+
+struct MemoryAllocatorStats
+{
+	uint32_t blockCount = 0;
+	uint32_t dedicatedBlockCount = 0;
+	uint32_t allocationCount = 0;
+	// All the VkDeviceMemory we're holding
+	VkDeviceSize blockBytes = 0;
+	// What was actually asked for
+	VkDeviceSize usedBytes = 0;
+	// Lost to alignment padding
+	VkDeviceSize wastedBytes = 0;
+	// Sitting in free ranges, and the biggest of them
+	VkDeviceSize freeBytes = 0;
+	VkDeviceSize largestFreeRange = 0;
+};
+
+// Called by defragment() for every allocation it'd like to move. copy
+// the contents over and rebind whatever lived there to to.memory +
+// to.offset, then return true. return false to leave it where it is
+typedef std::function<bool(const MemoryAllocation &from, const MemoryAllocation &to)> DefragmentCallback;
+
+// Grabs big VkDeviceMemory blocks per memory type and carves them up
+// with a first fit free list, instead of a vkAllocateMemory per
+// resource (there's a maxMemoryAllocationCount, and it can be as low
+// as 4096!)
+class MemoryAllocator
+{
+public:
+	MemoryAllocator() {}
+	~MemoryAllocator();
+
+	MemoryAllocator(const MemoryAllocator &) = delete;
+	MemoryAllocator &operator=(const MemoryAllocator &) = delete;
+
+	// preferredBlockSize is for the big heaps, small ones get an eighth
+	// of the heap per block
+	void init(std::unique_ptr<MemoryBackend> backend, const VkPhysicalDeviceMemoryProperties &memProperties, VkDeviceSize preferredBlockSize = 64 * 1024 * 1024);
+	void cleanup();
+
+	// linear is true for buffers and linear tiled images, false for
+	// optimal tiled images. they get separate pools so the two never
+	// share a bufferImageGranularity page
+	MemoryAllocation *allocate(const VkMemoryRequirements &memReqs, uint32_t memoryTypeIndex, bool linear);
+	void free(MemoryAllocation *allocation);
+
+	// Maps the whole block the first time, then it stays mapped till
+	// the block is released. only for host visible types obviously
+	void *map(MemoryAllocation *allocation);
+
+	// Try to empty out the least used blocks by moving their
+	// allocations into the others. returns how many got moved
+	uint32_t defragment(const DefragmentCallback &relocate);
+	// Gives back blocks with nothing left in them
+	void releaseEmptyBlocks();
+
+	MemoryAllocatorStats getStats() const;
+
+	// First memory type out of typeFilter with all the properties, just
+	// like HelloTriangleApp::findMemoryType
+	uint32_t findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties) const;
+
+private:
+	struct Pool
+	{
+		std::vector<std::unique_ptr<MemoryBlock>> blocks;
+	};
+
+	VkDeviceSize getBlockSize(uint32_t memoryTypeIndex);
+	MemoryBlock *createBlock(size_t poolIndex, uint32_t memoryTypeIndex, VkDeviceSize size, bool dedicated);
+	void releaseBlock(MemoryBlock *block);
+	// Maps the whole block and points everything in it at the mapping,
+	// false if the backend wouldn't
+	bool mapBlock(MemoryBlock *block);
+	bool carve(MemoryBlock *block, VkDeviceSize size, VkDeviceSize alignment, VkDeviceSize &rangeOffset, VkDeviceSize &rangeSize, VkDeviceSize &alignedOffset);
+	void giveBack(MemoryBlock *block, VkDeviceSize rangeOffset, VkDeviceSize rangeSize);
+
+	std::unique_ptr<MemoryBackend> backend;
+	VkPhysicalDeviceMemoryProperties memProperties = {};
+	VkDeviceSize preferredBlockSize = 0;
+
+	// [memoryTypeIndex * 2 + linear]
+	std::vector<Pool> pools;
+};
+
+// VHandle's cousin for allocations. frees back into the allocator
+// instead of vkFreeMemory-ing
+class VAllocation
+{
+public:
+	VAllocation(MemoryAllocator &allocator) : allocator(&allocator) {}
+	~VAllocation() { this->reset(nullptr); }
+
+	VAllocation(const VAllocation &) = delete;
+	VAllocation &operator=(const VAllocation &) = delete;
+
+	VAllocation(VAllocation &&rhs) : allocator(rhs.allocator), allocation(rhs.allocation)
+	{
+		rhs.allocation = nullptr;
+	}
+
+	VAllocation &operator=(VAllocation &&rhs)
+	{
+		if (this != &rhs)
+		{
+			this->reset(nullptr);
+			this->allocator = rhs.allocator;
+			this->allocation = rhs.allocation;
+			rhs.allocation = nullptr;
+		}
+		return *this;
+	}
+
+	void reset(MemoryAllocation *rhs)
+	{
+		if (this->allocation != nullptr)
+		{
+			this->allocator->free(this->allocation);
+		}
+		this->allocation = rhs;
+	}
+
+	MemoryAllocation *get() const { return this->allocation; }
+	VkDeviceMemory memory() const { return this->allocation->memory; }
+	VkDeviceSize offset() const { return this->allocation->offset; }
+	void *map() { return this->allocator->map(this->allocation); }
+
+private:
+	MemoryAllocator *allocator;
+	MemoryAllocation *allocation = nullptr;
+};
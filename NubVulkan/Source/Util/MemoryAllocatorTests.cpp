@@ -0,0 +1,378 @@
+#include <Util/MemoryAllocatorTests.h>
+#include <Util/MemoryAllocator.h>
+
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace
+{
+	// Small blocks so a handful of allocations is enough to fill one.
+	// the heap's big, so this is the block size that gets used
+	const VkDeviceSize TEST_BLOCK_SIZE = 1024;
+
+	// Hands out made up VkDeviceMemory and keeps track of what's still
+	// alive. mapping gives back real host memory so defragment() copies
+	// can be checked
+	class FakeMemoryBackend : public MemoryBackend
+	{
+	public:
+		VkDeviceMemory allocate(uint32_t /*memoryTypeIndex*/, VkDeviceSize size) override
+		{
+			uint64_t id = ++this->nextId;
+			this->contents[id].assign((size_t)size, 0);
+			this->allocations++;
+			return (VkDeviceMemory)(uintptr_t)id;
+		}
+
+		void free(VkDeviceMemory memory) override
+		{
+			this->contents.erase(toId(memory));
+			this->frees++;
+		}
+
+		void *map(VkDeviceMemory memory, VkDeviceSize /*size*/) override
+		{
+			this->maps++;
+			return this->contents[toId(memory)].data();
+		}
+
+		void unmap(VkDeviceMemory /*memory*/) override
+		{
+			this->unmaps++;
+		}
+
+		size_t liveBlocks() const { return this->contents.size(); }
+		VkDeviceSize blockSize(VkDeviceMemory memory) const { return (VkDeviceSize)this->contents.at(toId(memory)).size(); }
+
+		uint32_t allocations = 0;
+		uint32_t frees = 0;
+		uint32_t maps = 0;
+		uint32_t unmaps = 0;
+
+	private:
+		static uint64_t toId(VkDeviceMemory memory) { return (uint64_t)(uintptr_t)memory; }
+
+		uint64_t nextId = 0;
+		std::map<uint64_t, std::vector<char>> contents;
+	};
+
+	int failures = 0;
+
+	void check(bool passed, const std::string &test, const std::string &what)
+	{
+		if (!passed)
+		{
+			std::cout << "\tFAIL " << test << ": " << what << "\n";
+			failures++;
+		}
+	}
+
+	// One memory type on one big (so preferredBlockSize applies) host
+	// visible heap, set up fresh for every test
+	struct TestAllocator
+	{
+		TestAllocator()
+		{
+			VkPhysicalDeviceMemoryProperties memProperties = {};
+			memProperties.memoryTypeCount = 1;
+			memProperties.memoryTypes[0].heapIndex = 0;
+			memProperties.memoryTypes[0].propertyFlags = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+			memProperties.memoryHeapCount = 1;
+			memProperties.memoryHeaps[0].size = 4ull * 1024 * 1024 * 1024;
+
+			this->backend = new FakeMemoryBackend();
+			this->allocator.init(std::unique_ptr<MemoryBackend>(this->backend), memProperties, TEST_BLOCK_SIZE);
+		}
+
+		MemoryAllocation *allocate(VkDeviceSize size, VkDeviceSize alignment = 1, bool linear = true)
+		{
+			VkMemoryRequirements memReqs = {};
+			memReqs.size = size;
+			memReqs.alignment = alignment;
+			memReqs.memoryTypeBits = 1;
+			return this->allocator.allocate(memReqs, 0, linear);
+		}
+
+		MemoryAllocator allocator;
+		// Owned by the allocator
+		FakeMemoryBackend *backend;
+	};
+
+	void testAlignment()
+	{
+		const std::string test = "alignment";
+		TestAllocator t;
+
+		MemoryAllocation *a = t.allocate(10, 1);
+		MemoryAllocation *b = t.allocate(16, 64);
+		MemoryAllocation *c = t.allocate(8, 8);
+
+		check(a->offset == 0 && a->rangeSize == 10, test, "unaligned allocation starts the block with no padding");
+		check(b->offset == 64 && b->offset % 64 == 0, test, "64 aligned allocation is rounded up to 64");
+		check(b->rangeOffset == 10 && b->rangeSize == 70, test, "the padding in front is part of the range");
+		check(c->offset == 80 && c->rangeOffset == 80 && c->rangeSize == 8, test, "already aligned allocation gets no padding");
+		check(a->memory == b->memory && b->memory == c->memory, test, "small allocations share a block");
+
+		MemoryAllocatorStats stats = t.allocator.getStats();
+		check(stats.wastedBytes == 54, test, "padding counted as wasted");
+		check(stats.usedBytes == 34, test, "used is what was asked for");
+	}
+
+	void testFirstFitReuse()
+	{
+		const std::string test = "first fit";
+		TestAllocator t;
+
+		MemoryAllocation *a = t.allocate(100);
+		MemoryAllocation *b = t.allocate(100);
+		MemoryAllocation *c = t.allocate(100);
+		t.allocator.free(b);
+
+		MemoryAllocation *d = t.allocate(50);
+		check(d->offset == 100 && d->memory == a->memory, test, "reuses the first hole that fits");
+		MemoryAllocation *e = t.allocate(60);
+		check(e->offset == 300, test, "skips a hole that's too small");
+		MemoryAllocation *f = t.allocate(50);
+		check(f->offset == 150, test, "fills the rest of the hole");
+		check(t.backend->allocations == 1, test, "never needed a second block");
+
+		t.allocator.free(a);
+		t.allocator.free(c);
+		t.allocator.free(d);
+		t.allocator.free(e);
+		t.allocator.free(f);
+	}
+
+	void testMerging()
+	{
+		const std::string test = "merging";
+		TestAllocator t;
+
+		// a keeps the block alive, so nothing gets released
+		MemoryAllocation *keep = t.allocate(100);
+		MemoryAllocation *a = t.allocate(100);
+		MemoryAllocation *b = t.allocate(100);
+		MemoryAllocation *c = t.allocate(100);
+		MemoryBlock *block = keep->block;
+
+		t.allocator.free(a);
+		t.allocator.free(c);
+		// c merged with the free tail, a is on its own
+		check(block->freeRanges.size() == 2, test, "freeing next to the tail merges with it");
+		check(block->freeRanges.count(100) == 1 && block->freeRanges[100] == 100, test, "a's range is free on its own");
+
+		t.allocator.free(b);
+		// b glues a, itself and the tail together
+		check(block->freeRanges.size() == 1, test, "freeing between two free ranges merges all three");
+		check(block->freeRanges.count(100) == 1 && block->freeRanges[100] == TEST_BLOCK_SIZE - 100, test, "merged range covers everything after keep");
+
+		MemoryAllocatorStats stats = t.allocator.getStats();
+		check(stats.largestFreeRange == TEST_BLOCK_SIZE - 100, test, "largest free range is the merged one");
+
+		t.allocator.free(keep);
+		check(block->freeRanges.size() == 1 && block->freeRanges[0] == TEST_BLOCK_SIZE, test, "an empty block is one free range");
+	}
+
+	void testDedicated()
+	{
+		const std::string test = "dedicated";
+		TestAllocator t;
+
+		MemoryAllocation *small = t.allocate(TEST_BLOCK_SIZE / 2);
+		MemoryAllocation *big = t.allocate(TEST_BLOCK_SIZE / 2 + 1);
+
+		check(!small->block->dedicated, test, "exactly half a block still shares");
+		check(big->block->dedicated && big->offset == 0, test, "over half a block gets its own");
+		check(t.backend->blockSize(big->memory) == TEST_BLOCK_SIZE / 2 + 1, test, "dedicated block is exactly the request's size");
+
+		MemoryAllocation *another = t.allocate(10);
+		check(another->memory == small->memory, test, "nothing else goes in a dedicated block");
+
+		MemoryAllocatorStats stats = t.allocator.getStats();
+		check(stats.blockCount == 2 && stats.dedicatedBlockCount == 1, test, "stats count the dedicated block");
+
+		uint32_t freesBefore = t.backend->frees;
+		t.allocator.free(big);
+		check(t.backend->frees == freesBefore + 1, test, "dedicated block goes as soon as it's empty");
+
+		t.allocator.free(small);
+		t.allocator.free(another);
+	}
+
+	void testKeepsOneEmptyBlock()
+	{
+		const std::string test = "empty block";
+		TestAllocator t;
+
+		// 2 per block, so 3 blocks
+		std::vector<MemoryAllocation *> allocations;
+		for (int i = 0; i < 6; i++)
+		{
+			allocations.push_back(t.allocate(400));
+		}
+		check(t.backend->liveBlocks() == 3, test, "400 byte allocations fill 3 blocks");
+
+		for (MemoryAllocation *allocation : allocations)
+		{
+			t.allocator.free(allocation);
+		}
+		check(t.backend->liveBlocks() == 1, test, "one empty block is kept, the rest go");
+
+		// the kept one gets reused rather than a new one made
+		uint32_t allocationsBefore = t.backend->allocations;
+		MemoryAllocation *again = t.allocate(400);
+		check(t.backend->allocations == allocationsBefore, test, "the kept block is reused");
+
+		// linear and optimal never share, and each keeps its own
+		MemoryAllocation *optimal = t.allocate(400, 1, false);
+		check(optimal->memory != again->memory, test, "optimal tiled resources get their own block");
+		t.allocator.free(optimal);
+		t.allocator.free(again);
+		check(t.backend->liveBlocks() == 2, test, "each pool keeps its own empty block");
+
+		t.allocator.releaseEmptyBlocks();
+		check(t.backend->liveBlocks() == 0, test, "releaseEmptyBlocks() gives back the kept ones");
+	}
+
+	void testDefragment()
+	{
+		const std::string test = "defragment";
+		TestAllocator t;
+
+		// two blocks of two, then a hole in each
+		MemoryAllocation *a = t.allocate(400, 16);
+		MemoryAllocation *b = t.allocate(400, 16);
+		MemoryAllocation *c = t.allocate(400, 16);
+		MemoryAllocation *d = t.allocate(400, 16);
+		check(a->memory == b->memory && c->memory == d->memory && a->memory != c->memory, test, "four allocations fill two blocks");
+
+		memset(t.allocator.map(a), 'a', 400);
+		memset(t.allocator.map(d), 'd', 400);
+		t.allocator.free(b);
+		t.allocator.free(c);
+
+		// said no, nothing moves
+		MemoryAllocatorStats before = t.allocator.getStats();
+		uint32_t moved = t.allocator.defragment([](const MemoryAllocation &, const MemoryAllocation &) { return false; });
+		MemoryAllocatorStats after = t.allocator.getStats();
+		check(moved == 0 && t.backend->liveBlocks() == 2, test, "a refused move leaves everything where it was");
+		check(after.freeBytes == before.freeBytes && after.largestFreeRange == before.largestFreeRange, test, "a refused move gives its destination range back");
+
+		VkDeviceMemory aBefore = a->memory;
+		VkDeviceMemory dBefore = d->memory;
+		uint32_t calls = 0;
+		moved = t.allocator.defragment([&calls](const MemoryAllocation &from, const MemoryAllocation &to)
+		{
+			calls++;
+			if (from.mapped == nullptr || to.mapped == nullptr || to.memory == from.memory || to.offset % from.alignment != 0)
+			{
+				return false;
+			}
+			memcpy(to.mapped, from.mapped, (size_t)from.size);
+			return true;
+		});
+
+		check(moved == 1 && calls == 1, test, "one allocation moved over");
+		check(t.backend->liveBlocks() == 1, test, "the emptied block was released");
+		check(a->memory == d->memory, test, "both allocations now share a block");
+		check(a->memory == aBefore || d->memory == dBefore, test, "only one of them changed block");
+
+		// same MemoryAllocation objects, and the data came along
+		const char *aData = static_cast<const char *>(a->mapped);
+		const char *dData = static_cast<const char *>(d->mapped);
+		check(aData != nullptr && dData != nullptr && aData[0] == 'a' && aData[399] == 'a' && dData[0] == 'd' && dData[399] == 'd', test, "contents copied through the callback");
+		check(a->offset % 16 == 0 && d->offset % 16 == 0, test, "moved allocation keeps its alignment");
+
+		MemoryAllocatorStats stats = t.allocator.getStats();
+		check(stats.allocationCount == 2 && stats.usedBytes == 800, test, "stats after the move");
+
+		t.allocator.free(a);
+		t.allocator.free(d);
+	}
+
+	void testDefragmentIntoUnmappedBlock()
+	{
+		const std::string test = "defragment into an unmapped block";
+		TestAllocator t;
+
+		// e & f fill a block nobody's mapped, so g goes in a
+		// second one (mapped). with f gone, e's block is the
+		// fuller one and g gets moved into it
+		MemoryAllocation *e = t.allocate(500, 16);
+		MemoryAllocation *f = t.allocate(500, 16);
+		MemoryAllocation *g = t.allocate(200, 16);
+		t.allocator.free(f);
+		check(e->memory != g->memory && e->mapped == nullptr, test, "the destination block starts unmapped");
+
+		memset(t.allocator.map(g), 'g', 200);
+
+		uint32_t moved = t.allocator.defragment([](const MemoryAllocation &from, const MemoryAllocation &to)
+		{
+			if (from.mapped == nullptr || to.mapped == nullptr)
+			{
+				return false;
+			}
+			memcpy(to.mapped, from.mapped, (size_t)from.size);
+			return true;
+		});
+
+		check(moved == 1 && e->memory == g->memory, test, "g moved in with e");
+		// mapping the block for g has to have pointed e at it too
+		check(e->mapped != nullptr && t.allocator.map(e) == e->mapped, test, "what was already in the block got its mapping");
+		const char *gData = static_cast<const char *>(g->mapped);
+		check(gData != nullptr && gData[0] == 'g' && gData[199] == 'g', test, "contents copied through the callback");
+		check(static_cast<const char *>(e->mapped) + (g->offset - e->offset) == gData, test, "both point into the same mapping");
+
+		t.allocator.free(e);
+		t.allocator.free(g);
+	}
+
+	void testStats()
+	{
+		const std::string test = "stats";
+		TestAllocator t;
+
+		MemoryAllocatorStats empty = t.allocator.getStats();
+		check(empty.blockCount == 0 && empty.blockBytes == 0 && empty.allocationCount == 0, test, "nothing allocated, nothing counted");
+
+		MemoryAllocation *a = t.allocate(100, 1);
+		MemoryAllocation *b = t.allocate(100, 256);
+		MemoryAllocation *big = t.allocate(2000);
+		MemoryAllocation *optimal = t.allocate(300, 1, false);
+
+		MemoryAllocatorStats stats = t.allocator.getStats();
+		check(stats.blockCount == 3 && stats.dedicatedBlockCount == 1, test, "block counts");
+		check(stats.blockBytes == TEST_BLOCK_SIZE * 2 + 2000, test, "block bytes");
+		check(stats.allocationCount == 4, test, "allocation count");
+		check(stats.usedBytes == 2500, test, "used bytes");
+		check(stats.wastedBytes == 156, test, "wasted bytes");
+		check(stats.usedBytes + stats.wastedBytes + stats.freeBytes == stats.blockBytes, test, "used + wasted + free adds up to the blocks");
+		check(stats.largestFreeRange == TEST_BLOCK_SIZE - 300, test, "largest free range");
+
+		t.allocator.free(a);
+		t.allocator.free(b);
+		t.allocator.free(big);
+		t.allocator.free(optimal);
+	}
+}
+
+int runMemoryAllocatorTests()
+{
+	failures = 0;
+
+	testAlignment();
+	testFirstFitReuse();
+	testMerging();
+	testDedicated();
+	testKeepsOneEmptyBlock();
+	testDefragment();
+	testDefragmentIntoUnmappedBlock();
+	testStats();
+
+	std::cout << "memory allocator: " << (failures == 0 ? "all passed" : std::to_string(failures) + " failed") << "\n";
+	return failures;
+}
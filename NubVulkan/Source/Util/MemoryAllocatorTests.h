@@ -0,0 +1,7 @@
+#pragma once
+
+// Runs MemoryAllocator through its paces against a fake backend, no gpu
+// needed: alignment, first fit reuse, free range merging, dedicated
+// blocks, keeping an empty block, defragment() and getStats(). prints
+// every check that fails, returns how many did
+int runMemoryAllocatorTests();
@@ -0,0 +1,429 @@
+#include <Util/MeshCache.h>
+#include <Util/FileUtil.h>
+#include <Util/MeshIngest.h>
+#include <Util/MeshOptimizer.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <stdexcept>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+	const char MESH_CACHE_MAGIC[4] = { 'N', 'M', 'S', 'H' };
+
+	// What the vertex & index blobs start on, so the mapped pointers
+	// are fine to read as floats & uints straight away
+	const uint64_t MESH_CACHE_BLOB_ALIGNMENT = 16;
+
+	// How many times benchmarkMeshCache() does each load
+	const size_t MESH_CACHE_BENCH_RUNS = 5;
+
+	// Where benchmarkMeshCache() reads the cache into, so reading
+	// it through can't be optimised out
+	volatile uint32_t meshCacheBenchSink = 0;
+
+	double median(std::vector<double> values)
+	{
+		std::sort(values.begin(), values.end());
+		return values[values.size() / 2];
+	}
+
+	uint64_t alignUp(uint64_t value, uint64_t alignment)
+	{
+		return (value + alignment - 1) / alignment * alignment;
+	}
+}
+
+MappedFile::~MappedFile()
+{
+	this->close();
+}
+
+bool MappedFile::open(const std::string &path)
+{
+	this->close();
+
+#ifdef _WIN32
+	HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (file == INVALID_HANDLE_VALUE)
+	{
+		return false;
+	}
+	this->file = file;
+
+	LARGE_INTEGER fileSize;
+	if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0)
+	{
+		this->close();
+		return false;
+	}
+	this->length = (size_t)fileSize.QuadPart;
+
+	this->mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (this->mapping == nullptr)
+	{
+		this->close();
+		return false;
+	}
+
+	this->view = static_cast<const char *>(MapViewOfFile(this->mapping, FILE_MAP_READ, 0, 0, 0));
+#else
+	this->fd = ::open(path.c_str(), O_RDONLY);
+	if (this->fd < 0)
+	{
+		return false;
+	}
+
+	struct stat st;
+	if (fstat(this->fd, &st) != 0 || st.st_size == 0)
+	{
+		this->close();
+		return false;
+	}
+	this->length = (size_t)st.st_size;
+
+	void *view = mmap(nullptr, this->length, PROT_READ, MAP_PRIVATE, this->fd, 0);
+	this->view = view == MAP_FAILED ? nullptr : static_cast<const char *>(view);
+#endif
+
+	if (this->view == nullptr)
+	{
+		this->close();
+		return false;
+	}
+	return true;
+}
+
+void MappedFile::close()
+{
+#ifdef _WIN32
+	if (this->view != nullptr)
+	{
+		UnmapViewOfFile(this->view);
+	}
+	if (this->mapping != nullptr)
+	{
+		CloseHandle(this->mapping);
+	}
+	if (this->file != nullptr)
+	{
+		CloseHandle(this->file);
+	}
+	this->mapping = nullptr;
+	this->file = nullptr;
+#else
+	if (this->view != nullptr)
+	{
+		munmap(const_cast<char *>(this->view), this->length);
+	}
+	if (this->fd >= 0)
+	{
+		::close(this->fd);
+	}
+	this->fd = -1;
+#endif
+	this->view = nullptr;
+	this->length = 0;
+}
+
+uint64_t MeshCache::hashFile(const std::string &path)
+{
+	// "did the obj change", a chunk at a time
+	uint64_t hash = FNV1A_SEED;
+
+	std::ifstream file(path, std::ios::binary);
+	if (!file.is_open())
+	{
+		return 0;
+	}
+
+	std::vector<char> chunk(1 << 20);
+	while (file)
+	{
+		file.read(chunk.data(), chunk.size());
+		hash = hashFnv1a(chunk.data(), (size_t)file.gcount(), hash);
+	}
+
+	return hash;
+}
+
+bool MeshCache::stampFile(const std::string &path, FileStamp &stamp)
+{
+#ifdef _WIN32
+	WIN32_FILE_ATTRIBUTE_DATA attributes;
+	if (!GetFileAttributesExA(path.c_str(), GetFileExInfoStandard, &attributes))
+	{
+		return false;
+	}
+	stamp.size = ((uint64_t)attributes.nFileSizeHigh << 32) | attributes.nFileSizeLow;
+	stamp.modified = (int64_t)(((uint64_t)attributes.ftLastWriteTime.dwHighDateTime << 32) | attributes.ftLastWriteTime.dwLowDateTime);
+#else
+	struct stat st;
+	if (stat(path.c_str(), &st) != 0)
+	{
+		return false;
+	}
+	stamp.size = (uint64_t)st.st_size;
+	stamp.modified = (int64_t)st.st_mtim.tv_sec * 1000000000 + st.st_mtim.tv_nsec;
+#endif
+	return true;
+}
+
+bool MeshCache::open(const std::string &cachePath, const std::string &sourcePath)
+{
+	this->close();
+
+	if (!this->file.open(cachePath) || this->file.size() < sizeof(MeshCacheHeader))
+	{
+		this->close();
+		return false;
+	}
+
+	const MeshCacheHeader *header = reinterpret_cast<const MeshCacheHeader *>(this->file.data());
+
+	// Anything off and we just pretend it isn't there, the caller
+	// reparses and writes a fresh one. the blobs have to be where
+	// write() puts them, aligned & after the header, and the
+	// checks are written so a garbage count can't overflow its
+	// way past
+	uint64_t fileSize = this->file.size();
+	bool valid =
+		memcmp(header->magic, MESH_CACHE_MAGIC, sizeof(MESH_CACHE_MAGIC)) == 0 &&
+		header->version == MESH_CACHE_VERSION &&
+		header->vertexStride == sizeof(Vertex) &&
+		header->indexSize == sizeof(uint32_t) &&
+		header->vertexOffset % MESH_CACHE_BLOB_ALIGNMENT == 0 && header->vertexOffset >= sizeof(MeshCacheHeader) &&
+		header->indexOffset % MESH_CACHE_BLOB_ALIGNMENT == 0 && header->indexOffset >= sizeof(MeshCacheHeader) &&
+		header->vertexOffset <= fileSize && header->vertexCount <= (fileSize - header->vertexOffset) / sizeof(Vertex) &&
+		header->indexOffset <= fileSize && header->indexCount <= (fileSize - header->indexOffset) / sizeof(uint32_t);
+
+	// same size & write time, it's the obj we cached. otherwise
+	// it has to be read through to be sure
+	FileStamp stamp;
+	bool restamp = false;
+	if (valid)
+	{
+		valid = stampFile(sourcePath, stamp);
+	}
+	if (valid && (stamp.size != header->sourceSize || stamp.modified != header->sourceModified))
+	{
+		uint64_t sourceHash = hashFile(sourcePath);
+		valid = sourceHash != 0 && sourceHash == header->sourceHash;
+		restamp = valid;
+	}
+
+	if (!valid)
+	{
+		this->close();
+		return false;
+	}
+
+	// Touched but not changed (a checkout, say). the new stamp
+	// goes in so the next start doesn't hash it all over again.
+	// the mapping's read only, and windows won't let the file be
+	// written while it's open, so it's closed, patched & mapped
+	// again. if the patch doesn't take, it's still a good cache
+	if (restamp)
+	{
+		this->file.close();
+		{
+			std::fstream patch(cachePath, std::ios::in | std::ios::out | std::ios::binary);
+			patch.seekp(offsetof(MeshCacheHeader, sourceSize));
+			patch.write(reinterpret_cast<const char *>(&stamp.size), sizeof(stamp.size));
+			patch.seekp(offsetof(MeshCacheHeader, sourceModified));
+			patch.write(reinterpret_cast<const char *>(&stamp.modified), sizeof(stamp.modified));
+		}
+
+		if (!this->file.open(cachePath) || this->file.size() != fileSize)
+		{
+			this->close();
+			return false;
+		}
+		header = reinterpret_cast<const MeshCacheHeader *>(this->file.data());
+	}
+
+	this->header = header;
+	return true;
+}
+
+void MeshCache::close()
+{
+	this->header = nullptr;
+	this->file.close();
+}
+
+bool MeshCache::write(const std::string &cachePath, const std::string &sourcePath, const std::vector<Vertex> &vertices, const std::vector<uint32_t> &indices)
+{
+	// stamped first, so an edit while it's hashing leaves
+	// a stamp that won't match next time
+	FileStamp stamp;
+	if (!stampFile(sourcePath, stamp))
+	{
+		return false;
+	}
+	uint64_t sourceHash = hashFile(sourcePath);
+	if (sourceHash == 0)
+	{
+		return false;
+	}
+
+	MeshCacheHeader header = {};
+	memcpy(header.magic, MESH_CACHE_MAGIC, sizeof(MESH_CACHE_MAGIC));
+	header.version = MESH_CACHE_VERSION;
+	header.sourceHash = sourceHash;
+	header.sourceSize = stamp.size;
+	header.sourceModified = stamp.modified;
+	header.vertexStride = sizeof(Vertex);
+	header.indexSize = sizeof(uint32_t);
+	header.vertexCount = vertices.size();
+	header.indexCount = indices.size();
+	header.vertexOffset = alignUp(sizeof(MeshCacheHeader), MESH_CACHE_BLOB_ALIGNMENT);
+	header.indexOffset = alignUp(header.vertexOffset + vertices.size() * sizeof(Vertex), MESH_CACHE_BLOB_ALIGNMENT);
+
+	glm::vec3 boundsMin(std::numeric_limits<float>::max());
+	glm::vec3 boundsMax(-std::numeric_limits<float>::max());
+	for (const auto &vertex : vertices)
+	{
+		boundsMin = glm::min(boundsMin, vertex.pos);
+		boundsMax = glm::max(boundsMax, vertex.pos);
+	}
+	memcpy(header.boundsMin, &boundsMin, sizeof(header.boundsMin));
+	memcpy(header.boundsMax, &boundsMax, sizeof(header.boundsMax));
+
+	return writeFileReplacing(cachePath, [&](std::ostream &file)
+	{
+		const char zeros[MESH_CACHE_BLOB_ALIGNMENT] = {};
+		file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+		file.write(zeros, header.vertexOffset - sizeof(header));
+		file.write(reinterpret_cast<const char *>(vertices.data()), vertices.size() * sizeof(Vertex));
+		file.write(zeros, header.indexOffset - (header.vertexOffset + vertices.size() * sizeof(Vertex)));
+		file.write(reinterpret_cast<const char *>(indices.data()), indices.size() * sizeof(uint32_t));
+	});
+}
+
+MeshView MeshCache::getView() const
+{
+	MeshView view;
+	if (this->header != nullptr)
+	{
+		view.vertices = reinterpret_cast<const Vertex *>(this->file.data() + this->header->vertexOffset);
+		view.vertexCount = (size_t)this->header->vertexCount;
+		view.indices = reinterpret_cast<const uint32_t *>(this->file.data() + this->header->indexOffset);
+		view.indexCount = (size_t)this->header->indexCount;
+	}
+	return view;
+}
+
+glm::vec3 MeshCache::getBoundsMin() const
+{
+	return glm::vec3(this->header->boundsMin[0], this->header->boundsMin[1], this->header->boundsMin[2]);
+}
+
+glm::vec3 MeshCache::getBoundsMax() const
+{
+	return glm::vec3(this->header->boundsMax[0], this->header->boundsMax[1], this->header->boundsMax[2]);
+}
+
+void benchmarkMeshCache(const std::string &objPath)
+{
+	// next to the obj, like the real one, but not in its way
+	std::string cachePath = objPath + ".bench.nubmesh";
+	size_t vertexCount = 0;
+	size_t indexCount = 0;
+
+	// Cold: everything loadModel() does without a cache
+	std::vector<double> coldMs;
+	for (size_t run = 0; run < MESH_CACHE_BENCH_RUNS; run++)
+	{
+		auto start = std::chrono::high_resolution_clock::now();
+
+		tinyobj::attrib_t attrib;
+		std::vector<tinyobj::shape_t> shapes;
+		std::vector<tinyobj::material_t> materials;
+		std::string err;
+		if (!tinyobj::LoadObj(&attrib, &shapes, &materials, &err, objPath.c_str()))
+		{
+			throw std::runtime_error(err);
+		}
+
+		std::vector<Vertex> vertices;
+		std::vector<uint32_t> indices;
+		ingestMesh(attrib, shapes, 0, vertices, indices);
+		optimizeMesh(vertices, indices);
+
+		if (!MeshCache::write(cachePath, objPath, vertices, indices))
+		{
+			throw std::runtime_error("Couldn't write the mesh cache " + cachePath + "!");
+		}
+
+		coldMs.push_back(std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count());
+		vertexCount = vertices.size();
+		indexCount = indices.size();
+	}
+
+	// Warm: the stamp matches, so it's just the mapping. the
+	// upload reads every byte of it, so this does too
+	std::vector<double> warmMs;
+	for (size_t run = 0; run < MESH_CACHE_BENCH_RUNS; run++)
+	{
+		auto start = std::chrono::high_resolution_clock::now();
+
+		MeshCache cache;
+		if (!cache.open(cachePath, objPath))
+		{
+			std::remove(cachePath.c_str());
+			throw std::runtime_error("Couldn't open the mesh cache " + cachePath + " that was just written!");
+		}
+
+		MeshView view = cache.getView();
+		uint32_t sum = 0;
+		for (size_t i = 0; i < view.vertexCount; i++)
+		{
+			uint32_t bits;
+			memcpy(&bits, &view.vertices[i].pos.x, sizeof(bits));
+			sum += bits;
+		}
+		for (size_t i = 0; i < view.indexCount; i++)
+		{
+			sum += view.indices[i];
+		}
+		meshCacheBenchSink = sum;
+
+		warmMs.push_back(std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count());
+	}
+
+	// What a warm start costs on top when the obj's been
+	// touched (or copied) and has to be hashed to check
+	std::vector<double> hashMs;
+	for (size_t run = 0; run < MESH_CACHE_BENCH_RUNS; run++)
+	{
+		auto start = std::chrono::high_resolution_clock::now();
+		meshCacheBenchSink = (uint32_t)MeshCache::hashFile(objPath);
+		hashMs.push_back(std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count());
+	}
+
+	std::remove(cachePath.c_str());
+
+	std::cout << objPath << ": " << vertexCount << " verts, " << indexCount << " indices, best & median of " << MESH_CACHE_BENCH_RUNS << " runs\n"
+		<< "\tcold (parse, dedup, optimize, write cache): " << *std::min_element(coldMs.begin(), coldMs.end()) << " ms, " << median(coldMs) << " ms\n"
+		<< "\twarm (stamp check, map, read through): " << *std::min_element(warmMs.begin(), warmMs.end()) << " ms, " << median(warmMs) << " ms, "
+		<< median(coldMs) / median(warmMs) << "x faster\n"
+		<< "\t+ hashing the obj if its stamp changed: " << *std::min_element(hashMs.begin(), hashMs.end()) << " ms, " << median(hashMs) << " ms\n";
+}
@@ -0,0 +1,116 @@
+#pragma once
+
+#include <Util/Constants.h>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Read only view of a whole file mapped into memory. mmap on linux,
+// CreateFileMapping on windows
+class MappedFile
+{
+public:
+	MappedFile() {}
+	~MappedFile();
+
+	MappedFile(const MappedFile &) = delete;
+	MappedFile &operator=(const MappedFile &) = delete;
+
+	bool open(const std::string &path);
+	void close();
+
+	const char *data() const { return this->view; }
+	size_t size() const { return this->length; }
+
+private:
+	const char *view = nullptr;
+	size_t length = 0;
+#ifdef _WIN32
+	void *file = nullptr;
+	void *mapping = nullptr;
+#else
+	int fd = -1;
+#endif
+};
+
+// What a .nubmesh file starts with. the vertex & index blobs follow at
+// their offsets, raw, exactly as they get uploaded
+struct MeshCacheHeader
+{
+	char magic[4];
+	uint32_t version;
+	// FNV-1a of the whole source .obj, so an edited model gets reparsed
+	uint64_t sourceHash;
+	// The .obj's size & last write time when it was hashed. while they
+	// still match there's no need to read the whole thing again
+	uint64_t sourceSize;
+	int64_t sourceModified;
+	uint32_t vertexStride;
+	uint32_t indexSize;
+	uint64_t vertexCount;
+	uint64_t indexCount;
+	uint64_t vertexOffset;
+	uint64_t indexOffset;
+	float boundsMin[3];
+	float boundsMax[3];
+};
+
+// Bump whenever the header or Vertex changes, or what gets done to the
+// mesh before it's written
+// 2: verts & indices are optimizeMesh()'d
+// 3: the source's size & write time
+const uint32_t MESH_CACHE_VERSION = 3;
+
+// Cheap stand in for the file's contents, from one stat
+struct FileStamp
+{
+	uint64_t size = 0;
+	// in whatever units the os keeps, only ever compared
+	int64_t modified = 0;
+};
+
+// Where the mesh data for uploading lives, either our own vectors or
+// straight out of a mapped cache file
+struct MeshView
+{
+	const Vertex *vertices = nullptr;
+	size_t vertexCount = 0;
+	const uint32_t *indices = nullptr;
+	size_t indexCount = 0;
+};
+
+// Binary cache of a parsed + deduplicated model, so warm starts skip
+// tinyobj entirely and just map the file
+class MeshCache
+{
+public:
+	static uint64_t hashFile(const std::string &path);
+	// false if it can't be stat'd
+	static bool stampFile(const std::string &path, FileStamp &stamp);
+
+	// false if there's no cache, or it's stale/broken. sourcePath only
+	// gets hashed if its size or write time changed since the cache was
+	// written. a touched but unchanged obj still counts as fresh, and
+	// its new stamp is written into the cache so it's only hashed once
+	bool open(const std::string &cachePath, const std::string &sourcePath);
+	void close();
+
+	// Hashes & stamps sourcePath to go in the header
+	static bool write(const std::string &cachePath, const std::string &sourcePath, const std::vector<Vertex> &vertices, const std::vector<uint32_t> &indices);
+
+	// Points into the mapping, valid till close()
+	MeshView getView() const;
+	glm::vec3 getBoundsMin() const;
+	glm::vec3 getBoundsMax() const;
+
+private:
+	MappedFile file;
+	const MeshCacheHeader *header = nullptr;
+};
+
+// No gpu needed. times a cold load of objPath (parse, dedup, optimize,
+// write the cache) against a warm one (check, map & read the cache
+// through) a few times each, and how long hashing the obj takes when
+// its stamp's changed. the cache it makes is deleted after
+void benchmarkMeshCache(const std::string &objPath);
@@ -0,0 +1,327 @@
+#include <Util/MeshIngest.h>
+#include <Util/VertexHashMap.h>
+#include <Util/CpuProfiler.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <stdexcept>
+#include <thread>
+#include <unordered_map>
+
+namespace
+{
+	// Big enough that the per chunk overhead disappears, small enough
+	// that one giant shape still spreads across every core
+	const size_t INGEST_CHUNK_INDICES = 1 << 18;
+
+	struct IngestChunk
+	{
+		const tinyobj::index_t *indices = nullptr;
+		size_t count = 0;
+		// Where this chunk's indices start in the merged index buffer
+		size_t firstIndex = 0;
+
+		// Chunk local dedup, verts in first seen order
+		std::vector<Vertex> localVertices;
+		std::vector<uint32_t> localIndices;
+		// local vertex -> merged vertex
+		std::vector<uint32_t> remap;
+	};
+
+	Vertex makeVertex(const tinyobj::attrib_t &attrib, const tinyobj::index_t &index)
+	{
+		Vertex vertex = {};
+
+		vertex.pos = {
+			attrib.vertices[3 * index.vertex_index + 0],
+			attrib.vertices[3 * index.vertex_index + 1],
+			attrib.vertices[3 * index.vertex_index + 2]
+		};
+		// sadly, tinyobjloader's attrib.vertices
+		// array is in floats, so it isnt a glm::vec3,
+		// which results in us having to multiply the
+		// index by 3. likewise for the tex coords
+		// below
+
+		vertex.texCoord = {
+			attrib.texcoords[2 * index.texcoord_index + 0],
+			1.0f - attrib.texcoords[2 * index.texcoord_index + 1]
+		};
+
+		vertex.norm = { 1.0f, 1.0f, 1.0f };
+		// placeholder for now lol
+
+		return vertex;
+	}
+
+	// Stream sizes benchmarkVertexDedup() goes through
+	const size_t DEDUP_BENCH_SIZES[] = { 10000, 100000, 1000000, 10000000, 50000000 };
+
+	// The index'th entry of a synthetic triangle list over a grid of
+	// gridSide x gridSide verts, two triangles per quad in row order.
+	// like a real mesh, each vert comes up about 6 times and mostly
+	// close to where it was last seen. made on the fly so a 50M index
+	// stream doesn't need 1.6GB of Vertex first
+	Vertex makeGridVertex(size_t index, size_t gridSide)
+	{
+		// corners of a quad's two triangles, as (x, y) offsets
+		const unsigned cornerX[6] = { 0, 1, 1, 0, 1, 0 };
+		const unsigned cornerY[6] = { 0, 0, 1, 0, 1, 1 };
+
+		size_t quad = index / 6;
+		size_t corner = index % 6;
+		size_t x = quad % (gridSide - 1) + cornerX[corner];
+		size_t y = quad / (gridSide - 1) + cornerY[corner];
+
+		Vertex vertex = {};
+		vertex.pos = { (float)x, (float)y, 0.0f };
+		vertex.norm = { 1.0f, 1.0f, 1.0f };
+		vertex.texCoord = { (float)x / gridSide, (float)y / gridSide };
+		return vertex;
+	}
+
+	// What an unordered_map's holding, roughly: a node per entry (key,
+	// value, next pointer & the cached hash) plus the bucket array
+	size_t unorderedMapBytes(const std::unordered_map<Vertex, uint32_t> &map)
+	{
+		return map.size() * (sizeof(Vertex) + sizeof(uint32_t) + sizeof(void *) + sizeof(size_t)) + map.bucket_count() * sizeof(void *);
+	}
+
+	// Runs fn(i) for i in [0, count) on up to threadCount threads, which
+	// grab the next i off a shared counter till there's none left
+	template <typename Fn>
+	void parallelFor(size_t count, unsigned threadCount, Fn fn)
+	{
+		std::atomic<size_t> next(0);
+		auto worker = [&]()
+		{
+			NUB_PROFILE_SCOPE("ingest worker");
+			for (size_t i = next++; i < count; i = next++)
+			{
+				fn(i);
+			}
+		};
+
+		std::vector<std::thread> threads;
+		for (unsigned t = 1; t < threadCount && t < count; t++)
+		{
+			threads.emplace_back(worker);
+		}
+		worker();
+
+		for (auto &thread : threads)
+		{
+			thread.join();
+		}
+	}
+}
+
+void ingestMesh(const tinyobj::attrib_t &attrib, const std::vector<tinyobj::shape_t> &shapes, unsigned threadCount, std::vector<Vertex> &vertices, std::vector<uint32_t> &indices)
+{
+	if (threadCount == 0)
+	{
+		threadCount = std::max(1u, std::thread::hardware_concurrency());
+	}
+
+	vertices.clear();
+	indices.clear();
+
+	// roughly one unique vert per obj position is a decent
+	// starting size, it'll grow if not
+	VertexHashMap uniqueVerts;
+	uniqueVerts.reserve(attrib.vertices.size() / 3);
+
+	if (threadCount == 1)
+	{
+		// Plain old serial loop, concatenating all the shapes
+		for (const auto &shape : shapes)
+		{
+			for (const auto &index : shape.mesh.indices)
+			{
+				indices.push_back(uniqueVerts.findOrAdd(makeVertex(attrib, index), vertices));
+			}
+		}
+		return;
+	}
+
+	// Cut every shape into chunks of at most INGEST_CHUNK_INDICES
+	std::vector<IngestChunk> chunks;
+	size_t totalIndices = 0;
+	for (const auto &shape : shapes)
+	{
+		const auto &shapeIndices = shape.mesh.indices;
+		for (size_t start = 0; start < shapeIndices.size(); start += INGEST_CHUNK_INDICES)
+		{
+			IngestChunk chunk;
+			chunk.indices = shapeIndices.data() + start;
+			chunk.count = std::min(INGEST_CHUNK_INDICES, shapeIndices.size() - start);
+			chunk.firstIndex = totalIndices;
+			totalIndices += chunk.count;
+			chunks.push_back(std::move(chunk));
+		}
+	}
+
+	// 1. every chunk dedups itself, no sharing between threads
+	parallelFor(chunks.size(), threadCount, [&](size_t i)
+	{
+		IngestChunk &chunk = chunks[i];
+		VertexHashMap localVerts;
+		localVerts.reserve(chunk.count / 4);
+		chunk.localIndices.resize(chunk.count);
+		for (size_t j = 0; j < chunk.count; j++)
+		{
+			chunk.localIndices[j] = localVerts.findOrAdd(makeVertex(attrib, chunk.indices[j]), chunk.localVertices);
+		}
+	});
+
+	// 2. merge in chunk order. each chunk's verts are in first seen
+	// order, so going chunk by chunk adds new verts in exactly the
+	// order the serial loop would've
+	for (auto &chunk : chunks)
+	{
+		chunk.remap.resize(chunk.localVertices.size());
+		for (size_t j = 0; j < chunk.localVertices.size(); j++)
+		{
+			chunk.remap[j] = uniqueVerts.findOrAdd(chunk.localVertices[j], vertices);
+		}
+		std::vector<Vertex>().swap(chunk.localVertices);
+	}
+
+	// 3. and rewrite the indices into their slot of the merged buffer
+	indices.resize(totalIndices);
+	parallelFor(chunks.size(), threadCount, [&](size_t i)
+	{
+		const IngestChunk &chunk = chunks[i];
+		for (size_t j = 0; j < chunk.count; j++)
+		{
+			indices[chunk.firstIndex + j] = chunk.remap[chunk.localIndices[j]];
+		}
+	});
+}
+
+void benchmarkMeshIngest(const std::string &objPath)
+{
+	tinyobj::attrib_t attrib;
+	std::vector<tinyobj::shape_t> shapes;
+	std::vector<tinyobj::material_t> materials;
+	std::string err;
+
+	auto parseStart = std::chrono::high_resolution_clock::now();
+	if (!tinyobj::LoadObj(&attrib, &shapes, &materials, &err, objPath.c_str()))
+	{
+		throw std::runtime_error(err);
+	}
+	auto parseEnd = std::chrono::high_resolution_clock::now();
+
+	size_t totalIndices = 0;
+	for (const auto &shape : shapes)
+	{
+		totalIndices += shape.mesh.indices.size();
+	}
+
+	std::cout << objPath << ": " << shapes.size() << " shapes, " << totalIndices << " indices, parsed in "
+		<< std::chrono::duration<double, std::milli>(parseEnd - parseStart).count() << " ms\n";
+
+	std::vector<Vertex> serialVertices;
+	std::vector<uint32_t> serialIndices;
+	double serialMs = 0.0;
+
+	unsigned maxThreads = std::max(1u, std::thread::hardware_concurrency());
+	for (unsigned threads = 1; ; threads = std::min(threads * 2, maxThreads))
+	{
+		std::vector<Vertex> vertices;
+		std::vector<uint32_t> indices;
+
+		auto start = std::chrono::high_resolution_clock::now();
+		ingestMesh(attrib, shapes, threads, vertices, indices);
+		auto end = std::chrono::high_resolution_clock::now();
+		double ms = std::chrono::duration<double, std::milli>(end - start).count();
+
+		if (threads == 1)
+		{
+			serialVertices.swap(vertices);
+			serialIndices.swap(indices);
+			serialMs = ms;
+		}
+
+		bool identical = threads == 1 || (vertices.size() == serialVertices.size() && indices == serialIndices &&
+			std::equal(vertices.begin(), vertices.end(), serialVertices.begin()));
+
+		std::cout << "\t" << threads << " threads: " << ms << " ms, " << serialMs / ms << "x"
+			<< (identical ? "" : "  <- DOESN'T MATCH SERIAL OUTPUT") << "\n";
+
+		if (threads == maxThreads)
+		{
+			break;
+		}
+	}
+}
+
+void benchmarkVertexDedup()
+{
+	for (size_t indexCount : DEDUP_BENCH_SIZES)
+	{
+		// just enough quads to cover the stream
+		size_t gridSide = 2;
+		while ((gridSide - 1) * (gridSide - 1) * 6 < indexCount)
+		{
+			gridSide++;
+		}
+
+		std::cout << indexCount << " indices:\n";
+
+		// neither table's reserved, growing is part of the cost.
+		// the checksums are what keep the loops from being
+		// optimised out, and they have to agree
+		uint64_t flatChecksum = 0;
+		size_t flatVertices = 0;
+		{
+			std::vector<Vertex> vertices;
+			VertexHashMap uniqueVerts;
+
+			auto start = std::chrono::high_resolution_clock::now();
+			for (size_t i = 0; i < indexCount; i++)
+			{
+				flatChecksum += uniqueVerts.findOrAdd(makeGridVertex(i, gridSide), vertices);
+			}
+			auto end = std::chrono::high_resolution_clock::now();
+			double ms = std::chrono::duration<double, std::milli>(end - start).count();
+
+			flatVertices = vertices.size();
+			std::cout << "\tVertexHashMap: " << ms << " ms, " << indexCount / ms / 1000.0 << " M indices/s, "
+				<< uniqueVerts.memoryBytes() / (1024.0 * 1024.0) << " MB table (" << flatVertices << " unique verts)\n";
+		}
+
+		uint64_t mapChecksum = 0;
+		size_t mapVertices = 0;
+		{
+			std::vector<Vertex> vertices;
+			std::unordered_map<Vertex, uint32_t> uniqueVerts;
+
+			auto start = std::chrono::high_resolution_clock::now();
+			for (size_t i = 0; i < indexCount; i++)
+			{
+				Vertex vertex = makeGridVertex(i, gridSide);
+				auto found = uniqueVerts.emplace(vertex, (uint32_t)vertices.size());
+				if (found.second)
+				{
+					vertices.push_back(vertex);
+				}
+				mapChecksum += found.first->second;
+			}
+			auto end = std::chrono::high_resolution_clock::now();
+			double ms = std::chrono::duration<double, std::milli>(end - start).count();
+
+			mapVertices = vertices.size();
+			std::cout << "\tstd::unordered_map: " << ms << " ms, " << indexCount / ms / 1000.0 << " M indices/s, ~"
+				<< unorderedMapBytes(uniqueVerts) / (1024.0 * 1024.0) << " MB table\n";
+		}
+
+		if (flatChecksum != mapChecksum || flatVertices != mapVertices)
+		{
+			throw std::runtime_error("VertexHashMap and std::unordered_map didn't dedup the same!");
+		}
+	}
+}
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <Util/Constants.h>
+
+#include <tiny_obj_loader.h>
+
+#include <string>
+#include <vector>
+
+// Turns tinyobj's shapes into one deduped vertex + index buffer. shapes
+// get cut into chunks of indices, each chunk is deduped on its own
+// thread, then the chunks are merged in order so the output is exactly
+// what the single threaded loop would've made. vertices are deduped on
+// their raw bits, so ones that only differ by a signed zero (which obj
+// exporters do write, -0.000000) stay separate verts.
+// threadCount 0 means one per core, 1 is the plain serial loop
+void ingestMesh(const tinyobj::attrib_t &attrib, const std::vector<tinyobj::shape_t> &shapes, unsigned threadCount, std::vector<Vertex> &vertices, std::vector<uint32_t> &indices);
+
+// No gpu needed. parses objPath once, then times ingestMesh at 1, 2, 4..
+// threads (up to the core count) and checks each against the serial run
+void benchmarkMeshIngest(const std::string &objPath);
+
+// No gpu or file needed. dedups synthetic vertex streams of 10k up to 50M
+// indices with VertexHashMap and with std::unordered_map, printing M
+// indices/s and how big each table got. the vertex array is the same for
+// both so it's left out
+void benchmarkVertexDedup();
@@ -0,0 +1,479 @@
+#include <Util/MeshOptimizer.h>
+#include <Util/MeshIngest.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <stdexcept>
+
+namespace
+{
+	// Forsyth's tuned numbers. the simulated cache is bigger than any
+	// real one on purpose, it keeps the order good across hardware
+	const unsigned FORSYTH_CACHE_SIZE = 32;
+	const unsigned FORSYTH_VALENCE_TABLE_SIZE = 64;
+	const float FORSYTH_LAST_TRIANGLE_SCORE = 0.75f;
+	const float FORSYTH_CACHE_DECAY_POWER = 1.5f;
+	const float FORSYTH_VALENCE_BOOST_SCALE = 2.0f;
+	const float FORSYTH_VALENCE_BOOST_POWER = 0.5f;
+
+	// The fifo used for the stats & the overdraw clusters
+	const unsigned FIFO_CACHE_SIZE = 16;
+
+	const size_t FETCH_LINE_SIZE = 64;
+	const size_t FETCH_CACHE_LINES = 256;
+
+	struct ForsythScores
+	{
+		float cachePosition[FORSYTH_CACHE_SIZE];
+		float valence[FORSYTH_VALENCE_TABLE_SIZE];
+
+		ForsythScores()
+		{
+			for (unsigned i = 0; i < FORSYTH_CACHE_SIZE; i++)
+			{
+				// the last triangle's 3 verts all get the same score,
+				// otherwise it'd just keep going in one direction
+				this->cachePosition[i] = i < 3 ? FORSYTH_LAST_TRIANGLE_SCORE :
+					powf(1.0f - (i - 3) / (float)(FORSYTH_CACHE_SIZE - 3), FORSYTH_CACHE_DECAY_POWER);
+			}
+			for (unsigned i = 0; i < FORSYTH_VALENCE_TABLE_SIZE; i++)
+			{
+				this->valence[i] = i == 0 ? 0.0f : FORSYTH_VALENCE_BOOST_SCALE * powf((float)i, -FORSYTH_VALENCE_BOOST_POWER);
+			}
+		}
+
+		float score(int cachePos, uint32_t remaining) const
+		{
+			// no triangles left, nobody cares about this vertex
+			if (remaining == 0)
+			{
+				return -1.0f;
+			}
+
+			float score = cachePos >= 0 ? this->cachePosition[cachePos] : 0.0f;
+			score += remaining < FORSYTH_VALENCE_TABLE_SIZE ? this->valence[remaining] :
+				FORSYTH_VALENCE_BOOST_SCALE * powf((float)remaining, -FORSYTH_VALENCE_BOOST_POWER);
+			return score;
+		}
+	};
+
+	// A fifo cache, without actually shuffling anything around. each entry
+	// remembers when it went in, and it's still in there if fewer than
+	// size things have gone in since
+	class FifoCache
+	{
+	public:
+		FifoCache(size_t entries, unsigned size) : stamps(entries, 0), size(size)
+		{
+		}
+
+		// true on a miss (and puts it in)
+		bool touch(size_t entry)
+		{
+			if (this->stamps[entry] != 0 && this->time - this->stamps[entry] < this->size)
+			{
+				return false;
+			}
+			this->stamps[entry] = ++this->time;
+			return true;
+		}
+
+		void reset()
+		{
+			this->time += this->size;
+		}
+
+	private:
+		std::vector<uint64_t> stamps;
+		uint64_t time = 0;
+		unsigned size;
+	};
+
+	unsigned triangleMisses(FifoCache &cache, const uint32_t *triangle)
+	{
+		return (unsigned)cache.touch(triangle[0]) + (unsigned)cache.touch(triangle[1]) + (unsigned)cache.touch(triangle[2]);
+	}
+
+	void printMeshStats(const char *stage, const std::vector<uint32_t> &indices, size_t vertexCount)
+	{
+		VertexCacheStats cacheStats = analyzeVertexCache(indices, vertexCount);
+		VertexFetchStats fetchStats = analyzeVertexFetch(indices, vertexCount, sizeof(Vertex));
+		std::cout << "model: " << stage << " acmr " << cacheStats.acmr << ", atvr " << cacheStats.atvr << ", overfetch " << fetchStats.overfetch << "\n";
+	}
+}
+
+VertexCacheStats analyzeVertexCache(const std::vector<uint32_t> &indices, size_t vertexCount, unsigned cacheSize)
+{
+	VertexCacheStats stats;
+	FifoCache cache(vertexCount, cacheSize);
+
+	for (uint32_t index : indices)
+	{
+		stats.vertsTransformed += cache.touch(index) ? 1 : 0;
+	}
+
+	if (indices.size() >= 3)
+	{
+		stats.acmr = stats.vertsTransformed / (float)(indices.size() / 3);
+	}
+	if (vertexCount > 0)
+	{
+		stats.atvr = stats.vertsTransformed / (float)vertexCount;
+	}
+	return stats;
+}
+
+VertexFetchStats analyzeVertexFetch(const std::vector<uint32_t> &indices, size_t vertexCount, size_t vertexSize)
+{
+	VertexFetchStats stats;
+	size_t bufferSize = vertexCount * vertexSize;
+	FifoCache cache((bufferSize + FETCH_LINE_SIZE - 1) / FETCH_LINE_SIZE, FETCH_CACHE_LINES);
+
+	for (uint32_t index : indices)
+	{
+		size_t firstLine = index * vertexSize / FETCH_LINE_SIZE;
+		size_t lastLine = ((index + 1) * vertexSize - 1) / FETCH_LINE_SIZE;
+		for (size_t line = firstLine; line <= lastLine; line++)
+		{
+			stats.bytesFetched += cache.touch(line) ? FETCH_LINE_SIZE : 0;
+		}
+	}
+
+	if (bufferSize > 0)
+	{
+		stats.overfetch = stats.bytesFetched / (float)bufferSize;
+	}
+	return stats;
+}
+
+void optimizeVertexCache(std::vector<uint32_t> &indices, size_t vertexCount)
+{
+	static const ForsythScores scores;
+
+	size_t triangleCount = indices.size() / 3;
+	if (triangleCount == 0)
+	{
+		return;
+	}
+
+	// Which triangles use each vertex, all packed into one array with
+	// each vertex's list starting at adjacencyOffsets[v]. emitted
+	// triangles get swapped out past remaining[v]
+	std::vector<uint32_t> adjacencyOffsets(vertexCount + 1, 0);
+	for (size_t i = 0; i < triangleCount * 3; i++)
+	{
+		adjacencyOffsets[indices[i] + 1]++;
+	}
+	for (size_t v = 0; v < vertexCount; v++)
+	{
+		adjacencyOffsets[v + 1] += adjacencyOffsets[v];
+	}
+
+	std::vector<uint32_t> adjacency(triangleCount * 3);
+	std::vector<uint32_t> remaining(vertexCount, 0);
+	for (size_t t = 0; t < triangleCount; t++)
+	{
+		for (size_t k = 0; k < 3; k++)
+		{
+			// degenerate triangles use a vertex twice, only
+			// list them once
+			uint32_t v = indices[t * 3 + k];
+			if ((k > 0 && v == indices[t * 3]) || (k > 1 && v == indices[t * 3 + 1]))
+			{
+				continue;
+			}
+			adjacency[adjacencyOffsets[v] + remaining[v]++] = (uint32_t)t;
+		}
+	}
+
+	std::vector<int> cachePos(vertexCount, -1);
+	std::vector<float> vertexScores(vertexCount);
+	for (size_t v = 0; v < vertexCount; v++)
+	{
+		vertexScores[v] = scores.score(-1, remaining[v]);
+	}
+
+	std::vector<float> triangleScores(triangleCount);
+	std::vector<bool> emitted(triangleCount, false);
+	int64_t best = -1;
+	for (size_t t = 0; t < triangleCount; t++)
+	{
+		triangleScores[t] = vertexScores[indices[t * 3]] + vertexScores[indices[t * 3 + 1]] + vertexScores[indices[t * 3 + 2]];
+		if (best < 0 || triangleScores[t] > triangleScores[best])
+		{
+			best = (int64_t)t;
+		}
+	}
+
+	std::vector<uint32_t> result;
+	result.reserve(triangleCount * 3);
+
+	uint32_t cache[FORSYTH_CACHE_SIZE + 3];
+	uint32_t newCache[FORSYTH_CACHE_SIZE + 3];
+	size_t cacheCount = 0;
+	size_t deadEndCursor = 0;
+
+	while (result.size() < triangleCount * 3)
+	{
+		// Dead end, nothing in the cache has triangles left. just
+		// take the next one we haven't done yet
+		if (best < 0)
+		{
+			while (emitted[deadEndCursor])
+			{
+				deadEndCursor++;
+			}
+			best = (int64_t)deadEndCursor;
+		}
+
+		const uint32_t *triangle = &indices[(size_t)best * 3];
+		emitted[(size_t)best] = true;
+
+		size_t newCount = 0;
+		for (size_t k = 0; k < 3; k++)
+		{
+			uint32_t v = triangle[k];
+			result.push_back(v);
+
+			if (std::find(newCache, newCache + newCount, v) != newCache + newCount)
+			{
+				continue;
+			}
+			newCache[newCount++] = v;
+
+			uint32_t *first = &adjacency[adjacencyOffsets[v]];
+			uint32_t *last = first + remaining[v];
+			std::iter_swap(std::find(first, last, (uint32_t)best), last - 1);
+			remaining[v]--;
+		}
+
+		// The triangle's verts go to the front, the rest shuffle back
+		// and whatever's pushed off the end falls out
+		for (size_t i = 0; i < cacheCount; i++)
+		{
+			if (std::find(triangle, triangle + 3, cache[i]) == triangle + 3)
+			{
+				newCache[newCount++] = cache[i];
+			}
+		}
+
+		for (size_t i = 0; i < newCount; i++)
+		{
+			uint32_t v = newCache[i];
+			cachePos[v] = i < FORSYTH_CACHE_SIZE ? (int)i : -1;
+
+			float score = scores.score(cachePos[v], remaining[v]);
+			float delta = score - vertexScores[v];
+			vertexScores[v] = score;
+
+			for (uint32_t j = 0; j < remaining[v]; j++)
+			{
+				triangleScores[adjacency[adjacencyOffsets[v] + j]] += delta;
+			}
+		}
+
+		cacheCount = std::min(newCount, (size_t)FORSYTH_CACHE_SIZE);
+		std::copy(newCache, newCache + cacheCount, cache);
+
+		// Only triangles touching the cache can have changed, so the
+		// best one's in there (or we're at a dead end)
+		best = -1;
+		for (size_t i = 0; i < cacheCount; i++)
+		{
+			uint32_t v = cache[i];
+			for (uint32_t j = 0; j < remaining[v]; j++)
+			{
+				uint32_t t = adjacency[adjacencyOffsets[v] + j];
+				if (best < 0 || triangleScores[t] > triangleScores[(size_t)best])
+				{
+					best = (int64_t)t;
+				}
+			}
+		}
+	}
+
+	// any leftover indices (not a multiple of 3) stay on the end
+	result.insert(result.end(), indices.begin() + triangleCount * 3, indices.end());
+	indices.swap(result);
+}
+
+void optimizeOverdraw(std::vector<uint32_t> &indices, const std::vector<Vertex> &vertices, float threshold)
+{
+	size_t triangleCount = indices.size() / 3;
+	if (triangleCount == 0)
+	{
+		return;
+	}
+
+	FifoCache cache(vertices.size(), FIFO_CACHE_SIZE);
+
+	// Hard boundaries: wherever a triangle misses on all 3 verts, the
+	// cache order already jumped somewhere else, so cutting there is free
+	std::vector<size_t> hardClusters;
+	for (size_t t = 0; t < triangleCount; t++)
+	{
+		if (triangleMisses(cache, &indices[t * 3]) == 3 || t == 0)
+		{
+			hardClusters.push_back(t);
+		}
+	}
+	hardClusters.push_back(triangleCount);
+
+	// Soft boundaries: cut a hard cluster again as soon as the bit so far
+	// is within threshold of the whole cluster's acmr. every cut starts
+	// with a cold cache, which is what the threshold pays for
+	std::vector<size_t> clusters;
+	for (size_t c = 0; c + 1 < hardClusters.size(); c++)
+	{
+		size_t start = hardClusters[c];
+		size_t end = hardClusters[c + 1];
+
+		cache.reset();
+		unsigned clusterMisses = 0;
+		for (size_t t = start; t < end; t++)
+		{
+			clusterMisses += triangleMisses(cache, &indices[t * 3]);
+		}
+		float clusterThreshold = threshold * clusterMisses / (float)(end - start);
+
+		cache.reset();
+		clusters.push_back(start);
+		size_t subStart = start;
+		unsigned subMisses = 0;
+		for (size_t t = start; t < end; t++)
+		{
+			subMisses += triangleMisses(cache, &indices[t * 3]);
+			if (t + 1 < end && subMisses / (float)(t + 1 - subStart) <= clusterThreshold)
+			{
+				clusters.push_back(t + 1);
+				subStart = t + 1;
+				subMisses = 0;
+				cache.reset();
+			}
+		}
+	}
+	clusters.push_back(triangleCount);
+
+	// Each cluster's area weighted centre & normal. anything facing out
+	// from the middle of the mesh is more likely to be in front of
+	// other stuff, so it gets drawn first
+	size_t clusterCount = clusters.size() - 1;
+	std::vector<glm::vec3> centroids(clusterCount, glm::vec3(0.0f));
+	std::vector<glm::vec3> normals(clusterCount, glm::vec3(0.0f));
+	glm::vec3 meshCentroid(0.0f);
+	float meshArea = 0.0f;
+
+	for (size_t c = 0; c < clusterCount; c++)
+	{
+		float clusterArea = 0.0f;
+		for (size_t t = clusters[c]; t < clusters[c + 1]; t++)
+		{
+			const glm::vec3 &p0 = vertices[indices[t * 3]].pos;
+			const glm::vec3 &p1 = vertices[indices[t * 3 + 1]].pos;
+			const glm::vec3 &p2 = vertices[indices[t * 3 + 2]].pos;
+
+			// Vertex::norm is just a placeholder for now, so
+			// use the face normal
+			glm::vec3 cross = glm::cross(p1 - p0, p2 - p0);
+			float area = glm::length(cross);
+
+			centroids[c] += (p0 + p1 + p2) * (area / 3.0f);
+			normals[c] += cross;
+			clusterArea += area;
+		}
+
+		meshCentroid += centroids[c];
+		meshArea += clusterArea;
+		if (clusterArea > 0.0f)
+		{
+			centroids[c] /= clusterArea;
+		}
+	}
+	if (meshArea > 0.0f)
+	{
+		meshCentroid /= meshArea;
+	}
+
+	std::vector<float> sortKeys(clusterCount);
+	std::vector<size_t> order(clusterCount);
+	for (size_t c = 0; c < clusterCount; c++)
+	{
+		float normalLength = glm::length(normals[c]);
+		sortKeys[c] = normalLength > 0.0f ? glm::dot(centroids[c] - meshCentroid, normals[c] / normalLength) : 0.0f;
+		order[c] = c;
+	}
+
+	std::stable_sort(order.begin(), order.end(), [&](size_t lhs, size_t rhs)
+	{
+		return sortKeys[lhs] > sortKeys[rhs];
+	});
+
+	std::vector<uint32_t> result;
+	result.reserve(indices.size());
+	for (size_t c : order)
+	{
+		result.insert(result.end(), indices.begin() + clusters[c] * 3, indices.begin() + clusters[c + 1] * 3);
+	}
+	result.insert(result.end(), indices.begin() + triangleCount * 3, indices.end());
+	indices.swap(result);
+}
+
+void optimizeVertexFetch(std::vector<Vertex> &vertices, std::vector<uint32_t> &indices)
+{
+	std::vector<uint32_t> remap(vertices.size(), UINT32_MAX);
+	std::vector<Vertex> reordered;
+	reordered.reserve(vertices.size());
+
+	for (auto &index : indices)
+	{
+		if (remap[index] == UINT32_MAX)
+		{
+			remap[index] = (uint32_t)reordered.size();
+			reordered.push_back(vertices[index]);
+		}
+		index = remap[index];
+	}
+
+	vertices.swap(reordered);
+}
+
+void optimizeMesh(std::vector<Vertex> &vertices, std::vector<uint32_t> &indices)
+{
+	auto optimizeStart = std::chrono::high_resolution_clock::now();
+
+	printMeshStats("obj order     ", indices, vertices.size());
+
+	optimizeVertexCache(indices, vertices.size());
+	printMeshStats("vertex cache  ", indices, vertices.size());
+
+	optimizeOverdraw(indices, vertices);
+	printMeshStats("+ overdraw    ", indices, vertices.size());
+
+	optimizeVertexFetch(vertices, indices);
+	printMeshStats("+ vertex fetch", indices, vertices.size());
+
+	auto optimizeEnd = std::chrono::high_resolution_clock::now();
+	std::cout << "model: optimised in " << std::chrono::duration<double, std::milli>(optimizeEnd - optimizeStart).count() << " ms\n";
+}
+
+void analyzeMeshFile(const std::string &objPath)
+{
+	tinyobj::attrib_t attrib;
+	std::vector<tinyobj::shape_t> shapes;
+	std::vector<tinyobj::material_t> materials;
+	std::string err;
+
+	if (!tinyobj::LoadObj(&attrib, &shapes, &materials, &err, objPath.c_str()))
+	{
+		throw std::runtime_error(err);
+	}
+
+	std::vector<Vertex> vertices;
+	std::vector<uint32_t> indices;
+	ingestMesh(attrib, shapes, 0, vertices, indices);
+
+	std::cout << objPath << ": " << indices.size() / 3 << " triangles, " << vertices.size() << " verts\n";
+	optimizeMesh(vertices, indices);
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <Util/Constants.h>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Reorders a deduped triangle list so the gpu does less work drawing it.
+// none of these change what gets drawn, just the order.
+// the usual order to run them in is cache -> overdraw -> fetch, which is
+// what optimizeMesh() does
+
+// How well an index order reuses the post transform cache, simulated as a
+// fifo of cacheSize verts (which is roughly what most hardware looks like).
+// acmr: verts transformed per triangle, 3 is worst, ~0.5 is the best you'd
+// ever see on a real mesh.
+// atvr: verts transformed per unique vert, 1 is perfect
+struct VertexCacheStats
+{
+	size_t vertsTransformed = 0;
+	float acmr = 0.0f;
+	float atvr = 0.0f;
+};
+
+// Same idea for the vertex buffer reads: bytes pulled in through a small
+// cache of 64 byte lines, over the size of the vertex buffer. 1 is perfect
+struct VertexFetchStats
+{
+	size_t bytesFetched = 0;
+	float overfetch = 0.0f;
+};
+
+VertexCacheStats analyzeVertexCache(const std::vector<uint32_t> &indices, size_t vertexCount, unsigned cacheSize = 16);
+VertexFetchStats analyzeVertexFetch(const std::vector<uint32_t> &indices, size_t vertexCount, size_t vertexSize);
+
+// Tom Forsyth's linear speed vertex cache optimisation. greedily picks the
+// next triangle by how recently its verts were used and how few triangles
+// they have left
+void optimizeVertexCache(std::vector<uint32_t> &indices, size_t vertexCount);
+
+// Sander, Nehab & Barczak's cluster sort. cuts the (already cache
+// optimised) triangles into clusters and draws the ones facing out from the
+// middle of the mesh first, so they tend to hide the rest. threshold is how
+// much acmr we're willing to give up for it, 1.05 is 5% worse at most
+void optimizeOverdraw(std::vector<uint32_t> &indices, const std::vector<Vertex> &vertices, float threshold = 1.05f);
+
+// Rewrites the vertex buffer in the order the indices first use them (and
+// drops any that aren't used), so the reads walk forwards through memory
+void optimizeVertexFetch(std::vector<Vertex> &vertices, std::vector<uint32_t> &indices);
+
+// All three, printing the stats before & after
+void optimizeMesh(std::vector<Vertex> &vertices, std::vector<uint32_t> &indices);
+
+// No gpu needed. parses + dedups objPath then runs optimizeMesh on it
+void analyzeMeshFile(const std::string &objPath);
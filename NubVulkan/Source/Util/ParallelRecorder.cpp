@@ -0,0 +1,166 @@
+#include <Util/ParallelRecorder.h>
+#include <Util/CpuProfiler.h>
+
+#include <algorithm>
+#include <exception>
+#include <stdexcept>
+
+ParallelRecorder::ParallelRecorder(const VDevice &device)
+	: device(device)
+{
+}
+
+void ParallelRecorder::init(uint32_t queueFamily, unsigned threadCount, uint32_t poolSets, VkCommandPoolCreateFlags poolFlags)
+{
+	if (threadCount == 0)
+	{
+		threadCount = std::max(1u, std::thread::hardware_concurrency());
+	}
+	this->threads = threadCount;
+
+	VkCommandPoolCreateInfo poolInfo = {};
+	poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+	poolInfo.queueFamilyIndex = queueFamily;
+	poolInfo.flags = poolFlags;
+
+	size_t poolCount = (size_t)poolSets * threadCount;
+	this->pools.clear();
+	resizeHandles(this->pools, poolCount, this->device);
+	this->usedBuffers.assign(poolCount, std::vector<VkCommandBuffer>());
+	this->spareBuffers.assign(poolCount, std::vector<VkCommandBuffer>());
+	for (auto &pool : this->pools)
+	{
+		if (vkCreateCommandPool(this->device, &poolInfo, nullptr, pool.replace()) != VK_SUCCESS)
+		{
+			throw std::runtime_error("Couldn't create a recording thread's command pool!");
+		}
+	}
+
+	this->workers.reset(threadCount > 1 ? new ThreadPool(threadCount - 1) : nullptr);
+}
+
+std::vector<VkCommandBuffer> ParallelRecorder::record(const VkCommandBufferInheritanceInfo &inheritance, size_t drawCount, const RecordSlice &recordSlice, uint32_t poolSet)
+{
+	size_t sliceCount = std::min(drawCount, (size_t)this->threads);
+	std::vector<VkCommandBuffer> buffers(sliceCount, VK_NULL_HANDLE);
+
+	auto recordOne = [&](size_t slice)
+	{
+		NUB_PROFILE_SCOPE("record secondary");
+
+		// only this job touches this pool (& its lists) till
+		// record() returns
+		size_t pool = (size_t)poolSet * this->threads + slice;
+		std::vector<VkCommandBuffer> &spares = this->spareBuffers[pool];
+
+		if (!spares.empty())
+		{
+			buffers[slice] = spares.back();
+			spares.pop_back();
+		}
+		else
+		{
+			VkCommandBufferAllocateInfo allocInfo = {};
+			allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+			allocInfo.commandPool = this->pools[pool];
+			allocInfo.level = VK_COMMAND_BUFFER_LEVEL_SECONDARY;
+			allocInfo.commandBufferCount = 1;
+
+			if (vkAllocateCommandBuffers(this->device, &allocInfo, &buffers[slice]) != VK_SUCCESS)
+			{
+				throw std::runtime_error("Couldn't allocate a secondary command buffer!");
+			}
+		}
+		this->usedBuffers[pool].push_back(buffers[slice]);
+
+		VkCommandBufferBeginInfo begInfo = {};
+		begInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+		// all of it happens inside the primary's render pass
+		begInfo.flags = VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT;
+		begInfo.pInheritanceInfo = &inheritance;
+		vkBeginCommandBuffer(buffers[slice], &begInfo);
+
+		// slices as even as they'll go, the first few get
+		// the leftovers
+		size_t begin = drawCount * slice / sliceCount;
+		size_t end = drawCount * (slice + 1) / sliceCount;
+		recordSlice(buffers[slice], begin, end);
+
+		if (vkEndCommandBuffer(buffers[slice]) != VK_SUCCESS)
+		{
+			throw std::runtime_error("Failed to record secondary command buffer!");
+		}
+	};
+
+	std::vector<std::future<void>> jobs;
+	for (size_t slice = 1; slice < sliceCount; slice++)
+	{
+		jobs.push_back(this->workers->submit([&recordOne, slice]() { recordOne(slice); }));
+	}
+
+	// Every job has to be finished before we leave, even if one
+	// threw, they're all writing into buffers
+	std::exception_ptr error;
+	try
+	{
+		if (sliceCount > 0)
+		{
+			recordOne(0);
+		}
+	}
+	catch (...)
+	{
+		error = std::current_exception();
+	}
+	for (auto &job : jobs)
+	{
+		try
+		{
+			job.get();
+		}
+		catch (...)
+		{
+			if (!error)
+			{
+				error = std::current_exception();
+			}
+		}
+	}
+
+	if (error)
+	{
+		this->free(buffers, poolSet);
+		std::rethrow_exception(error);
+	}
+	return buffers;
+}
+
+void ParallelRecorder::free(const std::vector<VkCommandBuffer> &buffers, uint32_t poolSet)
+{
+	// buffers[i] came out of the set's i'th pool
+	for (size_t i = 0; i < buffers.size() && i < this->threads; i++)
+	{
+		if (buffers[i] == VK_NULL_HANDLE)
+		{
+			continue;
+		}
+
+		size_t pool = (size_t)poolSet * this->threads + i;
+		std::vector<VkCommandBuffer> &used = this->usedBuffers[pool];
+		used.erase(std::remove(used.begin(), used.end(), buffers[i]), used.end());
+		vkFreeCommandBuffers(this->device, this->pools[pool], 1, &buffers[i]);
+	}
+}
+
+void ParallelRecorder::reset(uint32_t poolSet)
+{
+	for (size_t i = 0; i < this->threads; i++)
+	{
+		size_t pool = (size_t)poolSet * this->threads + i;
+		vkResetCommandPool(this->device, this->pools[pool], 0);
+
+		std::vector<VkCommandBuffer> &used = this->usedBuffers[pool];
+		this->spareBuffers[pool].insert(this->spareBuffers[pool].end(), used.begin(), used.end());
+		used.clear();
+	}
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include <Util/VHandle.h>
+#include <Util/ThreadPool.h>
+
+#include <functional>
+#include <memory>
+#include <vector>
+
+// Records a draw list into secondary command buffers on a few threads
+// at once. command pools can only be touched by one thread at a time,
+// so every thread gets its own: slice i of the draws is always
+// recorded by one job, into a buffer from pool i. the caller runs
+// slice 0 itself, the rest go to the workers.
+//
+// There can be a few sets of those pools, eg one per frame in flight,
+// so one set can be reset() while the others are still in use
+class ParallelRecorder
+{
+public:
+	// Records draws [begin, end) into a secondary buffer that's already
+	// begun. it has to bind & set everything itself, secondaries don't
+	// inherit any state from the primary
+	typedef std::function<void(VkCommandBuffer cmdBuff, size_t begin, size_t end)> RecordSlice;
+
+	ParallelRecorder(const VDevice &device);
+
+	ParallelRecorder(const ParallelRecorder &) = delete;
+	ParallelRecorder &operator=(const ParallelRecorder &) = delete;
+
+	// 0 threads means one per hardware thread. poolFlags goes to every
+	// pool, TRANSIENT for ones that get reset() every frame
+	void init(uint32_t queueFamily, unsigned threadCount, uint32_t poolSets = 1, VkCommandPoolCreateFlags poolFlags = 0);
+
+	// Splits [0, drawCount) into one slice per thread (fewer if there
+	// aren't enough draws) and hands back the recorded secondaries in
+	// slice order, ready for vkCmdExecuteCommands. inheritance needs
+	// the render pass, subpass & framebuffer they'll run in
+	std::vector<VkCommandBuffer> record(const VkCommandBufferInheritanceInfo &inheritance, size_t drawCount, const RecordSlice &recordSlice, uint32_t poolSet = 0);
+	// Gives back buffers record() handed out, once the gpu's done with
+	// them. not while a record() is going
+	void free(const std::vector<VkCommandBuffer> &buffers, uint32_t poolSet = 0);
+	// vkResetCommandPool's the whole set, once the gpu's done with
+	// everything recorded from it. the buffers aren't freed, record()
+	// just begins them again instead of allocating new ones
+	void reset(uint32_t poolSet);
+
+	unsigned threadCount() const { return this->threads; }
+
+private:
+	const VDevice &device;
+	unsigned threads = 0;
+	// [pool set][thread], and what's been handed out of each & what's
+	// been reset and can be recorded again
+	std::vector<VCommandPool> pools;
+	std::vector<std::vector<VkCommandBuffer>> usedBuffers;
+	std::vector<std::vector<VkCommandBuffer>> spareBuffers;
+	// threadCount - 1 of them, none when there's just the one thread
+	std::unique_ptr<ThreadPool> workers;
+};
@@ -0,0 +1,101 @@
+#include <Util/PipelineCache.h>
+#include <Util/FileUtil.h>
+
+#include <cstring>
+#include <fstream>
+
+namespace
+{
+	const char PIPELINE_CACHE_MAGIC[4] = { 'N', 'P', 'S', 'O' };
+
+	uint32_t readU32(const char *bytes)
+	{
+		uint32_t value;
+		memcpy(&value, bytes, sizeof(value));
+		return value;
+	}
+
+	// The header every VkPipelineCache blob starts with (spec'd as
+	// VK_PIPELINE_CACHE_HEADER_VERSION_ONE): header size, version,
+	// vendor id, device id, then the uuid
+	bool driverHeaderMatches(const std::vector<char> &data, const VkPhysicalDeviceProperties &properties)
+	{
+		const size_t headerSize = 16 + VK_UUID_SIZE;
+		if (data.size() < headerSize)
+		{
+			return false;
+		}
+
+		return
+			readU32(data.data()) >= headerSize &&
+			readU32(data.data() + 4) == VK_PIPELINE_CACHE_HEADER_VERSION_ONE &&
+			readU32(data.data() + 8) == properties.vendorID &&
+			readU32(data.data() + 12) == properties.deviceID &&
+			memcmp(data.data() + 16, properties.pipelineCacheUUID, VK_UUID_SIZE) == 0;
+	}
+}
+
+bool loadPipelineCacheData(const std::string &path, const VkPhysicalDeviceProperties &properties, std::vector<char> &data)
+{
+	data.clear();
+
+	std::ifstream file(path, std::ios::ate | std::ios::binary);
+	if (!file.is_open())
+	{
+		return false;
+	}
+
+	size_t fileSize = (size_t)file.tellg();
+	PipelineCacheFileHeader header;
+	if (fileSize < sizeof(header))
+	{
+		return false;
+	}
+	file.seekg(0);
+	file.read(reinterpret_cast<char *>(&header), sizeof(header));
+
+	// A new driver or a different gpu means the blob's useless, so
+	// start over with an empty cache
+	bool valid =
+		memcmp(header.magic, PIPELINE_CACHE_MAGIC, sizeof(PIPELINE_CACHE_MAGIC)) == 0 &&
+		header.version == PIPELINE_CACHE_FILE_VERSION &&
+		header.vendorID == properties.vendorID &&
+		header.deviceID == properties.deviceID &&
+		header.driverVersion == properties.driverVersion &&
+		memcmp(header.pipelineCacheUUID, properties.pipelineCacheUUID, VK_UUID_SIZE) == 0 &&
+		header.dataSize == fileSize - sizeof(header);
+
+	if (!valid)
+	{
+		return false;
+	}
+
+	data.resize((size_t)header.dataSize);
+	file.read(data.data(), data.size());
+
+	if (!file || hashFnv1a(data.data(), data.size()) != header.dataHash || !driverHeaderMatches(data, properties))
+	{
+		data.clear();
+		return false;
+	}
+	return true;
+}
+
+bool savePipelineCacheData(const std::string &path, const VkPhysicalDeviceProperties &properties, const std::vector<char> &data)
+{
+	PipelineCacheFileHeader header = {};
+	memcpy(header.magic, PIPELINE_CACHE_MAGIC, sizeof(PIPELINE_CACHE_MAGIC));
+	header.version = PIPELINE_CACHE_FILE_VERSION;
+	header.vendorID = properties.vendorID;
+	header.deviceID = properties.deviceID;
+	header.driverVersion = properties.driverVersion;
+	memcpy(header.pipelineCacheUUID, properties.pipelineCacheUUID, VK_UUID_SIZE);
+	header.dataSize = data.size();
+	header.dataHash = hashFnv1a(data.data(), data.size());
+
+	return writeFileReplacing(path, [&](std::ostream &file)
+	{
+		file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+		file.write(data.data(), data.size());
+	});
+}
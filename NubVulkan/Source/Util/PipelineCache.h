@@ -0,0 +1,33 @@
+#pragma once
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// What a .nubcache file starts with, followed by dataSize bytes of
+// vkGetPipelineCacheData(). the driver checks its own blob too, but
+// some drivers crash rather than reject a blob from another gpu, so
+// we never hand it one that doesn't match
+struct PipelineCacheFileHeader
+{
+	char magic[4];
+	uint32_t version;
+	uint32_t vendorID;
+	uint32_t deviceID;
+	uint32_t driverVersion;
+	uint8_t pipelineCacheUUID[VK_UUID_SIZE];
+	uint64_t dataSize;
+	// FNV-1a of the data, catches truncated/garbled files
+	uint64_t dataHash;
+};
+
+// Bump whenever the header changes
+const uint32_t PIPELINE_CACHE_FILE_VERSION = 1;
+
+// false (and data empty) if there's no file, or it's from another
+// gpu/driver, or broken in any way
+bool loadPipelineCacheData(const std::string &path, const VkPhysicalDeviceProperties &properties, std::vector<char> &data);
+bool savePipelineCacheData(const std::string &path, const VkPhysicalDeviceProperties &properties, const std::vector<char> &data);
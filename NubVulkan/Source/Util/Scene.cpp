@@ -0,0 +1,105 @@
+#include <Util/Scene.h>
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <cmath>
+#include <cstddef>
+#include <stdexcept>
+
+VkVertexInputBindingDescription InstanceData::getBindingDescription()
+{
+	VkVertexInputBindingDescription bindDesc = {};
+	bindDesc.binding = INSTANCE_BINDING;
+	bindDesc.stride = sizeof(InstanceData);
+	bindDesc.inputRate = VK_VERTEX_INPUT_RATE_INSTANCE;
+	return bindDesc;
+}
+
+std::array<VkVertexInputAttributeDescription, 4> InstanceData::getAttributeDescriptions()
+{
+	// glm's column major like glsl, so column i is just
+	// the i'th vec4
+	std::array<VkVertexInputAttributeDescription, 4> attribDescs = {};
+	for (uint32_t column = 0; column < 4; column++)
+	{
+		attribDescs[column].binding = INSTANCE_BINDING;
+		attribDescs[column].location = INSTANCE_FIRST_LOCATION + column;
+		attribDescs[column].format = VK_FORMAT_R32G32B32A32_SFLOAT;
+		attribDescs[column].offset = (uint32_t)(offsetof(InstanceData, model) + sizeof(glm::vec4) * column);
+	}
+	return attribDescs;
+}
+
+uint32_t Scene::addMesh(uint32_t indexCount, uint32_t firstIndex, int32_t vertexOffset)
+{
+	Mesh mesh;
+	mesh.indexCount = indexCount;
+	mesh.firstIndex = firstIndex;
+	mesh.vertexOffset = vertexOffset;
+	this->meshes.push_back(mesh);
+	return (uint32_t)(this->meshes.size() - 1);
+}
+
+void Scene::addInstance(uint32_t mesh, const glm::mat4 &transform)
+{
+	if (mesh >= this->meshes.size())
+	{
+		throw std::runtime_error("Instance of a mesh that isn't in the scene!");
+	}
+	this->meshes[mesh].transforms.push_back(transform);
+}
+
+void Scene::clear()
+{
+	this->meshes.clear();
+}
+
+size_t Scene::instanceCount() const
+{
+	size_t count = 0;
+	for (const Mesh &mesh : this->meshes)
+	{
+		count += mesh.transforms.size();
+	}
+	return count;
+}
+
+void Scene::build(std::vector<InstanceData> &instances, std::vector<DrawCommand> &draws) const
+{
+	instances.clear();
+	instances.reserve(this->instanceCount());
+	draws.clear();
+
+	for (const Mesh &mesh : this->meshes)
+	{
+		if (mesh.transforms.empty())
+		{
+			continue;
+		}
+
+		DrawCommand draw;
+		draw.indexCount = mesh.indexCount;
+		draw.firstIndex = mesh.firstIndex;
+		draw.vertexOffset = mesh.vertexOffset;
+		draw.instanceCount = (uint32_t)mesh.transforms.size();
+		draw.firstInstance = (uint32_t)instances.size();
+		draws.push_back(draw);
+
+		for (const glm::mat4 &transform : mesh.transforms)
+		{
+			instances.push_back({ transform });
+		}
+	}
+}
+
+void addInstanceGrid(Scene &scene, uint32_t mesh, size_t count, float spacing)
+{
+	size_t side = (size_t)std::ceil(std::sqrt((double)count));
+	float centre = (side - 1) * spacing * 0.5f;
+
+	for (size_t i = 0; i < count; i++)
+	{
+		glm::vec3 position((i % side) * spacing - centre, (i / side) * spacing - centre, 0.0f);
+		scene.addInstance(mesh, glm::translate(glm::mat4(), position));
+	}
+}
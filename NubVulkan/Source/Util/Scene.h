@@ -0,0 +1,70 @@
+#pragma once
+
+#include <Util/Constants.h>
+
+#include <glm/glm.hpp>
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+// One instanced vkCmdDrawIndexed worth of the index buffer. the
+// instances' transforms are instanceCount entries of the instance
+// buffer starting at firstInstance
+struct DrawCommand
+{
+	uint32_t indexCount;
+	uint32_t firstIndex;
+	int32_t vertexOffset;
+	uint32_t instanceCount;
+	uint32_t firstInstance;
+};
+
+// What the instance buffer holds, one per copy of a mesh. it's read
+// through a second vertex binding that steps per instance instead of
+// per vertex. a mat4 attribute eats 4 locations, one per column
+struct InstanceData
+{
+	glm::mat4 model;
+
+	static VkVertexInputBindingDescription getBindingDescription();
+	static std::array<VkVertexInputAttributeDescription, 4> getAttributeDescriptions();
+};
+
+// Vertex has binding 0 and locations 0-2, instances go after
+const uint32_t INSTANCE_BINDING = 1;
+const uint32_t INSTANCE_FIRST_LOCATION = 3;
+
+// Every mesh (a range of the one vertex + index buffer) and every copy
+// of it we want drawn. however many copies there are, each mesh is
+// still just one draw
+class Scene
+{
+public:
+	// Returns the id addInstance() wants
+	uint32_t addMesh(uint32_t indexCount, uint32_t firstIndex, int32_t vertexOffset);
+	void addInstance(uint32_t mesh, const glm::mat4 &transform);
+	void clear();
+
+	size_t meshCount() const { return this->meshes.size(); }
+	size_t instanceCount() const;
+
+	// Packs every mesh's instances back to back and makes one draw per
+	// mesh (that has any) pointing at its run of them
+	void build(std::vector<InstanceData> &instances, std::vector<DrawCommand> &draws) const;
+
+private:
+	struct Mesh
+	{
+		uint32_t indexCount;
+		uint32_t firstIndex;
+		int32_t vertexOffset;
+		std::vector<glm::mat4> transforms;
+	};
+
+	std::vector<Mesh> meshes;
+};
+
+// count copies of mesh on a square grid in the xy plane (z is up in
+// this app), spacing apart and centred on the origin
+void addInstanceGrid(Scene &scene, uint32_t mesh, size_t count, float spacing);
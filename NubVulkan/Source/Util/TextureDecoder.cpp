@@ -0,0 +1,55 @@
+#include <Util/TextureDecoder.h>
+#include <Util/CpuProfiler.h>
+
+#include <stb_image.h>
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace
+{
+	unsigned decodeThreads(unsigned threadCount)
+	{
+		if (threadCount != 0)
+		{
+			return threadCount;
+		}
+		unsigned hardwareThreads = std::thread::hardware_concurrency();
+		return hardwareThreads > 1 ? hardwareThreads - 1 : 1;
+	}
+}
+
+TextureDecoder::TextureDecoder(unsigned threadCount)
+	: pool(decodeThreads(threadCount))
+{
+}
+
+std::future<MipChain> TextureDecoder::decode(const std::string &path, uint32_t mipLevels)
+{
+	return this->pool.submit([path, mipLevels]()
+	{
+		NUB_PROFILE_SCOPE("decode texture");
+
+		int texWidth, texHeight, texChannels;
+		stbi_uc *pixels;
+		{
+			NUB_PROFILE_SCOPE("stbi_load");
+			pixels = stbi_load(path.c_str(), &texWidth, &texHeight, &texChannels, STBI_rgb_alpha);
+		}
+		// 4 bytes a texel as its got the alpha component too!
+
+		if (!pixels)
+		{
+			throw std::runtime_error("Couldn't load texture image file " + path + "!");
+		}
+
+		MipChain mips;
+		{
+			NUB_PROFILE_SCOPE("buildMipChain");
+			buildMipChain(pixels, (uint32_t)texWidth, (uint32_t)texHeight, mipLevels, mips);
+		}
+		stbi_image_free(pixels);
+
+		return mips;
+	});
+}
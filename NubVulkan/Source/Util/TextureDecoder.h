@@ -0,0 +1,24 @@
+#pragma once
+
+#include <Util/TextureMips.h>
+#include <Util/ThreadPool.h>
+
+#include <future>
+#include <string>
+
+// Decodes image files (anything stb_image reads) to rgba8 on a pool of
+// worker threads, so the jpg decode doesn't hold up everything else
+// vulkan needs setting up. the mips can be made over there too
+class TextureDecoder
+{
+public:
+	// 0 means one per hardware thread, leaving one for the main thread
+	explicit TextureDecoder(unsigned threadCount = 0);
+
+	// mipLevels caps the chain like buildMipChain() does, 1 for just the
+	// image itself. get() on the future throws if the file's no good
+	std::future<MipChain> decode(const std::string &path, uint32_t mipLevels);
+
+private:
+	ThreadPool pool;
+};
@@ -0,0 +1,254 @@
+#include <Util/TextureFile.h>
+#include <Util/BlockCompression.h>
+#include <Util/FileUtil.h>
+
+#include <stb_image.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+
+namespace
+{
+	const char TEXTURE_FILE_MAGIC[4] = { 'N', 'T', 'E', 'X' };
+
+	BlockFormat toBlockFormat(VkFormat format)
+	{
+		return format == VK_FORMAT_BC1_RGB_UNORM_BLOCK ? BlockFormat::BC1 : BlockFormat::BC3;
+	}
+
+	VkFormat toVkFormat(BlockFormat format)
+	{
+		return format == BlockFormat::BC1 ? VK_FORMAT_BC1_RGB_UNORM_BLOCK : VK_FORMAT_BC3_UNORM_BLOCK;
+	}
+
+	// Every level of an rgba8 chain, block compressed into the same
+	// layout, sizes & all
+	void compressMipChain(const MipChain &mips, BlockFormat format, MipChain &compressed)
+	{
+		uint32_t levels = mips.levelCount();
+		compressed.widths = mips.widths;
+		compressed.heights = mips.heights;
+		compressed.offsets.resize(levels);
+		compressed.sizes.resize(levels);
+
+		size_t total = 0;
+		for (uint32_t level = 0; level < levels; level++)
+		{
+			compressed.offsets[level] = total;
+			compressed.sizes[level] = compressedSize(format, mips.widths[level], mips.heights[level]);
+			total += compressed.sizes[level];
+		}
+
+		compressed.pixels.resize(total);
+		for (uint32_t level = 0; level < levels; level++)
+		{
+			compressImage(mips.level(level), mips.widths[level], mips.heights[level], format, compressed.pixels.data() + compressed.offsets[level]);
+		}
+	}
+
+	stbi_uc *loadRGBA(const std::string &path, uint32_t &width, uint32_t &height)
+	{
+		int texWidth, texHeight, texChannels;
+		stbi_uc *pixels = stbi_load(path.c_str(), &texWidth, &texHeight, &texChannels, STBI_rgb_alpha);
+		if (!pixels)
+		{
+			throw std::runtime_error("Couldn't load texture image " + path + "!");
+		}
+		width = (uint32_t)texWidth;
+		height = (uint32_t)texHeight;
+		return pixels;
+	}
+}
+
+bool readTextureFile(const std::string &path, uint32_t maxDimension, VkFormat &format, MipChain &mips)
+{
+	std::ifstream file(path, std::ios::ate | std::ios::binary);
+	if (!file.is_open())
+	{
+		return false;
+	}
+
+	size_t fileSize = (size_t)file.tellg();
+	TextureFileHeader header;
+	if (fileSize < sizeof(header))
+	{
+		return false;
+	}
+	file.seekg(0);
+	file.read(reinterpret_cast<char *>(&header), sizeof(header));
+
+	if (memcmp(header.magic, TEXTURE_FILE_MAGIC, sizeof(TEXTURE_FILE_MAGIC)) != 0 ||
+		header.version != TEXTURE_FILE_VERSION ||
+		(header.format != VK_FORMAT_BC1_RGB_UNORM_BLOCK && header.format != VK_FORMAT_BC3_UNORM_BLOCK) ||
+		header.width == 0 || header.height == 0 ||
+		header.width > maxDimension || header.height > maxDimension ||
+		header.mipLevels == 0 || header.mipLevels > 16 ||
+		header.mipLevels > mipLevelCount(header.width, header.height))
+	{
+		return false;
+	}
+
+	// Levels have to be back to back after the header, which is how
+	// writeTextureFile() lays them out, and exactly the size the
+	// format says they should be
+	BlockFormat blockFormat = toBlockFormat((VkFormat)header.format);
+	uint32_t width = header.width;
+	uint32_t height = header.height;
+	uint64_t expectedOffset = sizeof(header);
+	for (uint32_t level = 0; level < header.mipLevels; level++)
+	{
+		if (header.levelOffsets[level] != expectedOffset ||
+			header.levelSizes[level] != compressedSize(blockFormat, width, height))
+		{
+			return false;
+		}
+		expectedOffset += header.levelSizes[level];
+		width = std::max(width / 2, 1u);
+		height = std::max(height / 2, 1u);
+	}
+	if (expectedOffset > fileSize)
+	{
+		return false;
+	}
+
+	mips.widths.resize(header.mipLevels);
+	mips.heights.resize(header.mipLevels);
+	mips.offsets.resize(header.mipLevels);
+	mips.sizes.resize(header.mipLevels);
+	width = header.width;
+	height = header.height;
+	for (uint32_t level = 0; level < header.mipLevels; level++)
+	{
+		mips.widths[level] = width;
+		mips.heights[level] = height;
+		mips.offsets[level] = (size_t)(header.levelOffsets[level] - sizeof(header));
+		mips.sizes[level] = (size_t)header.levelSizes[level];
+		width = std::max(width / 2, 1u);
+		height = std::max(height / 2, 1u);
+	}
+
+	mips.pixels.resize((size_t)(expectedOffset - sizeof(header)));
+	file.read(reinterpret_cast<char *>(mips.pixels.data()), mips.pixels.size());
+	if (!file)
+	{
+		return false;
+	}
+
+	format = (VkFormat)header.format;
+	return true;
+}
+
+bool writeTextureFile(const std::string &path, VkFormat format, const MipChain &mips)
+{
+	if (mips.levelCount() == 0 || mips.levelCount() > 16)
+	{
+		return false;
+	}
+
+	TextureFileHeader header = {};
+	memcpy(header.magic, TEXTURE_FILE_MAGIC, sizeof(TEXTURE_FILE_MAGIC));
+	header.version = TEXTURE_FILE_VERSION;
+	header.format = (uint32_t)format;
+	header.width = mips.widths[0];
+	header.height = mips.heights[0];
+	header.mipLevels = mips.levelCount();
+
+	uint64_t offset = sizeof(header);
+	for (uint32_t level = 0; level < mips.levelCount(); level++)
+	{
+		header.levelOffsets[level] = offset;
+		header.levelSizes[level] = mips.levelSize(level);
+		offset += mips.levelSize(level);
+	}
+
+	return writeFileReplacing(path, [&](std::ostream &file)
+	{
+		file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+		for (uint32_t level = 0; level < mips.levelCount(); level++)
+		{
+			file.write(reinterpret_cast<const char *>(mips.level(level)), mips.levelSize(level));
+		}
+	});
+}
+
+void compressTextureFile(const std::string &srcPath, const std::string &dstPath)
+{
+	uint32_t width, height;
+	stbi_uc *pixels = loadRGBA(srcPath, width, height);
+
+	bool hasAlpha = false;
+	for (size_t i = 0; i < (size_t)width * height && !hasAlpha; i++)
+	{
+		hasAlpha = pixels[i * 4 + 3] != 255;
+	}
+
+	MipChain mips;
+	buildMipChain(pixels, width, height, mipLevelCount(width, height), mips);
+	stbi_image_free(pixels);
+
+	BlockFormat format = hasAlpha ? BlockFormat::BC3 : BlockFormat::BC1;
+	MipChain compressed;
+
+	auto start = std::chrono::high_resolution_clock::now();
+	compressMipChain(mips, format, compressed);
+	auto end = std::chrono::high_resolution_clock::now();
+
+	if (!writeTextureFile(dstPath, toVkFormat(format), compressed))
+	{
+		throw std::runtime_error("Couldn't write compressed texture " + dstPath + "!");
+	}
+
+	std::cout << srcPath << " -> " << dstPath << ": " << width << "x" << height << ", " << mips.levelCount() << " levels, "
+		<< (format == BlockFormat::BC1 ? "BC1" : "BC3") << ", " << mips.pixels.size() / 1024 << " KB -> " << compressed.pixels.size() / 1024 << " KB in "
+		<< std::chrono::duration<double, std::milli>(end - start).count() << " ms\n";
+}
+
+void benchmarkTextureCompression(const std::string &srcPath)
+{
+	uint32_t width, height;
+	stbi_uc *pixels = loadRGBA(srcPath, width, height);
+
+	MipChain mips;
+	buildMipChain(pixels, width, height, mipLevelCount(width, height), mips);
+	stbi_image_free(pixels);
+
+	std::cout << srcPath << ": " << width << "x" << height << ", " << mips.levelCount() << " levels\n";
+
+	const BlockFormat formats[] = { BlockFormat::BC1, BlockFormat::BC3 };
+	for (BlockFormat format : formats)
+	{
+		MipChain compressed;
+		auto start = std::chrono::high_resolution_clock::now();
+		compressMipChain(mips, format, compressed);
+		auto end = std::chrono::high_resolution_clock::now();
+		double ms = std::chrono::duration<double, std::milli>(end - start).count();
+
+		// PSNR of the top level only, the small ones barely
+		// change the number. alpha counts too for BC3
+		std::vector<uint8_t> decoded(mips.levelSize(0));
+		decompressImage(compressed.level(0), width, height, format, decoded.data());
+
+		size_t channels = format == BlockFormat::BC1 ? 3 : 4;
+		double squaredError = 0.0;
+		for (size_t i = 0; i < (size_t)width * height; i++)
+		{
+			for (size_t c = 0; c < channels; c++)
+			{
+				double diff = (double)mips.pixels[i * 4 + c] - decoded[i * 4 + c];
+				squaredError += diff * diff;
+			}
+		}
+		double mse = squaredError / ((double)width * height * channels);
+		double psnr = mse > 0.0 ? 10.0 * std::log10(255.0 * 255.0 / mse) : INFINITY;
+
+		double texels = (double)mips.pixels.size() / 4.0;
+		std::cout << "\t" << (format == BlockFormat::BC1 ? "BC1" : "BC3") << ": " << ms << " ms, "
+			<< texels / (ms * 1000.0) << " MTexels/s, " << psnr << " dB PSNR, "
+			<< compressed.pixels.size() / 1024 << " KB\n";
+	}
+}
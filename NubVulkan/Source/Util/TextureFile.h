@@ -0,0 +1,43 @@
+#pragma once
+
+#include <Util/TextureMips.h>
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include <cstdint>
+#include <string>
+
+// What a .nubtex file starts with. every mip level follows, biggest
+// first, already in the gpu's block layout so loading is a straight
+// copy into a staging buffer
+struct TextureFileHeader
+{
+	char magic[4];
+	uint32_t version;
+	// A VkFormat, BC1_RGB_UNORM_BLOCK or BC3_UNORM_BLOCK so far
+	uint32_t format;
+	uint32_t width;
+	uint32_t height;
+	uint32_t mipLevels;
+	uint64_t levelOffsets[16];
+	uint64_t levelSizes[16];
+};
+
+// Bump whenever the header changes
+const uint32_t TEXTURE_FILE_VERSION = 1;
+
+// false if it's missing or broken, or either side is 0 or bigger than
+// maxDimension (the gpu's maxImageDimension2D). mips.pixels then holds
+// the blocks
+bool readTextureFile(const std::string &path, uint32_t maxDimension, VkFormat &format, MipChain &mips);
+bool writeTextureFile(const std::string &path, VkFormat format, const MipChain &mips);
+
+// The offline bit: loads any image stb can, builds the full mip chain,
+// block compresses every level (BC3 if it has any alpha, else BC1) and
+// writes it out as a .nubtex
+void compressTextureFile(const std::string &srcPath, const std::string &dstPath);
+
+// Encode speed & quality (PSNR against the uncompressed mips) for both
+// formats, all on the cpu
+void benchmarkTextureCompression(const std::string &srcPath);
@@ -0,0 +1,84 @@
+#include <Util/TextureMips.h>
+
+#include <algorithm>
+#include <cstring>
+
+uint32_t mipLevelCount(uint32_t width, uint32_t height)
+{
+	uint32_t levels = 1;
+	uint32_t size = std::max(width, height);
+	while (size > 1)
+	{
+		size /= 2;
+		levels++;
+	}
+	return levels;
+}
+
+void downsampleBox(const uint8_t *src, uint32_t srcWidth, uint32_t srcHeight, uint8_t *dst)
+{
+	uint32_t dstWidth = std::max(srcWidth / 2, 1u);
+	uint32_t dstHeight = std::max(srcHeight / 2, 1u);
+	size_t srcPitch = (size_t)srcWidth * 4;
+
+	for (uint32_t y = 0; y < dstHeight; y++)
+	{
+		const uint8_t *row0 = src + std::min(y * 2, srcHeight - 1) * srcPitch;
+		const uint8_t *row1 = src + std::min(y * 2 + 1, srcHeight - 1) * srcPitch;
+		uint8_t *out = dst + (size_t)y * dstWidth * 4;
+
+		if (srcWidth == dstWidth * 2)
+		{
+			// The common case, kept dead simple so the compiler
+			// can vectorise it: every output byte is the rounded
+			// average of 4 bytes 4 apart
+			for (size_t i = 0; i < (size_t)dstWidth * 4; i++)
+			{
+				size_t s = (i & ~(size_t)3) * 2 + (i & 3);
+				out[i] = (uint8_t)((row0[s] + row0[s + 4] + row1[s] + row1[s + 4] + 2) >> 2);
+			}
+		}
+		else
+		{
+			for (uint32_t x = 0; x < dstWidth; x++)
+			{
+				size_t s0 = (size_t)std::min(x * 2, srcWidth - 1) * 4;
+				size_t s1 = (size_t)std::min(x * 2 + 1, srcWidth - 1) * 4;
+				for (size_t c = 0; c < 4; c++)
+				{
+					out[x * 4 + c] = (uint8_t)((row0[s0 + c] + row0[s1 + c] + row1[s0 + c] + row1[s1 + c] + 2) >> 2);
+				}
+			}
+		}
+	}
+}
+
+void buildMipChain(const uint8_t *pixels, uint32_t width, uint32_t height, uint32_t levels, MipChain &chain)
+{
+	levels = std::min(levels, mipLevelCount(width, height));
+	chain.widths.resize(levels);
+	chain.heights.resize(levels);
+	chain.offsets.resize(levels);
+	chain.sizes.resize(levels);
+
+	size_t total = 0;
+	for (uint32_t level = 0; level < levels; level++)
+	{
+		chain.widths[level] = width;
+		chain.heights[level] = height;
+		chain.offsets[level] = total;
+		chain.sizes[level] = (size_t)width * height * 4;
+		total += chain.sizes[level];
+
+		width = std::max(width / 2, 1u);
+		height = std::max(height / 2, 1u);
+	}
+
+	chain.pixels.resize(total);
+	memcpy(chain.pixels.data(), pixels, chain.levelSize(0));
+
+	for (uint32_t level = 1; level < levels; level++)
+	{
+		downsampleBox(chain.level(level - 1), chain.widths[level - 1], chain.heights[level - 1], chain.pixels.data() + chain.offsets[level]);
+	}
+}
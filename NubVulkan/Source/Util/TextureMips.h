@@ -0,0 +1,32 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Every mip level of an image, biggest first, all packed one after
+// another in pixels. rgba8 when built here, but a compressed texture
+// file loads into one of these too, hence sizes
+struct MipChain
+{
+	std::vector<uint8_t> pixels;
+	std::vector<uint32_t> widths;
+	std::vector<uint32_t> heights;
+	std::vector<size_t> offsets;
+	std::vector<size_t> sizes;
+
+	uint32_t levelCount() const { return (uint32_t)this->widths.size(); }
+	const uint8_t *level(uint32_t level) const { return this->pixels.data() + this->offsets[level]; }
+	size_t levelSize(uint32_t level) const { return this->sizes[level]; }
+};
+
+// All the way down to 1x1
+uint32_t mipLevelCount(uint32_t width, uint32_t height);
+
+// Halves an rgba8 image (rounding down, never below 1) with a 2x2 box
+// filter. odd edges just reuse the last row/column
+void downsampleBox(const uint8_t *src, uint32_t srcWidth, uint32_t srcHeight, uint8_t *dst);
+
+// The cpu side fallback for when the gpu can't blit the format. levels
+// caps how far down it goes, 1 is just a copy of pixels
+void buildMipChain(const uint8_t *pixels, uint32_t width, uint32_t height, uint32_t levels, MipChain &chain);
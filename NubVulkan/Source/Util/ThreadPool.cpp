@@ -0,0 +1,63 @@
+#include <Util/ThreadPool.h>
+
+#include <algorithm>
+
+ThreadPool::ThreadPool(unsigned threadCount)
+{
+	if (threadCount == 0)
+	{
+		threadCount = std::max(1u, std::thread::hardware_concurrency());
+	}
+
+	for (unsigned i = 0; i < threadCount; i++)
+	{
+		this->workers.emplace_back(&ThreadPool::workerLoop, this);
+	}
+}
+
+ThreadPool::~ThreadPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(this->mutex);
+		this->stopping = true;
+		this->jobs.clear();
+	}
+	this->wake.notify_all();
+
+	for (auto &worker : this->workers)
+	{
+		worker.join();
+	}
+}
+
+void ThreadPool::push(std::function<void()> job)
+{
+	{
+		std::lock_guard<std::mutex> lock(this->mutex);
+		this->jobs.push_back(std::move(job));
+	}
+	this->wake.notify_one();
+}
+
+void ThreadPool::workerLoop()
+{
+	for (;;)
+	{
+		std::function<void()> job;
+		{
+			std::unique_lock<std::mutex> lock(this->mutex);
+			this->wake.wait(lock, [this]() { return this->stopping || !this->jobs.empty(); });
+			if (this->stopping)
+			{
+				return;
+			}
+
+			job = std::move(this->jobs.front());
+			this->jobs.pop_front();
+		}
+
+		// packaged_task catches anything the job throws and hands
+		// it to the future, so nothing escapes out of here
+		job();
+	}
+}
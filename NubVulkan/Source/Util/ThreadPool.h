@@ -0,0 +1,51 @@
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+// A handful of worker threads chewing through a queue of jobs. each
+// job's result (or whatever it threw) comes back through a future
+class ThreadPool
+{
+public:
+	// 0 means one per hardware thread
+	explicit ThreadPool(unsigned threadCount = 0);
+	// Jobs that haven't started yet are dropped (their futures throw
+	// broken_promise), ones already running get to finish
+	~ThreadPool();
+
+	ThreadPool(const ThreadPool &) = delete;
+	ThreadPool &operator=(const ThreadPool &) = delete;
+
+	template<typename Fn>
+	std::future<typename std::result_of<Fn()>::type> submit(Fn fn)
+	{
+		typedef typename std::result_of<Fn()>::type Result;
+
+		// std::function wants something copyable, a packaged_task
+		// isn't, so it rides along in a shared_ptr
+		auto task = std::make_shared<std::packaged_task<Result()>>(std::move(fn));
+		std::future<Result> result = task->get_future();
+		this->push([task]() { (*task)(); });
+		return result;
+	}
+
+	unsigned threadCount() const { return (unsigned)this->workers.size(); }
+
+private:
+	void push(std::function<void()> job);
+	void workerLoop();
+
+	std::mutex mutex;
+	std::condition_variable wake;
+	std::deque<std::function<void()>> jobs;
+	bool stopping = false;
+	std::vector<std::thread> workers;
+};
@@ -0,0 +1,387 @@
+#include <Util/UploadContext.h>
+
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+
+UploadContext::UploadContext(const VDevice &device, MemoryAllocator &allocator) : device(device), allocator(allocator)
+{
+}
+
+UploadContext::~UploadContext()
+{
+	this->cleanup();
+}
+
+void UploadContext::init(VkQueue transferQueue, uint32_t transferFamily, VkQueue graphicsQueue, uint32_t graphicsFamily)
+{
+	this->transferQueue = transferQueue;
+	this->transferFamily = transferFamily;
+	this->graphicsQueue = graphicsQueue;
+	this->graphicsFamily = graphicsFamily;
+
+	// Our own pool(s), transient since these buffers only live for one
+	// batch, and resettable so we can recycle them
+	VkCommandPoolCreateInfo poolInfo = {};
+	poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+	poolInfo.queueFamilyIndex = transferFamily;
+	poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT | VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+
+	if (vkCreateCommandPool(this->device, &poolInfo, nullptr, this->commandPool.replace()) != VK_SUCCESS)
+	{
+		throw std::runtime_error("Couldn't create upload command pool!");
+	}
+
+	if (this->hasSeparateQueue())
+	{
+		poolInfo.queueFamilyIndex = graphicsFamily;
+		if (vkCreateCommandPool(this->device, &poolInfo, nullptr, this->graphicsCommandPool.replace()) != VK_SUCCESS)
+		{
+			throw std::runtime_error("Couldn't create upload command pool!");
+		}
+	}
+}
+
+void UploadContext::cleanup()
+{
+	if ((VkCommandPool)this->commandPool == VK_NULL_HANDLE)
+	{
+		return;
+	}
+
+	// Anything half recorded just gets thrown away
+	if (this->recording.cmdBuff != VK_NULL_HANDLE)
+	{
+		vkEndCommandBuffer(this->recording.cmdBuff);
+		if (this->hasSeparateQueue())
+		{
+			vkEndCommandBuffer(this->recording.graphicsCmdBuff);
+		}
+		this->recording.resources.clear();
+		this->freeBatches.push_back(std::move(this->recording));
+		this->recording = Batch();
+	}
+
+	this->wait(this->lastSubmitted);
+
+	for (auto &batch : this->freeBatches)
+	{
+		vkDestroyFence(this->device, batch.fence, nullptr);
+		if (batch.semaphore != VK_NULL_HANDLE)
+		{
+			vkDestroySemaphore(this->device, batch.semaphore, nullptr);
+		}
+	}
+	// command buffers go with the pools
+	this->freeBatches.clear();
+	this->graphicsCommandPool.replace();
+	this->commandPool.replace();
+}
+
+void UploadContext::beginBatch()
+{
+	if (this->freeBatches.empty())
+	{
+		Batch batch;
+		batch.profilerSlot = this->batchCount++;
+
+		VkCommandBufferAllocateInfo allocInfo = {};
+		allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+		allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+		allocInfo.commandPool = this->commandPool;
+		allocInfo.commandBufferCount = 1;
+
+		if (vkAllocateCommandBuffers(this->device, &allocInfo, &batch.cmdBuff) != VK_SUCCESS)
+		{
+			throw std::runtime_error("Couldn't allocate upload command buffer!");
+		}
+		batch.graphicsCmdBuff = batch.cmdBuff;
+
+		if (this->hasSeparateQueue())
+		{
+			allocInfo.commandPool = this->graphicsCommandPool;
+			if (vkAllocateCommandBuffers(this->device, &allocInfo, &batch.graphicsCmdBuff) != VK_SUCCESS)
+			{
+				throw std::runtime_error("Couldn't allocate upload command buffer!");
+			}
+
+			VkSemaphoreCreateInfo semaphoreInfo = {};
+			semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+			if (vkCreateSemaphore(this->device, &semaphoreInfo, nullptr, &batch.semaphore) != VK_SUCCESS)
+			{
+				throw std::runtime_error("Couldn't create upload semaphore!");
+			}
+		}
+
+		VkFenceCreateInfo fenceInfo = {};
+		fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+		if (vkCreateFence(this->device, &fenceInfo, nullptr, &batch.fence) != VK_SUCCESS)
+		{
+			throw std::runtime_error("Couldn't create upload fence!");
+		}
+
+		this->freeBatches.push_back(std::move(batch));
+	}
+
+	this->recording = std::move(this->freeBatches.back());
+	this->freeBatches.pop_back();
+
+	VkCommandBufferBeginInfo beginInfo = {};
+	beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+	beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+	// begin implicitly resets them, that's what the pool's
+	// _RESET_COMMAND_BUFFER_BIT is for
+	vkBeginCommandBuffer(this->recording.cmdBuff, &beginInfo);
+	if (this->hasSeparateQueue())
+	{
+		vkBeginCommandBuffer(this->recording.graphicsCmdBuff, &beginInfo);
+	}
+
+	if (this->profiler)
+	{
+		this->profiler->resetSlot(this->recording.cmdBuff, this->recording.profilerSlot);
+		this->recording.profilerScope = this->profiler->beginScope(this->recording.cmdBuff, this->recording.profilerSlot, "uploads");
+	}
+}
+
+VkCommandBuffer UploadContext::getCommandBuffer()
+{
+	if (this->recording.cmdBuff == VK_NULL_HANDLE)
+	{
+		this->beginBatch();
+	}
+	return this->recording.cmdBuff;
+}
+
+VkCommandBuffer UploadContext::getGraphicsCommandBuffer()
+{
+	if (this->recording.cmdBuff == VK_NULL_HANDLE)
+	{
+		this->beginBatch();
+	}
+	return this->recording.graphicsCmdBuff;
+}
+
+bool UploadContext::isRecording() const
+{
+	return this->recording.cmdBuff != VK_NULL_HANDLE;
+}
+
+VkBuffer UploadContext::stage(const void *data, VkDeviceSize size)
+{
+	// Same deal as HelloTriangleApp::createBuffer, just owned by us
+	// (well, by the batch) instead of the caller
+	auto buff = std::make_shared<VBuffer>(this->device);
+	auto buffMemory = std::make_shared<VAllocation>(this->allocator);
+
+	VkBufferCreateInfo buffInfo = {};
+	buffInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+	buffInfo.size = size;
+	buffInfo.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+	buffInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+	if (vkCreateBuffer(this->device, &buffInfo, nullptr, buff->replace()) != VK_SUCCESS)
+	{
+		throw std::runtime_error("Couldn't create staging buffer!");
+	}
+
+	VkMemoryRequirements memReqs;
+	vkGetBufferMemoryRequirements(this->device, *buff, &memReqs);
+
+	uint32_t memoryTypeIndex = this->allocator.findMemoryType(memReqs.memoryTypeBits, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+	buffMemory->reset(this->allocator.allocate(memReqs, memoryTypeIndex, true));
+	vkBindBufferMemory(this->device, *buff, buffMemory->memory(), buffMemory->offset());
+
+	memcpy(buffMemory->map(), data, (size_t)size);
+
+	this->keepAlive(buffMemory);
+	this->keepAlive(buff);
+
+	return *buff;
+}
+
+void UploadContext::keepAlive(std::shared_ptr<void> resource)
+{
+	this->getCommandBuffer();
+	this->recording.resources.push_back(std::move(resource));
+}
+
+void UploadContext::releaseBuffer(VkBuffer buffer, VkAccessFlags dstAccess, VkPipelineStageFlags dstStage)
+{
+	VkBufferMemoryBarrier barrier = {};
+	barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+	barrier.buffer = buffer;
+	barrier.offset = 0;
+	barrier.size = VK_WHOLE_SIZE;
+
+	if (!this->hasSeparateQueue())
+	{
+		barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		barrier.dstAccessMask = dstAccess;
+		barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		vkCmdPipelineBarrier(this->getCommandBuffer(), VK_PIPELINE_STAGE_TRANSFER_BIT, dstStage, 0, 0, nullptr, 1, &barrier, 0, nullptr);
+		return;
+	}
+
+	// The release half, on the transfer queue. dst access is
+	// meaningless here, the other queue's stages don't exist
+	// for this one
+	barrier.srcQueueFamilyIndex = this->transferFamily;
+	barrier.dstQueueFamilyIndex = this->graphicsFamily;
+	barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	barrier.dstAccessMask = 0;
+	vkCmdPipelineBarrier(this->getCommandBuffer(), VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0, 0, nullptr, 1, &barrier, 0, nullptr);
+
+	// and the acquire half on graphics, which has to match it.
+	// the semaphore between the two submits covers the src side
+	barrier.srcAccessMask = 0;
+	barrier.dstAccessMask = dstAccess;
+	vkCmdPipelineBarrier(this->getGraphicsCommandBuffer(), VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, dstStage, 0, 0, nullptr, 1, &barrier, 0, nullptr);
+}
+
+void UploadContext::releaseImage(VkImage image, VkImageAspectFlags aspectMask, VkImageLayout oldLayout, VkImageLayout newLayout, VkAccessFlags dstAccess, VkPipelineStageFlags dstStage,
+	uint32_t baseMipLevel, uint32_t levelCount)
+{
+	VkImageMemoryBarrier barrier = {};
+	barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+	barrier.oldLayout = oldLayout;
+	barrier.newLayout = newLayout;
+	barrier.image = image;
+	barrier.subresourceRange.aspectMask = aspectMask;
+	barrier.subresourceRange.baseMipLevel = baseMipLevel;
+	barrier.subresourceRange.levelCount = levelCount;
+	barrier.subresourceRange.baseArrayLayer = 0;
+	barrier.subresourceRange.layerCount = VK_REMAINING_ARRAY_LAYERS;
+
+	if (!this->hasSeparateQueue())
+	{
+		barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		barrier.dstAccessMask = dstAccess;
+		barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		vkCmdPipelineBarrier(this->getCommandBuffer(), VK_PIPELINE_STAGE_TRANSFER_BIT, dstStage, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+		return;
+	}
+
+	// Same release/acquire pair as buffers. the layout change is
+	// in both and has to match, it only actually happens once
+	barrier.srcQueueFamilyIndex = this->transferFamily;
+	barrier.dstQueueFamilyIndex = this->graphicsFamily;
+	barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	barrier.dstAccessMask = 0;
+	vkCmdPipelineBarrier(this->getCommandBuffer(), VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+	barrier.srcAccessMask = 0;
+	barrier.dstAccessMask = dstAccess;
+	vkCmdPipelineBarrier(this->getGraphicsCommandBuffer(), VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, dstStage, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+}
+
+UploadTicket UploadContext::submit()
+{
+	if (this->recording.cmdBuff == VK_NULL_HANDLE)
+	{
+		return this->lastSubmitted;
+	}
+
+	if (this->profiler)
+	{
+		this->profiler->endScope(this->recording.cmdBuff, this->recording.profilerSlot, this->recording.profilerScope);
+	}
+	vkEndCommandBuffer(this->recording.cmdBuff);
+	this->recording.ticket = ++this->lastSubmitted;
+
+	VkSubmitInfo submitInfo = {};
+	submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+	submitInfo.commandBufferCount = 1;
+	submitInfo.pCommandBuffers = &this->recording.cmdBuff;
+
+	if (!this->hasSeparateQueue())
+	{
+		if (vkQueueSubmit(this->transferQueue, 1, &submitInfo, this->recording.fence) != VK_SUCCESS)
+		{
+			throw std::runtime_error("Couldn't submit uploads!");
+		}
+		this->submitCount++;
+	}
+	else
+	{
+		vkEndCommandBuffer(this->recording.graphicsCmdBuff);
+
+		// copies first...
+		submitInfo.signalSemaphoreCount = 1;
+		submitInfo.pSignalSemaphores = &this->recording.semaphore;
+		if (vkQueueSubmit(this->transferQueue, 1, &submitInfo, VK_NULL_HANDLE) != VK_SUCCESS)
+		{
+			throw std::runtime_error("Couldn't submit uploads!");
+		}
+
+		// ...then the acquires on graphics once they're done. the
+		// fence goes here, since this one finishes last
+		VkPipelineStageFlags waitStage = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
+		VkSubmitInfo acquireInfo = {};
+		acquireInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+		acquireInfo.waitSemaphoreCount = 1;
+		acquireInfo.pWaitSemaphores = &this->recording.semaphore;
+		acquireInfo.pWaitDstStageMask = &waitStage;
+		acquireInfo.commandBufferCount = 1;
+		acquireInfo.pCommandBuffers = &this->recording.graphicsCmdBuff;
+		if (vkQueueSubmit(this->graphicsQueue, 1, &acquireInfo, this->recording.fence) != VK_SUCCESS)
+		{
+			throw std::runtime_error("Couldn't submit upload acquires!");
+		}
+		this->submitCount += 2;
+	}
+
+	if (this->profiler)
+	{
+		this->profiler->submitted(this->recording.profilerSlot);
+	}
+
+	this->inFlight.push_back(std::move(this->recording));
+	this->recording = Batch();
+
+	return this->lastSubmitted;
+}
+
+bool UploadContext::isComplete(UploadTicket ticket)
+{
+	this->retireCompleted();
+	return ticket <= this->lastCompleted;
+}
+
+void UploadContext::wait(UploadTicket ticket)
+{
+	// Batches finish in submit order, so waiting on each
+	// fence up to the ticket's one covers it
+	while (!this->inFlight.empty() && this->inFlight.front().ticket <= ticket)
+	{
+		Batch &batch = this->inFlight.front();
+		vkWaitForFences(this->device, 1, &batch.fence, VK_TRUE, std::numeric_limits<uint64_t>::max());
+		this->retire(batch);
+		this->inFlight.pop_front();
+	}
+}
+
+void UploadContext::retireCompleted()
+{
+	while (!this->inFlight.empty() && vkGetFenceStatus(this->device, this->inFlight.front().fence) == VK_SUCCESS)
+	{
+		this->retire(this->inFlight.front());
+		this->inFlight.pop_front();
+	}
+}
+
+void UploadContext::retire(Batch &batch)
+{
+	vkResetFences(this->device, 1, &batch.fence);
+	if (this->profiler)
+	{
+		this->profiler->collect(batch.profilerSlot);
+	}
+	// staging buffers & co. go poof here
+	batch.resources.clear();
+	this->lastCompleted = batch.ticket;
+	this->freeBatches.push_back(std::move(batch));
+}
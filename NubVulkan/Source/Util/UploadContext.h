@@ -0,0 +1,121 @@
+#pragma once
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include <Util/VHandle.h>
+#include <Util/MemoryAllocator.h>
+#include <Util/GpuProfiler.h>
+
+#include <deque>
+#include <memory>
+#include <vector>
+
+// Goes up by one every submit(), a batch is done once its ticket is
+// <= the last completed one. 0 means "nothing", always complete
+typedef uint64_t UploadTicket;
+
+// Records copies & layout transitions from any number of uploads into
+// one command buffer and submits them together with a fence, instead
+// of a submit + vkQueueWaitIdle per resource. staging stuff handed to
+// it stays alive till the gpu's done with the batch that used it.
+//
+// Copies go on the transfer queue. if that's a different family from
+// graphics, every batch also gets a graphics side command buffer that
+// runs after it (waiting on a semaphore) to take ownership of what was
+// uploaded. same family? both are the one command buffer
+class UploadContext
+{
+public:
+	UploadContext(const VDevice &device, MemoryAllocator &allocator);
+	~UploadContext();
+
+	UploadContext(const UploadContext &) = delete;
+	UploadContext &operator=(const UploadContext &) = delete;
+
+	void init(VkQueue transferQueue, uint32_t transferFamily, VkQueue graphicsQueue, uint32_t graphicsFamily);
+	// Waits on everything still in flight and frees it all
+	void cleanup();
+	// Times every batch's copies as an "uploads" scope, a profiler slot
+	// per batch. has to be made for the transfer family, and outlive us
+	void setProfiler(GpuProfiler *profiler) { this->profiler = profiler; }
+
+	// The batch being recorded (starts a new one if need be). copies
+	// go in the first, anything that needs the graphics queue (eg
+	// depth layouts) in the second
+	VkCommandBuffer getCommandBuffer();
+	VkCommandBuffer getGraphicsCommandBuffer();
+	bool isRecording() const;
+	bool hasSeparateQueue() const { return this->transferFamily != this->graphicsFamily; }
+
+	// Copies data into a host visible staging buffer owned by the
+	// current batch and hands back the buffer to copy from
+	VkBuffer stage(const void *data, VkDeviceSize size);
+	// Anything else the batch's commands use that has to outlive it,
+	// eg a staging image. dropped once the batch completes
+	void keepAlive(std::shared_ptr<void> resource);
+
+	// Makes something written by this batch's copies usable from the
+	// graphics queue at dstStage. with separate families that's a
+	// release on the transfer side + acquire on the graphics side,
+	// otherwise just a plain barrier. images change layout on the way,
+	// and can be handed over a few mip levels at a time
+	void releaseBuffer(VkBuffer buffer, VkAccessFlags dstAccess, VkPipelineStageFlags dstStage);
+	void releaseImage(VkImage image, VkImageAspectFlags aspectMask, VkImageLayout oldLayout, VkImageLayout newLayout, VkAccessFlags dstAccess, VkPipelineStageFlags dstStage,
+		uint32_t baseMipLevel = 0, uint32_t levelCount = VK_REMAINING_MIP_LEVELS);
+
+	// Ends & submits the current batch. returns its ticket, or the
+	// last submitted one if nothing was recorded
+	UploadTicket submit();
+	bool isComplete(UploadTicket ticket);
+	void wait(UploadTicket ticket);
+	// Drops the staging stuff of every batch the gpu's finished with
+	void retireCompleted();
+
+	uint64_t getSubmitCount() const { return this->submitCount; }
+
+private:
+	struct Batch
+	{
+		VkCommandBuffer cmdBuff = VK_NULL_HANDLE;
+		// Same as cmdBuff without a separate transfer family
+		VkCommandBuffer graphicsCmdBuff = VK_NULL_HANDLE;
+		// Signalled by the transfer submit, waited on by the graphics
+		// one. only with a separate transfer family
+		VkSemaphore semaphore = VK_NULL_HANDLE;
+		VkFence fence = VK_NULL_HANDLE;
+		UploadTicket ticket = 0;
+		std::vector<std::shared_ptr<void>> resources;
+		// Batches get recycled, so each keeps its own profiler slot
+		uint32_t profilerSlot = 0;
+		uint32_t profilerScope = 0;
+	};
+
+	void beginBatch();
+	void retire(Batch &batch);
+
+	const VDevice &device;
+	MemoryAllocator &allocator;
+	VkQueue transferQueue = VK_NULL_HANDLE;
+	VkQueue graphicsQueue = VK_NULL_HANDLE;
+	uint32_t transferFamily = 0;
+	uint32_t graphicsFamily = 0;
+
+	VCommandPool commandPool{ device };
+	// Only made with a separate transfer family
+	VCommandPool graphicsCommandPool{ device };
+
+	// Being recorded into, if cmdBuff isn't null
+	Batch recording;
+	// Submitted, oldest first
+	std::deque<Batch> inFlight;
+	// Done, kept for their command buffers, fence & semaphore
+	std::vector<Batch> freeBatches;
+
+	GpuProfiler *profiler = nullptr;
+	uint32_t batchCount = 0;
+
+	UploadTicket lastSubmitted = 0;
+	UploadTicket lastCompleted = 0;
+	uint64_t submitCount = 0;
+};
@@ -1,3 +0,0 @@
-#include <Util/VDeleter.h>
-
-// Well, it's a templated class, so I guess there's nothing here \_(?)_/
\ No newline at end of file
@@ -0,0 +1,63 @@
+#include <Util/VHandle.h>
+
+#include <type_traits>
+
+// Still a template, so still nothing to compile here. what's here
+// instead is checks that a handle really is no bigger than what it
+// wraps, and that it behaves in a vector. if any of these go off
+// the build stops, no need to run anything
+
+namespace
+{
+	// What a handle with a parent should boil down to
+	template <typename T>
+	struct RawChild
+	{
+		const void *parent;
+		T handle;
+	};
+
+	// No parent, no pointer: exactly the raw handle
+	static_assert(sizeof(VInstance) == sizeof(VkInstance), "VInstance should be the size of a VkInstance");
+	static_assert(sizeof(VDevice) == sizeof(VkDevice), "VDevice should be the size of a VkDevice");
+	static_assert(alignof(VDevice) == alignof(VkDevice), "VDevice should line up like a VkDevice");
+
+	// Instance children, a dispatchable parent
+	static_assert(sizeof(VSurface) == sizeof(RawChild<VkSurfaceKHR>), "VSurface should be a VkSurfaceKHR and a parent pointer");
+	static_assert(sizeof(VDebugReportCallback) == sizeof(RawChild<VkDebugReportCallbackEXT>), "VDebugReportCallback should be a VkDebugReportCallbackEXT and a parent pointer");
+
+	// Device children, every kind the app holds on to
+	static_assert(sizeof(VSwapchain) == sizeof(RawChild<VkSwapchainKHR>), "VSwapchain should be a VkSwapchainKHR and a parent pointer");
+	static_assert(sizeof(VImage) == sizeof(RawChild<VkImage>), "VImage should be a VkImage and a parent pointer");
+	static_assert(sizeof(VImageView) == sizeof(RawChild<VkImageView>), "VImageView should be a VkImageView and a parent pointer");
+	static_assert(sizeof(VSampler) == sizeof(RawChild<VkSampler>), "VSampler should be a VkSampler and a parent pointer");
+	static_assert(sizeof(VBuffer) == sizeof(RawChild<VkBuffer>), "VBuffer should be a VkBuffer and a parent pointer");
+	static_assert(sizeof(VFramebuffer) == sizeof(RawChild<VkFramebuffer>), "VFramebuffer should be a VkFramebuffer and a parent pointer");
+	static_assert(sizeof(VRenderPass) == sizeof(RawChild<VkRenderPass>), "VRenderPass should be a VkRenderPass and a parent pointer");
+	static_assert(sizeof(VShaderModule) == sizeof(RawChild<VkShaderModule>), "VShaderModule should be a VkShaderModule and a parent pointer");
+	static_assert(sizeof(VDescriptorSetLayout) == sizeof(RawChild<VkDescriptorSetLayout>), "VDescriptorSetLayout should be a VkDescriptorSetLayout and a parent pointer");
+	static_assert(sizeof(VDescriptorPool) == sizeof(RawChild<VkDescriptorPool>), "VDescriptorPool should be a VkDescriptorPool and a parent pointer");
+	static_assert(sizeof(VPipelineLayout) == sizeof(RawChild<VkPipelineLayout>), "VPipelineLayout should be a VkPipelineLayout and a parent pointer");
+	static_assert(sizeof(VPipeline) == sizeof(RawChild<VkPipeline>), "VPipeline should be a VkPipeline and a parent pointer");
+	static_assert(sizeof(VPipelineCache) == sizeof(RawChild<VkPipelineCache>), "VPipelineCache should be a VkPipelineCache and a parent pointer");
+	static_assert(sizeof(VCommandPool) == sizeof(RawChild<VkCommandPool>), "VCommandPool should be a VkCommandPool and a parent pointer");
+	static_assert(sizeof(VQueryPool) == sizeof(RawChild<VkQueryPool>), "VQueryPool should be a VkQueryPool and a parent pointer");
+	static_assert(sizeof(VSemaphore) == sizeof(RawChild<VkSemaphore>), "VSemaphore should be a VkSemaphore and a parent pointer");
+	static_assert(sizeof(VFence) == sizeof(RawChild<VkFence>), "VFence should be a VkFence and a parent pointer");
+
+	// One owner at a time: moving's fine, copying isn't
+	static_assert(!std::is_copy_constructible<VBuffer>::value, "handles shouldn't be copyable");
+	static_assert(!std::is_copy_assignable<VBuffer>::value, "handles shouldn't be copy assignable");
+	static_assert(std::is_nothrow_move_constructible<VBuffer>::value, "handles should move without throwing, so vectors move them when they grow");
+	static_assert(std::is_nothrow_move_assignable<VBuffer>::value, "handles should move assign without throwing");
+	static_assert(std::is_nothrow_move_constructible<VDevice>::value, "parentless handles should move without throwing too");
+
+	// Children need their parent, the instance & device don't
+	static_assert(std::is_default_constructible<VInstance>::value, "VInstance should need no parent");
+	static_assert(std::is_default_constructible<VDevice>::value, "VDevice should need no parent");
+	static_assert(!std::is_default_constructible<VBuffer>::value, "VBuffer shouldn't be made without its device");
+	static_assert(std::is_constructible<VBuffer, const VDevice &>::value, "VBuffer should be made from its device");
+	static_assert(std::is_constructible<VSurface, const VInstance &>::value, "VSurface should be made from its instance");
+	static_assert(!std::is_constructible<VBuffer, const VInstance &>::value, "VBuffer shouldn't be made from the instance");
+	static_assert(!std::is_constructible<VSurface, const VDevice &>::value, "VSurface shouldn't be made from a device");
+}
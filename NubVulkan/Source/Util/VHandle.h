@@ -0,0 +1,222 @@
+#pragma once
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+// Owns one vulkan object and destroys it when it goes. what kind of
+// object it is, what it's made from (its parent, the device or the
+// instance) and how it's destroyed all come from Traits at compile time,
+// so a handle is just the raw handle plus a pointer to its parent and
+// destroying it is a direct call, no std::function in sight.
+//
+// Traits looks like:
+//	struct VBufferTraits
+//	{
+//		typedef VkBuffer Handle;
+//		typedef VDeviceTraits Parent;	// or VNoParent
+//		static void destroy(VkDevice device, VkBuffer buffer);
+//	};
+// and everything below has one made with NUB_VHANDLE(). they're keyed
+// on their own struct rather than the handle type because on 32 bit
+// every non-dispatchable handle is the same uint64_t.
+//
+// Handles can be moved but not copied, so they sit in a std::vector
+// just fine. the parent's looked up when the object's destroyed, not
+// when the handle's made, so members can point at a device that isn't
+// created yet. parents have to stay put while they have children
+template <typename Traits>
+class VHandle;
+
+// Parent of the instance & the device, which are destroyed on their own
+struct VNoParent {};
+
+template <typename ParentTraits>
+class VHandleParent
+{
+protected:
+	typedef VHandle<ParentTraits> Parent;
+
+	// (the parent's & is the address of its raw handle)
+	explicit VHandleParent(const Parent &parent) : parent(&parent) {}
+
+	typename ParentTraits::Handle parentHandle() const { return *this->parent; }
+
+private:
+	const typename ParentTraits::Handle *parent;
+};
+
+// Nothing to point at, so it takes up no room at all
+template <>
+class VHandleParent<VNoParent>
+{
+protected:
+	typedef VNoParent Parent;
+
+	VHandleParent() = default;
+	explicit VHandleParent(const VNoParent &) {}
+
+	VNoParent parentHandle() const { return VNoParent(); }
+};
+
+template <typename Traits>
+class VHandle : private VHandleParent<typename Traits::Parent>
+{
+	typedef VHandleParent<typename Traits::Parent> Base;
+
+public:
+	typedef typename Traits::Handle Handle;
+
+	// Only the instance & the device can be made without a parent
+	VHandle() = default;
+
+	// Its device or instance
+	explicit VHandle(const typename Base::Parent &parent) : Base(parent) {}
+
+	VHandle(const VHandle &) = delete;
+	VHandle &operator=(const VHandle &) = delete;
+
+	VHandle(VHandle &&other) noexcept : Base(static_cast<const Base &>(other)), object(other.release()) {}
+
+	VHandle &operator=(VHandle &&other) noexcept
+	{
+		// (& is taken, it hands out the raw handle)
+		if (std::addressof(other) != this)
+		{
+			this->cleanup();
+			Base::operator=(static_cast<const Base &>(other));
+			this->object = other.release();
+		}
+		return *this;
+	}
+
+	~VHandle()
+	{
+		this->cleanup();
+	}
+
+	const Handle *operator&() const
+	{
+		return &this->object;
+	}
+
+	// Destroys what's there and hands out somewhere for a vkCreate*
+	// to put the new one
+	Handle *replace()
+	{
+		this->cleanup();
+		return &this->object;
+	}
+
+	// Hands the object over without destroying it, it's the caller's
+	// to get rid of now
+	Handle release()
+	{
+		Handle released = this->object;
+		this->object = VK_NULL_HANDLE;
+		return released;
+	}
+
+	operator Handle() const
+	{
+		return this->object;
+	}
+
+	void operator=(Handle rhs)
+	{
+		if (rhs != this->object)
+		{
+			this->cleanup();
+			this->object = rhs;
+		}
+	}
+
+	template <typename V>
+	bool operator==(V rhs) const
+	{
+		return this->object == Handle(rhs);
+	}
+
+private:
+	Handle object = VK_NULL_HANDLE;
+
+	void cleanup()
+	{
+		if (this->object != VK_NULL_HANDLE)
+		{
+			Traits::destroy(this->parentHandle(), this->object);
+		}
+		this->object = VK_NULL_HANDLE;
+	}
+};
+
+// std::vector's resize(count, value) for handles, which can't be
+// copied. any new ones are empty and belong to parent
+template <typename Traits, typename ParentTraits>
+void resizeHandles(std::vector<VHandle<Traits>> &handles, size_t count, const VHandle<ParentTraits> &parent)
+{
+	if (count < handles.size())
+	{
+		handles.erase(handles.begin() + count, handles.end());
+	}
+	handles.reserve(count);
+	while (handles.size() < count)
+	{
+		handles.emplace_back(parent);
+	}
+}
+
+// Lives in Constants.cpp, the extension's function has to be looked up
+void DestroyDebugReportCallbackEXT(VkInstance instance, VkDebugReportCallbackEXT callback, const VkAllocationCallbacks* pAllocator);
+
+// VName, a handle to a VkHandleType with VNameTraits to go with it
+#define NUB_VHANDLE(Name, HandleType, ParentTraits, destroyFunc) \
+	struct V##Name##Traits \
+	{ \
+		typedef HandleType Handle; \
+		typedef ParentTraits Parent; \
+		static void destroy(ParentTraits::Handle parent, HandleType handle) { destroyFunc(parent, handle, nullptr); } \
+	}; \
+	typedef VHandle<V##Name##Traits> V##Name;
+
+struct VInstanceTraits
+{
+	typedef VkInstance Handle;
+	typedef VNoParent Parent;
+	static void destroy(VNoParent, VkInstance instance) { vkDestroyInstance(instance, nullptr); }
+};
+typedef VHandle<VInstanceTraits> VInstance;
+
+struct VDeviceTraits
+{
+	typedef VkDevice Handle;
+	typedef VNoParent Parent;
+	static void destroy(VNoParent, VkDevice device) { vkDestroyDevice(device, nullptr); }
+};
+typedef VHandle<VDeviceTraits> VDevice;
+
+NUB_VHANDLE(DebugReportCallback, VkDebugReportCallbackEXT, VInstanceTraits, DestroyDebugReportCallbackEXT)
+NUB_VHANDLE(Surface, VkSurfaceKHR, VInstanceTraits, vkDestroySurfaceKHR)
+
+NUB_VHANDLE(Swapchain, VkSwapchainKHR, VDeviceTraits, vkDestroySwapchainKHR)
+NUB_VHANDLE(Image, VkImage, VDeviceTraits, vkDestroyImage)
+NUB_VHANDLE(ImageView, VkImageView, VDeviceTraits, vkDestroyImageView)
+NUB_VHANDLE(Sampler, VkSampler, VDeviceTraits, vkDestroySampler)
+NUB_VHANDLE(Buffer, VkBuffer, VDeviceTraits, vkDestroyBuffer)
+NUB_VHANDLE(Framebuffer, VkFramebuffer, VDeviceTraits, vkDestroyFramebuffer)
+NUB_VHANDLE(RenderPass, VkRenderPass, VDeviceTraits, vkDestroyRenderPass)
+NUB_VHANDLE(ShaderModule, VkShaderModule, VDeviceTraits, vkDestroyShaderModule)
+NUB_VHANDLE(DescriptorSetLayout, VkDescriptorSetLayout, VDeviceTraits, vkDestroyDescriptorSetLayout)
+NUB_VHANDLE(DescriptorPool, VkDescriptorPool, VDeviceTraits, vkDestroyDescriptorPool)
+NUB_VHANDLE(PipelineLayout, VkPipelineLayout, VDeviceTraits, vkDestroyPipelineLayout)
+NUB_VHANDLE(Pipeline, VkPipeline, VDeviceTraits, vkDestroyPipeline)
+NUB_VHANDLE(PipelineCache, VkPipelineCache, VDeviceTraits, vkDestroyPipelineCache)
+NUB_VHANDLE(CommandPool, VkCommandPool, VDeviceTraits, vkDestroyCommandPool)
+NUB_VHANDLE(QueryPool, VkQueryPool, VDeviceTraits, vkDestroyQueryPool)
+NUB_VHANDLE(Semaphore, VkSemaphore, VDeviceTraits, vkDestroySemaphore)
+NUB_VHANDLE(Fence, VkFence, VDeviceTraits, vkDestroyFence)
+
+#undef NUB_VHANDLE
@@ -0,0 +1,82 @@
+#include <Util/VertexHashMap.h>
+
+#include <cstring>
+
+static_assert(sizeof(Vertex) == 32, "VertexHashMap/hashVertex assume a tightly packed 32 byte Vertex");
+
+void VertexHashMap::reserve(size_t expectedUnique)
+{
+	// Keep it at most half full, probes stay short that way
+	size_t capacity = 16;
+	while (capacity < expectedUnique * 2)
+	{
+		capacity *= 2;
+	}
+
+	if (capacity > this->slots.size() && this->count == 0)
+	{
+		this->slots.assign(capacity, 0);
+		this->mask = capacity - 1;
+	}
+}
+
+uint32_t VertexHashMap::findOrAdd(const Vertex &vertex, std::vector<Vertex> &vertices)
+{
+	if ((this->count + 1) * 2 > this->slots.size())
+	{
+		this->grow(vertices);
+	}
+
+	uint64_t hash = hashVertex(vertex);
+	uint64_t tag = hash >> 32;
+	size_t slot = (size_t)hash & this->mask;
+
+	while (true)
+	{
+		uint64_t entry = this->slots[slot];
+		if (entry == 0)
+		{
+			uint32_t index = (uint32_t)vertices.size();
+			vertices.push_back(vertex);
+			this->slots[slot] = (tag << 32) | (uint64_t)(index + 1);
+			this->count++;
+			return index;
+		}
+
+		uint32_t index = (uint32_t)(entry & 0xFFFFFFFFull) - 1;
+		if ((entry >> 32) == tag && memcmp(&vertices[index], &vertex, sizeof(Vertex)) == 0)
+		{
+			return index;
+		}
+
+		slot = (slot + 1) & this->mask;
+	}
+}
+
+void VertexHashMap::grow(const std::vector<Vertex> &vertices)
+{
+	std::vector<uint64_t> old;
+	old.swap(this->slots);
+
+	size_t capacity = old.empty() ? 16 : old.size() * 2;
+	this->slots.assign(capacity, 0);
+	this->mask = capacity - 1;
+
+	// The tag's only half the hash, so the position has to come from
+	// rehashing the vertex itself
+	for (uint64_t entry : old)
+	{
+		if (entry == 0)
+		{
+			continue;
+		}
+
+		uint32_t index = (uint32_t)(entry & 0xFFFFFFFFull) - 1;
+		size_t slot = (size_t)hashVertex(vertices[index]) & this->mask;
+		while (this->slots[slot] != 0)
+		{
+			slot = (slot + 1) & this->mask;
+		}
+		this->slots[slot] = entry;
+	}
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <Util/Constants.h>
+
+#include <cstdint>
+#include <vector>
+
+// Flat open addressing (linear probing) table for deduping vertices.
+// each slot is 8 bytes: the vertex's index in the output array and 32
+// bits of its hash, so most mismatches are caught without touching the
+// vertex itself. keys are the raw bytes, compared with memcmp
+class VertexHashMap
+{
+public:
+	// expectedUnique is just a hint, it grows if need be
+	void reserve(size_t expectedUnique);
+
+	// One probe sequence per call. returns the index of the matching
+	// vertex already in vertices, or appends it and returns the new one
+	uint32_t findOrAdd(const Vertex &vertex, std::vector<Vertex> &vertices);
+
+	size_t size() const { return this->count; }
+	size_t capacity() const { return this->slots.size(); }
+	size_t memoryBytes() const { return this->slots.size() * sizeof(uint64_t); }
+
+private:
+	void grow(const std::vector<Vertex> &vertices);
+
+	// high 32 bits: hash tag, low 32 bits: index + 1 (0 means empty)
+	std::vector<uint64_t> slots;
+	size_t mask = 0;
+	size_t count = 0;
+};
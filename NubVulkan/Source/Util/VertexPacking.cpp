@@ -0,0 +1,186 @@
+#include <Util/VertexPacking.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace
+{
+	// Biggest finite half
+	const float HALF_MAX = 65504.0f;
+
+	// A half's 11 bits only go so far: rounding a position can be off by
+	// half the gap between halves at that size. that gap has to stay
+	// under this much of the mesh's biggest side, or a small mesh far
+	// from the origin comes out visibly stair stepped
+	const float HALF_MAX_STEP_OF_EXTENT = 1.0f / 1024.0f;
+
+	// The gap between neighbouring halves around value
+	float halfStep(float value)
+	{
+		// (denormals are evenly spaced, 2^-24 apart)
+		const float smallestNormal = std::ldexp(1.0f, -14);
+		if (value < smallestNormal)
+		{
+			return std::ldexp(1.0f, -24);
+		}
+
+		int exponent;
+		std::frexp(value, &exponent);
+		return std::ldexp(1.0f, exponent - 11);
+	}
+
+	int8_t floatToSnorm8(float value)
+	{
+		return (int8_t)std::lround(std::min(std::max(value, -1.0f), 1.0f) * 127.0f);
+	}
+
+	uint16_t floatToUnorm16(float value)
+	{
+		return (uint16_t)std::lround(std::min(std::max(value, 0.0f), 1.0f) * 65535.0f);
+	}
+}
+
+uint16_t floatToHalf(float value)
+{
+	uint32_t bits;
+	memcpy(&bits, &value, sizeof(bits));
+
+	uint32_t sign = (bits >> 16) & 0x8000;
+	uint32_t floatExponent = (bits >> 23) & 0xFF;
+	uint32_t mantissa = bits & 0x7FFFFF;
+	int32_t exponent = (int32_t)floatExponent - 127 + 15;
+
+	// inf & nan stay inf & nan
+	if (floatExponent == 0xFF)
+	{
+		return (uint16_t)(sign | 0x7C00 | (mantissa != 0 ? 0x200 : 0));
+	}
+	if (exponent >= 31)
+	{
+		return (uint16_t)(sign | 0x7C00);
+	}
+
+	// too small for a normal half, so it's a denormal (or zero)
+	if (exponent <= 0)
+	{
+		if (exponent < -10)
+		{
+			return (uint16_t)sign;
+		}
+
+		mantissa |= 0x800000;
+		uint32_t shift = (uint32_t)(14 - exponent);
+		uint32_t half = mantissa >> shift;
+		uint32_t rest = mantissa & ((1u << shift) - 1);
+		uint32_t halfway = 1u << (shift - 1);
+		if (rest > halfway || (rest == halfway && (half & 1) != 0))
+		{
+			half++;
+		}
+		return (uint16_t)(sign | half);
+	}
+
+	uint32_t half = ((uint32_t)exponent << 10) | (mantissa >> 13);
+	uint32_t rest = mantissa & 0x1FFF;
+	// rounding up can carry into the exponent, which is
+	// exactly what should happen (all the way to infinity)
+	if (rest > 0x1000 || (rest == 0x1000 && (half & 1) != 0))
+	{
+		half++;
+	}
+	return (uint16_t)(sign | half);
+}
+
+bool packedVerticesSupported(VkPhysicalDevice physicalDevice)
+{
+	for (const auto &attribDesc : Vertex::getAttributeDescriptions(VertexFormat::Packed))
+	{
+		VkFormatProperties properties;
+		vkGetPhysicalDeviceFormatProperties(physicalDevice, attribDesc.format, &properties);
+
+		if ((properties.bufferFeatures & VK_FORMAT_FEATURE_VERTEX_BUFFER_BIT) == 0)
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+bool canPackVertices(const Vertex *vertices, size_t count)
+{
+	if (count == 0)
+	{
+		return true;
+	}
+
+	glm::vec3 minPos = vertices[0].pos;
+	glm::vec3 maxPos = vertices[0].pos;
+	for (size_t i = 0; i < count; i++)
+	{
+		const Vertex &vertex = vertices[i];
+		for (int c = 0; c < 3; c++)
+		{
+			if (!(std::abs(vertex.pos[c]) <= HALF_MAX) || !(std::abs(vertex.norm[c]) <= 1.0f))
+			{
+				return false;
+			}
+			minPos[c] = std::min(minPos[c], vertex.pos[c]);
+			maxPos[c] = std::max(maxPos[c], vertex.pos[c]);
+		}
+		for (int c = 0; c < 2; c++)
+		{
+			if (!(vertex.texCoord[c] >= 0.0f && vertex.texCoord[c] <= 1.0f))
+			{
+				return false;
+			}
+		}
+	}
+
+	// the step's biggest out at the corner furthest from the origin
+	float extent = 0.0f;
+	float furthest = 0.0f;
+	for (int c = 0; c < 3; c++)
+	{
+		extent = std::max(extent, maxPos[c] - minPos[c]);
+		furthest = std::max(furthest, std::max(std::abs(minPos[c]), std::abs(maxPos[c])));
+	}
+	return halfStep(furthest) <= extent * HALF_MAX_STEP_OF_EXTENT;
+}
+
+void packVertices(const Vertex *vertices, size_t count, std::vector<PackedVertex> &packed)
+{
+	packed.resize(count);
+	for (size_t i = 0; i < count; i++)
+	{
+		const Vertex &vertex = vertices[i];
+		PackedVertex &out = packed[i];
+
+		out.pos[0] = floatToHalf(vertex.pos.x);
+		out.pos[1] = floatToHalf(vertex.pos.y);
+		out.pos[2] = floatToHalf(vertex.pos.z);
+		out.pos[3] = floatToHalf(1.0f);
+
+		out.norm[0] = floatToSnorm8(vertex.norm.x);
+		out.norm[1] = floatToSnorm8(vertex.norm.y);
+		out.norm[2] = floatToSnorm8(vertex.norm.z);
+		out.norm[3] = 0;
+
+		out.texCoord[0] = floatToUnorm16(vertex.texCoord.x);
+		out.texCoord[1] = floatToUnorm16(vertex.texCoord.y);
+	}
+}
+
+bool canUseShortIndices(size_t vertexCount)
+{
+	return vertexCount <= 0xFFFF;
+}
+
+void packIndices(const uint32_t *indices, size_t count, std::vector<uint16_t> &packed)
+{
+	packed.resize(count);
+	for (size_t i = 0; i < count; i++)
+	{
+		packed[i] = (uint16_t)indices[i];
+	}
+}
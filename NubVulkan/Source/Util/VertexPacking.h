@@ -0,0 +1,24 @@
+#pragma once
+
+#include <Util/Constants.h>
+
+#include <cstdint>
+#include <vector>
+
+// Round to nearest even, overflows to infinity like the gpu would
+uint16_t floatToHalf(float value);
+
+// Whether the gpu can read PackedVertex's attribute formats out of a
+// vertex buffer. they're all meant to be required, but just in case
+bool packedVerticesSupported(VkPhysicalDevice physicalDevice);
+
+// Whether every vertex survives being packed: positions fit in a half,
+// normals in [-1, 1] and uvs in [0, 1] (unorm16 can't wrap). positions
+// also have to sit close enough to the origin, for the mesh's size, that
+// half precision doesn't snap them to a coarse grid
+bool canPackVertices(const Vertex *vertices, size_t count);
+void packVertices(const Vertex *vertices, size_t count, std::vector<PackedVertex> &packed);
+
+// 16 bit indices as long as every vertex can be reached with one
+bool canUseShortIndices(size_t vertexCount);
+void packIndices(const uint32_t *indices, size_t count, std::vector<uint16_t> &packed);